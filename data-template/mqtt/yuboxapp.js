@@ -58,7 +58,7 @@ function yuboxLoadMqttConfig()
         .text('(consultando)');
     mqttpane.find('form span#mqtt_disconnected_reason').text('...');
 
-    $.get(yuboxAPI('mqtt')+'/conf.json')
+    yuboxStatusGetJSON('mqtt/conf.json', yuboxAPI('mqtt')+'/conf.json')
     .done(function (data) {
         mqttpane.find('form input#mqtt_clientid').val(data.clientid);
 
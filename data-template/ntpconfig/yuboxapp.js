@@ -60,7 +60,7 @@ function yuboxLoadNTPConfig()
         .text('(consultando)');
     ntppane.find('form span#ntp_timestamp').text('...');
 
-    $.get(yuboxAPI('ntpconfig')+'/conf.json')
+    yuboxStatusGetJSON('ntpconfig/conf.json', yuboxAPI('ntpconfig')+'/conf.json')
     .done(function (data) {
         var sel_tzh = ntppane.find('select#ntptz_hh');
         var sel_tzm = ntppane.find('select#ntptz_mm');
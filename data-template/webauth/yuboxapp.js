@@ -6,7 +6,7 @@ function setupWebAuthTab()
     // https://getbootstrap.com/docs/4.4/components/navs/#events
     getYuboxNavTab('webauth').on('shown.bs.tab', function (e) {
         var authpane = getYuboxPane('webauth');
-        $.getJSON(yuboxAPI('authconfig'))
+        yuboxStatusGetJSON('authconfig', yuboxAPI('authconfig'))
         .done(function (data) {
             authpane.find('input#yubox_username').val(data.username);
             authpane.find('input#yubox_password1, input#yubox_password2').val(data.password);
@@ -34,7 +34,7 @@ function setupWiFiTab()
         var net = $(e.currentTarget).data();
 
         if (net.connected) {
-            $.getJSON(yuboxAPI('wificonfig')+'/connection')
+            yuboxStatusGetJSON('wificonfig/connection', yuboxAPI('wificonfig')+'/connection')
             .done(function (data) {
                 var dlg_wifiinfo = wifipane.find('div#wifi-details');
 
@@ -128,7 +128,7 @@ function setupWiFiTab()
 
     // Qué hay que hacer al hacer clic en el botón de Redes Guardadas
     wifipane.find('button[name=networks]').click(function () {
-        $.getJSON(yuboxAPI('wificonfig')+'/networks')
+        yuboxStatusGetJSON('wificonfig/networks', yuboxAPI('wificonfig')+'/networks')
         .done(function (data) {
             var wifipane = getYuboxPane('wifi');
             var dlg_wifinetworks = wifipane.find('div#wifi-networks');
@@ -196,7 +196,7 @@ function setupWiFiTab()
 
         var st = {
             method: 'DELETE',
-            url:    yuboxAPI('wificonfig')+'/networks/'+ssid
+            url:    yuboxAPI('wificonfig')+'/networks/'+encodeURIComponent(ssid)
         };
         $.ajax(st)
         .done(function (data) {
@@ -330,10 +330,42 @@ function yuboxWiFi_setupWiFiScanListener()
 
     var wifipane = getYuboxPane('wifi');
     if (!!window.EventSource) {
-        var sse = new EventSource(yuboxAPI('wificonfig')+'/netscan');
+        var sse = yuboxEventStream('wificonfig/netscan', yuboxAPI('wificonfig')+'/netscan');
         sse.addEventListener('WiFiScanResult', function (e) {
+          // Lista completa de redes, enviada al conectarse
           var data = $.parseJSON(e.data);
-          yuboxWiFi_actualizarRedes(data);
+          var scan = {};
+          data.networks.forEach(function (net) { scan[net.bssid] = net; });
+          wifipane.data('scan', scan);
+          wifipane.data('scanseq', data.seq);
+          yuboxWiFi_actualizarRedes($.map(scan, function (net) { return net; }));
+        });
+        sse.addEventListener('WiFiScanDiff', function (e) {
+          // Cambios respecto a la lista con secuencia data.base
+          var data = $.parseJSON(e.data);
+          var scan = wifipane.data('scan');
+          var seq = wifipane.data('scanseq');
+          if (scan == null || data.seq <= seq) return;
+          if (data.base != seq) {
+            // Se perdió al menos un reporte de cambios, posiblemente reemplazado
+            // en la cola por uno más reciente. Se reconecta para recibir de
+            // nuevo la lista completa.
+            sse.close();
+            wifipane.data('sse', null);
+            wifipane.removeData('scan');
+            yuboxWiFi_setupWiFiScanListener();
+            return;
+          }
+          data.added.concat(data.changed).forEach(function (net) { scan[net.bssid] = net; });
+          data.removed.forEach(function (bssid) { delete scan[bssid]; });
+          wifipane.data('scanseq', data.seq);
+          yuboxWiFi_actualizarRedes($.map(scan, function (net) { return net; }));
+        });
+        sse.addEventListener('WiFiRoam', function (e) {
+            var data = $.parseJSON(e.data);
+            yuboxMostrarAlertText('info',
+                'Cambio de AP por señal débil: '+data.from+' ('+data.rssi_from+' dBm) a '+data.to+' ('+data.rssi_to+' dBm)',
+                5000);
         });
         sse.addEventListener('WiFiStatus', function (e) {
             var data = $.parseJSON(e.data);
@@ -16,7 +16,7 @@ function setupYuboxOTATab()
             return;
         }
 
-        $.get(yuboxAPI('yuboxOTA')+'/firmwarelist.json')
+        yuboxStatusGetJSON('yuboxOTA/firmwarelist.json', yuboxAPI('yuboxOTA')+'/firmwarelist.json')
         .done(function (data) {
             var sel_firmwarelist = otapane.find('select#yuboxfirmwarelist');
             sel_firmwarelist.empty();
@@ -40,7 +40,7 @@ function setupYuboxOTATab()
         var opt = $(this).find('option:selected').first();
         otapane.find('span.yubox-firmware-desc').text(opt.data('desc'));
 
-        $.get(opt.data('rollback'))
+        yuboxStatusGetJSON('yuboxOTA/rollback', opt.data('rollback'), opt.data('tag'))
         .done(function (data) {
             var spanRB = otapane.find('span#canrollback');
             var btnRB = otapane.find('button[name="rollback"]');
@@ -95,24 +95,19 @@ function setupYuboxOTATab()
         })
         .done(function (data) {
             if (data.success) {
-                // Al aplicar actualización debería recargarse más tarde
-                yuboxMostrarAlertText('success', data.msg, 5000);
-                setTimeout(function () {
-                    window.location.reload();
-                }, 10 * 1000);
-
-                if (data.reboot) {
-                    // Por haber recibido esta indicación, ya se sabe que el
-                    // dispositivo está listo para ser reiniciado.
-                    $.post(yuboxAPI('yuboxOTA')+'/reboot', {})
-                    .fail(function (e) {
-                        yuboxStdAjaxFailHandler(e, 5000);
+                if (data.commit && otapane.data('sse') != null) {
+                    // Los archivos de datos todavía se están instalando en
+                    // segundo plano. Se espera al evento datafiles-end.
+                    yuboxOTAUpload_onCommitEnd(function () {
+                        yuboxOTAUpload_finish(data);
                     });
+                } else {
+                    yuboxOTAUpload_finish(data);
                 }
             } else {
                 yuboxMostrarAlertText('danger', data.msg, 6000);
+                yuboxOTAUpload_shutdown();
             }
-            yuboxOTAUpload_shutdown();
         })
         .fail(function (e) {
             yuboxStdAjaxFailHandler(e, 5000);
@@ -173,10 +168,15 @@ function yuboxOTAUpload_init()
     otapane.find('div.upload-progress span#current').text('0');
     otapane.find('div.upload-progress span#total').text('0');
     otapane.find('div.upload-progress span#currupload').text('0');
+    otapane.find('div.upload-progress span#rate').text('-');
+    otapane.find('div.upload-progress span#ratio').text('-');
+    otapane.find('div.upload-progress span#eta').text('-');
     otapane.find('div.upload-progress').show();
+    otapane.data('commitdone', false);
+    otapane.data('commitend', null);
 
     if (!!window.EventSource) {
-        var sse = new EventSource(yuboxAPI('yuboxOTA')+'/events');
+        var sse = yuboxEventStream('yuboxOTA/events', yuboxAPI('yuboxOTA')+'/events');
         sse.addEventListener('uploadFileStart', function (e) {
             var data = $.parseJSON(e.data);
             var totalKB = data.total / 1024.0;
@@ -199,6 +199,11 @@ function yuboxOTAUpload_init()
             otapane.find('div.upload-progress span#total').text(totalKB.toFixed(1));
             otapane.find('div.upload-progress span#current').text(currKB.toFixed(1));
             otapane.find('div.upload-progress span#currupload').text(currUploadKB.toFixed(1));
+            if (data.rate != undefined) {
+                otapane.find('div.upload-progress span#rate').text((data.rate / 1024.0).toFixed(1));
+                otapane.find('div.upload-progress span#ratio').text(data.ratio.toFixed(2));
+                otapane.find('div.upload-progress span#eta').text(yuboxOTAUpload_formatETA(data.eta));
+            }
             yuboxOTAUpload_setProgressBar(totalKB > 0.0 ? 100.0 * currKB / totalKB : 0);
         });
         sse.addEventListener('uploadFileEnd', function (e) {
@@ -214,6 +219,7 @@ function yuboxOTAUpload_init()
         sse.addEventListener('uploadPostTask', function (e) {
 	        var data = $.parseJSON(e.data);
 	        var msg = data.task;
+	        var pct = 100;
 	        var taskDesc = {
                 'firmware-commit-start':		'Iniciando commit de firmware nuevo',
                 'firmware-commit-failed':		'Falló el commit de firmware nuevo',
@@ -225,7 +231,17 @@ function yuboxOTAUpload_init()
                 'datafiles-end':				'Fin de instalación de archivos de datos'
 	        };
 	        if (taskDesc[data.task] != undefined) msg = taskDesc[data.task];
-	        yuboxOTAUpload_setProgressBarMessage(100, msg);
+	        if (data.total != undefined && data.total > 0) {
+	            msg += ' (' + data.current + '/' + data.total + ')';
+	            pct = 100.0 * data.current / data.total;
+	        }
+	        yuboxOTAUpload_setProgressBarMessage(pct, msg);
+	        if (data.task == 'datafiles-end') {
+	            otapane.data('commitdone', true);
+	            var cb = otapane.data('commitend');
+	            otapane.data('commitend', null);
+	            if (cb != null) cb();
+	        }
         });
         otapane.data('sse', sse);
     } else {
@@ -233,6 +249,37 @@ function yuboxOTAUpload_init()
     }
 }
 
+function yuboxOTAUpload_onCommitEnd(cb)
+{
+    var otapane = getYuboxPane('yuboxOTA');
+
+    // El evento de final pudo haber llegado antes que la respuesta del upload
+    if (otapane.data('commitdone')) {
+        cb();
+    } else {
+        otapane.data('commitend', cb);
+    }
+}
+
+function yuboxOTAUpload_finish(data)
+{
+    // Al aplicar actualización debería recargarse más tarde
+    yuboxMostrarAlertText('success', data.msg, 5000);
+    setTimeout(function () {
+        window.location.reload();
+    }, 10 * 1000);
+
+    if (data.reboot) {
+        // Por haber recibido esta indicación, ya se sabe que el
+        // dispositivo está listo para ser reiniciado.
+        $.post(yuboxAPI('yuboxOTA')+'/reboot', {})
+        .fail(function (e) {
+            yuboxStdAjaxFailHandler(e, 5000);
+        });
+    }
+    yuboxOTAUpload_shutdown();
+}
+
 function yuboxOTAUpload_shutdown()
 {
     yuboxOTAUpload_setDisableBtns(false);
@@ -244,6 +291,15 @@ function yuboxOTAUpload_shutdown()
     }
 }
 
+function yuboxOTAUpload_formatETA(eta)
+{
+    // Un valor negativo indica que no se conoce aún la tasa de carga
+    if (eta == undefined || eta < 0) return '-';
+    var min = Math.floor(eta / 60);
+    var sec = eta % 60;
+    return (min > 0 ? min + ' min ' : '') + sec + ' s';
+}
+
 function yuboxOTAUpload_setDisableBtns(v)
 {
     var otapane = getYuboxPane('yuboxOTA');
@@ -57,9 +57,9 @@ function setupLectorTab()
     lectorpane.data('chart', cht);
 
     if (!!window.EventSource) {
-        var sse = new EventSource(yuboxAPI('lectura')+'/events');
+        var sse = yuboxEventStream('lectura/events', yuboxAPI('lectura')+'/events');
         sse.addEventListener('message', function (e) {
-            var data = $.parseJSON(e.data);
+            var data = yuboxTelemetryDecode(e.data);
             yuboxLector_actualizar(new Date(data.ts), data.pressure, data.temperature);
         });
         lectorpane.data('sse', sse);
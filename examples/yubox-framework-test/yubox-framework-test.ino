@@ -1,6 +1,9 @@
 #include <YuboxSimple.h>
 
 #include <YuboxMQTTConfClass.h>
+#include <YuboxEventSource.h>
+#include <YuboxWebSocketMuxClass.h>
+#include <YuboxTelemetry.h>
 
 // El modelo viejo de YUBOX tiene este sensor integrado en el board
 #include <Adafruit_Sensor.h>
@@ -8,7 +11,13 @@
 
 Adafruit_BMP280 sensor_bmp280;
 
-AsyncEventSource eventosLector("/yubox-api/lectura/events");
+// Sólo interesa la lectura más reciente, un navegador lento no acumula lecturas viejas
+YuboxEventSource eventosLector("/yubox-api/lectura/events", YUBOX_EVENTSOURCE_COALESCE);
+
+// Cada lectura se codifica una sola vez en CBOR y se reparte a SSE, WebSocket y MQTT
+typedef YuboxTelemetrySchema< YuboxTelemetryUInt64, YuboxTelemetryFloat, YuboxTelemetryFloat > lectura_schema_t;
+static const char * const lectura_claves[] = { "ts", "temperature", "pressure" };
+YuboxTelemetry<lectura_schema_t> telemetriaLector(lectura_claves);
 
 void setup()
 {
@@ -17,7 +26,13 @@ void setup()
   delay(3000);
   Serial.begin(115200);
 
-  yuboxAddManagedHandler(&eventosLector);
+  yuboxAddManagedHandler(&eventosLector, "lectura/events");
+
+  // Las lecturas también se publican en el canal WebSocket único del equipo
+  YuboxWebSocketMux.begin(yubox_HTTPServer);
+  telemetriaLector.attach(eventosLector);
+  telemetriaLector.attachWebSocket("lectura/events");
+  telemetriaLector.attachMQTT(YuboxMQTTConf.getMQTTClient(), "yubox/lectura");
 
   YuboxMQTTConf.begin(yubox_HTTPServer);
 
@@ -32,18 +47,11 @@ void loop()
 {
   yuboxSimpleLoopTask();
 
-  if (YuboxNTPConf.isNTPValid(0)) {
-    DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(3));
-    json_doc["ts"] = 1000ULL * YuboxNTPConf.getUTCTime();
-    json_doc["temperature"] = sensor_bmp280.readTemperature();
-    json_doc["pressure"] = sensor_bmp280.readPressure();
-
-    String json_output;
-    serializeJson(json_doc, json_output);
-
-    if (eventosLector.count() > 0) {
-      eventosLector.send(json_output.c_str());
-    }
+  if (YuboxNTPConf.isNTPValid(0) && telemetriaLector.active()) {
+    telemetriaLector.publish(
+      1000ULL * YuboxNTPConf.getUTCTime(),
+      sensor_bmp280.readTemperature(),
+      sensor_bmp280.readPressure());
   }
 
   delay(3000);
@@ -0,0 +1,223 @@
+/*
+ * Banco de pruebas en el anfitrión (PC) de la compresión gzip al vuelo de
+ * YuboxGzip. Compila el mismo src/YuboxGzipClass.cpp y los fuentes de uzlib
+ * del firmware, con sustitutos mínimos de Arduino y ESPAsyncWebServer en
+ * host/, y pide la respuesta comprimida por paquetes como lo hace
+ * AsyncAbstractResponse. Cada salida se descomprime con uzlib y se compara
+ * con la entrada.
+ *
+ * Compilar y ejecutar desde este directorio:
+ *
+ *   gcc -O2 -c ../../src/uzlib/[a-z]*.c
+ *   g++ -std=gnu++11 -O2 -Ihost -I../../src -o gzip-benchmark \
+ *     gzip-benchmark.cpp ../../src/YuboxGzipClass.cpp *.o
+ *   ./gzip-benchmark [archivo...]
+ *
+ * Sin argumentos se comprimen una lista de redes WiFi en JSON y un reporte
+ * de métricas en formato Prometheus, generados con datos pseudoaleatorios de
+ * semilla fija, y ../../README.md. Para comparar con un solo candidato por
+ * posición, se compila con -DYUBOX_GZIP_MAX_CHAIN=1. La ventana y la tabla
+ * hash se cambian igual con -DYUBOX_GZIP_WINDOW_BITS y -DYUBOX_GZIP_HASH_BITS.
+ *
+ * Resultado en un PC x86-64 (Xeon) con g++ 12 -O2, configuración por omisión
+ * (ventana de 1 KB, 8 candidatos), entre paréntesis con 1 candidato, menor
+ * tiempo de 200 repeticiones:
+ *
+ *   lista de redes,  5436 bytes:    30.2% (38.2%)      74 us (73 us)
+ *   métricas,       22220 bytes:    12.6% (13.7%)     330 us (317 us)
+ *   README.md,      63812 bytes:    56.9% (66.8%)    2600 us (2040 us)
+ *
+ * El tamaño y resultado de README.md cambian con cada versión del archivo.
+ * Los tiempos absolutos no corresponden a los del ESP32, donde el registro
+ * de depuración reporta el tiempo de compresión de cada respuesta.
+ */
+#include <Arduino.h>
+
+#include "YuboxGzipClass.h"
+
+#include <vector>
+
+// Datos de prueba con semilla fija, para obtener la misma entrada en cada
+// ejecución
+static uint32_t rngState = 12345;
+static uint32_t rng(uint32_t n)
+{
+  rngState = rngState * 1103515245UL + 12345UL;
+  return (rngState >> 16) % n;
+}
+
+static void append(std::vector<uint8_t> & v, const char * s)
+{
+  v.insert(v.end(), s, s + strlen(s));
+}
+
+// Misma forma que YuboxWiFiClass::_writeScannedNetworkJSON()
+static std::vector<uint8_t> scanListJSON(void)
+{
+  static const char * prefixes[] = { "Netlife-", "Claro_", "CNT_", "TP-Link_", "Movistar_", "YUBOX-" };
+  std::vector<uint8_t> v;
+  char buf[256];
+
+  append(v, "[");
+  for (auto i = 0; i < 40; i++) {
+    snprintf(buf, sizeof(buf),
+      "%s{\"bssid\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"ssid\":\"%s%04u\",\"channel\":%u,\"rssi\":%d,"
+      "\"authmode\":%u,\"connected\":%s,\"connfail\":false,\"saved\":%s}",
+      (i > 0) ? "," : "",
+      rng(256), rng(256), rng(256), rng(256), rng(256), rng(256),
+      prefixes[rng(6)], rng(10000), 1 + rng(13), -30 - (int)rng(60),
+      rng(5), (i == 0) ? "true" : "false", (rng(8) == 0) ? "true" : "false");
+    append(v, buf);
+  }
+  append(v, "]");
+  return v;
+}
+
+// Misma forma que YuboxMetricsClass::_writeHistogram() y sus contadores
+static std::vector<uint8_t> metricsText(void)
+{
+  static const char * routes[] = {
+    "/yubox-api/status", "/yubox-api/metrics", "/yubox-api/wificonfig/connection",
+    "/yubox-api/wificonfig/networks", "/yubox-api/wificonfig/networks/{ssid}",
+    "/yubox-api/wificonfig/roaming", "/yubox-api/ntpconfig/conf.json",
+    "/yubox-api/mqtt/conf.json", "/yubox-api/yuboxOTA/firmwarelist.json",
+  };
+  static const uint32_t bounds[] = { 5, 10, 25, 50, 100, 250, 500, 1000, 2500 };
+  static const char * histograms[] = { "yubox_http_ttfb_seconds", "yubox_http_duration_seconds" };
+  std::vector<uint8_t> v;
+  char buf[256];
+
+  append(v, "# HELP yubox_http_requests_total Peticiones atendidas por ruta\n"
+    "# TYPE yubox_http_requests_total counter\n");
+  for (auto r : routes) {
+    snprintf(buf, sizeof(buf), "yubox_http_requests_total{route=\"%s\",method=\"GET\"} %u\n", r, rng(5000));
+    append(v, buf);
+  }
+  for (auto h : histograms) {
+    snprintf(buf, sizeof(buf), "# HELP %s Tiempo de respuesta\n# TYPE %s histogram\n", h, h);
+    append(v, buf);
+    for (auto r : routes) {
+      uint32_t acc = 0;
+      for (auto b : bounds) {
+        acc += rng(400);
+        snprintf(buf, sizeof(buf), "%s_bucket{route=\"%s\",method=\"GET\",le=\"%.3f\"} %u\n", h, r, b / 1000.0, acc);
+        append(v, buf);
+      }
+      snprintf(buf, sizeof(buf), "%s_bucket{route=\"%s\",method=\"GET\",le=\"+Inf\"} %u\n", h, r, acc);
+      append(v, buf);
+      snprintf(buf, sizeof(buf), "%s_sum{route=\"%s\",method=\"GET\"} %.6f\n", h, r, rng(1000000) / 1000.0);
+      append(v, buf);
+      snprintf(buf, sizeof(buf), "%s_count{route=\"%s\",method=\"GET\"} %u\n", h, r, acc);
+      append(v, buf);
+    }
+  }
+  return v;
+}
+
+static bool readFile(const char * path, std::vector<uint8_t> & v)
+{
+  FILE * f = fopen(path, "rb");
+  if (f == NULL) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) v.insert(v.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+// Respuesta completa, pedida en paquetes del tamaño de un segmento TCP
+static bool compress(const std::vector<uint8_t> & in, std::vector<uint8_t> & out)
+{
+  AsyncWebServerRequest request("gzip, deflate");
+  AwsResponseFiller filler = [&in](uint8_t * buf, size_t maxLen, size_t index) -> size_t {
+    size_t n = in.size() - index;
+    if (n > maxLen) n = maxLen;
+    memcpy(buf, in.data() + index, n);
+    return n;
+  };
+
+  std::unique_ptr<AsyncWebServerResponse> response(YuboxGzip.beginChunkedResponse(&request, "text/plain", filler));
+  if (response->headers.count("Content-Encoding") == 0) return false;
+
+  AsyncAbstractResponse * r = static_cast<AsyncAbstractResponse *>(response.get());
+  uint8_t packet[1436];
+  size_t n;
+  out.clear();
+  while ((n = r->_fillBuffer(packet, sizeof(packet))) > 0) {
+    out.insert(out.end(), packet, packet + n);
+  }
+  return true;
+}
+
+static bool verify(const std::vector<uint8_t> & gz, const std::vector<uint8_t> & expected)
+{
+  std::vector<uint8_t> dest(expected.size() + 1);
+  struct uzlib_uncomp d;
+
+  uzlib_uncompress_init(&d, NULL, 0);
+  d.source = gz.data();
+  d.source_limit = gz.data() + gz.size();
+  d.source_read_cb = NULL;
+  if (uzlib_gzip_parse_header(&d) != TINF_OK) return false;
+
+  d.dest_start = d.dest = dest.data();
+  d.dest_limit = dest.data() + dest.size();
+  int res;
+  do {
+    res = uzlib_uncompress_chksum(&d);
+  } while (res == TINF_OK && d.dest < d.dest_limit);
+  if (res != TINF_DONE) return false;
+
+  size_t len = d.dest - dest.data();
+  return len == expected.size() && memcmp(dest.data(), expected.data(), len) == 0;
+}
+
+static bool run(const char * name, const std::vector<uint8_t> & in)
+{
+  const int rounds = 200;
+  std::vector<uint8_t> out;
+  double best = 0;
+
+  for (auto i = 0; i < rounds; i++) {
+    auto t0 = std::chrono::steady_clock::now();
+    if (!compress(in, out)) {
+      printf("%-24s %7u bytes: no se comprimió\n", name, (unsigned)in.size());
+      return false;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    if (i == 0 || us < best) best = us;
+  }
+
+  bool ok = verify(out, in);
+  printf("%-24s %7u bytes -> %7u bytes (%5.1f%%) %8.1f us %s\n", name, (unsigned)in.size(), (unsigned)out.size(),
+    100.0 * out.size() / in.size(), best, ok ? "" : "ERROR AL DESCOMPRIMIR");
+  return ok;
+}
+
+int main(int argc, char * argv[])
+{
+  bool ok = true;
+
+  uzlib_init();
+  printf("ventana %u bytes, tabla hash %u entradas, %u candidatos\n",
+    1U << YUBOX_GZIP_WINDOW_BITS, 1U << YUBOX_GZIP_HASH_BITS, YUBOX_GZIP_MAX_CHAIN);
+
+  if (argc > 1) {
+    for (auto i = 1; i < argc; i++) {
+      std::vector<uint8_t> v;
+      if (!readFile(argv[i], v) || v.empty()) {
+        printf("%s: no se puede leer\n", argv[i]);
+        ok = false;
+        continue;
+      }
+      ok = run(argv[i], v) && ok;
+    }
+  } else {
+    ok = run("lista de redes", scanListJSON()) && ok;
+    ok = run("métricas", metricsText()) && ok;
+    std::vector<uint8_t> v;
+    if (readFile("../../README.md", v)) ok = run("README.md", v) && ok;
+  }
+  return ok ? 0 : 1;
+}
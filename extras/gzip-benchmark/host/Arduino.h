@@ -0,0 +1,47 @@
+// Sustituto mínimo de Arduino.h para compilar YuboxGzipClass en el anfitrión.
+// Sólo declara lo que usan YuboxGzipClass.cpp y los encabezados que incluye.
+#ifndef _YUBOX_HOST_ARDUINO_H_
+#define _YUBOX_HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <functional>
+#include <string>
+#include <chrono>
+
+#define log_v(...) do {} while (0)
+#define log_d(...) do {} while (0)
+#define log_i(...) do {} while (0)
+#define log_w(...) do {} while (0)
+#define log_e(...) do {} while (0)
+
+typedef int portMUX_TYPE;
+#define portENTER_CRITICAL(m) do {} while (0)
+#define portEXIT_CRITICAL(m) do {} while (0)
+#define vPortCPUInitializeMutex(m) do {} while (0)
+
+inline unsigned long micros(void)
+{
+  static auto t0 = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+class String
+{
+private:
+  std::string _s;
+
+public:
+  String(const char * s = "") : _s(s) {}
+  const char * c_str(void) const { return _s.c_str(); }
+  unsigned int length(void) const { return _s.length(); }
+  bool isEmpty(void) const { return _s.empty(); }
+  bool operator==(const String & o) const { return _s == o._s; }
+  bool operator==(const char * o) const { return _s == o; }
+};
+
+#endif
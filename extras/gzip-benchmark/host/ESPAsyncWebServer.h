@@ -0,0 +1,73 @@
+// Sustituto mínimo de ESPAsyncWebServer.h para el banco de pruebas de
+// YuboxGzip. La respuesta sólo guarda sus cabeceras y expone _fillBuffer(),
+// que el banco llama igual que AsyncAbstractResponse al enviar cada paquete.
+#ifndef _YUBOX_HOST_ESPASYNCWEBSERVER_H_
+#define _YUBOX_HOST_ESPASYNCWEBSERVER_H_
+
+#include "Arduino.h"
+#include <map>
+#include <memory>
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebServerResponse
+{
+public:
+  int _code;
+  String _contentType;
+  size_t _contentLength;
+  bool _sendContentLength;
+  bool _chunked;
+  size_t _writtenLength;
+  std::map<std::string, std::string> headers;
+
+  AsyncWebServerResponse(void)
+    : _code(0), _contentLength(0), _sendContentLength(true), _chunked(false), _writtenLength(0) {}
+  virtual ~AsyncWebServerResponse() {}
+  void addHeader(const String & name, const String & value) { headers[name.c_str()] = value.c_str(); }
+};
+
+class AsyncAbstractResponse : public AsyncWebServerResponse
+{
+public:
+  virtual size_t _fillBuffer(uint8_t *, size_t) { return 0; }
+};
+
+// Respuesta sin comprimir, que entrega lo mismo que el callback
+class AsyncHostFillerResponse : public AsyncAbstractResponse
+{
+private:
+  AwsResponseFiller _content;
+  size_t _index;
+
+public:
+  AsyncHostFillerResponse(AwsResponseFiller filler) : _content(filler), _index(0) {}
+  virtual size_t _fillBuffer(uint8_t * buf, size_t maxLen) override
+  {
+    size_t r = _content(buf, maxLen, _index);
+    if (r != RESPONSE_TRY_AGAIN) _index += r;
+    return r;
+  }
+};
+
+class AsyncWebServerRequest
+{
+private:
+  String _acceptEncoding;
+
+public:
+  AsyncWebServerRequest(const char * acceptEncoding) : _acceptEncoding(acceptEncoding) {}
+  uint8_t version(void) const { return 1; }
+  void addInterestingHeader(const String &) {}
+  bool hasHeader(const char *) const { return !_acceptEncoding.isEmpty(); }
+  const String & header(const char *) const { return _acceptEncoding; }
+
+  AsyncWebServerResponse * beginResponse(const String &, size_t, AwsResponseFiller filler)
+    { return new AsyncHostFillerResponse(filler); }
+  AsyncWebServerResponse * beginChunkedResponse(const String &, AwsResponseFiller filler)
+    { return new AsyncHostFillerResponse(filler); }
+};
+
+#endif
@@ -0,0 +1,46 @@
+// Sustituto mínimo de Arduino.h para compilar YuboxRouter en el anfitrión.
+// Sólo declara lo que usan YuboxRouterClass.cpp y los encabezados que incluye.
+#ifndef _YUBOX_HOST_ARDUINO_H_
+#define _YUBOX_HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <functional>
+#include <string>
+
+#define log_v(...) do {} while (0)
+#define log_d(...) do {} while (0)
+#define log_i(...) do {} while (0)
+#define log_w(...) do {} while (0)
+#define log_e(...) do {} while (0)
+
+typedef int portMUX_TYPE;
+#define portENTER_CRITICAL(m) do {} while (0)
+#define portEXIT_CRITICAL(m) do {} while (0)
+#define vPortCPUInitializeMutex(m) do {} while (0)
+
+class String
+{
+private:
+  std::string _s;
+
+public:
+  String(const char * s = "") : _s(s) {}
+  const char * c_str(void) const { return _s.c_str(); }
+  unsigned int length(void) const { return _s.length(); }
+  bool reserve(unsigned int n) { _s.reserve(n); return true; }
+  bool isEmpty(void) const { return _s.empty(); }
+  String & operator+=(const String & o) { _s += o._s; return *this; }
+  String & operator+=(const char * o) { _s += o; return *this; }
+  String & operator+=(char c) { _s += c; return *this; }
+  bool operator==(const String & o) const { return _s == o._s; }
+  bool operator==(const char * o) const { return _s == o; }
+  bool operator!=(const String & o) const { return _s != o._s; }
+  bool operator!=(const char * o) const { return _s != o; }
+  bool startsWith(const String & o) const { return _s.compare(0, o._s.size(), o._s) == 0; }
+};
+
+#endif
@@ -0,0 +1,66 @@
+// Sustituto mínimo de ESPAsyncWebServer.h para el banco de pruebas de
+// YuboxRouter. La petición sólo tiene URL y método, que es todo lo que se
+// consulta al localizar la ruta.
+#ifndef _YUBOX_HOST_ESPASYNCWEBSERVER_H_
+#define _YUBOX_HOST_ESPASYNCWEBSERVER_H_
+
+#include "Arduino.h"
+#include <vector>
+
+typedef enum {
+  HTTP_GET     = 0b00000001,
+  HTTP_POST    = 0b00000010,
+  HTTP_DELETE  = 0b00000100,
+  HTTP_PUT     = 0b00001000,
+  HTTP_PATCH   = 0b00010000,
+  HTTP_HEAD    = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY     = 0b01111111,
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerResponse {};
+
+class AsyncWebServerRequest
+{
+private:
+  String _url;
+  WebRequestMethodComposite _method;
+
+public:
+  AsyncWebServerRequest(const char * url, WebRequestMethodComposite method) : _url(url), _method(method) {}
+  const String & url(void) const { return _url; }
+  WebRequestMethodComposite method(void) const { return _method; }
+  void addInterestingHeader(const String &) {}
+  bool authenticate(const char *, const char *) { return true; }
+  void requestAuthentication(void) {}
+  void send(int) {}
+};
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebHandler
+{
+protected:
+  String _username;
+  String _password;
+
+public:
+  virtual ~AsyncWebHandler() {}
+  virtual bool canHandle(AsyncWebServerRequest *) { return false; }
+  virtual void handleRequest(AsyncWebServerRequest *) {}
+  virtual void handleUpload(AsyncWebServerRequest *, const String &, size_t, uint8_t *, size_t, bool) {}
+  virtual void handleBody(AsyncWebServerRequest *, uint8_t *, size_t, size_t, size_t) {}
+  virtual bool isRequestHandlerTrivial(void) { return true; }
+};
+
+class AsyncWebServer
+{
+public:
+  AsyncWebHandler & addHandler(AsyncWebHandler * h) { return *h; }
+};
+
+#endif
@@ -0,0 +1,7 @@
+// Sustituto vacío de Preferences.h, sólo para que compile YuboxWebAuthClass.h
+#ifndef _YUBOX_HOST_PREFERENCES_H_
+#define _YUBOX_HOST_PREFERENCES_H_
+
+class Preferences {};
+
+#endif
@@ -0,0 +1,100 @@
+// Sustituto mínimo de Arduino.h para compilar YuboxWiFiClass en el anfitrión.
+// Sólo declara lo que usan YuboxWiFiClass.cpp y los encabezados que incluye.
+#ifndef _YUBOX_HOST_ARDUINO_H_
+#define _YUBOX_HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <functional>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+
+typedef uint8_t byte;
+
+#define log_v(...) do {} while (0)
+#define log_d(...) do {} while (0)
+#define log_i(...) do {} while (0)
+#define log_w(...) do {} while (0)
+#define log_e(...) do {} while (0)
+
+// Reloj controlado por la prueba
+extern unsigned long host_millis;
+inline unsigned long millis(void) { return host_millis; }
+
+class String
+{
+private:
+  std::string _s;
+
+public:
+  String(const char * s = "") : _s(s != NULL ? s : "") {}
+  String(const std::string & s) : _s(s) {}
+  String(int n, unsigned char base = 10)
+  {
+    char buf[16];
+    snprintf(buf, sizeof(buf), (base == 16) ? "%x" : "%d", n);
+    _s = buf;
+  }
+  const char * c_str(void) const { return _s.c_str(); }
+  unsigned int length(void) const { return _s.length(); }
+  bool isEmpty(void) const { return _s.empty(); }
+  long toInt(void) const { return atol(_s.c_str()); }
+  char operator[](unsigned int i) const { return (i < _s.size()) ? _s[i] : '\0'; }
+  String & operator+=(const String & o) { _s += o._s; return *this; }
+  String & operator+=(const char * o) { _s += o; return *this; }
+  bool operator==(const String & o) const { return _s == o._s; }
+  bool operator==(const char * o) const { return _s == o; }
+  bool operator!=(const String & o) const { return _s != o._s; }
+  bool operator!=(const char * o) const { return _s != o; }
+  bool endsWith(const String & o) const
+  {
+    return _s.size() >= o._s.size() && _s.compare(_s.size() - o._s.size(), o._s.size(), o._s) == 0;
+  }
+  void remove(unsigned int i) { if (i < _s.size()) _s.erase(i); }
+  void toUpperCase(void) { for (auto & c : _s) c = toupper(c); }
+  void replace(const String & from, const String & to)
+  {
+    if (from._s.empty()) return;
+    for (size_t p = _s.find(from._s); p != std::string::npos; p = _s.find(from._s, p + to._s.size())) {
+      _s.replace(p, from._s.size(), to._s);
+    }
+  }
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t * buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+  size_t print(const char * s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t printf(const char * format, ...) __attribute__ ((format (printf, 2, 3)))
+  {
+    char buf[256];
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t *)buf, ((size_t)n < sizeof(buf)) ? n : sizeof(buf) - 1);
+  }
+};
+
+class Stream : public Print {};
+
+#include "IPAddress.h"
+
+#endif
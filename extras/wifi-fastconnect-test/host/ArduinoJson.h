@@ -0,0 +1,33 @@
+// Sustituto de ArduinoJson.h. Los documentos aceptan asignaciones pero no
+// guardan nada: la prueba sólo verifica el código de respuesta.
+#ifndef _YUBOX_HOST_ARDUINOJSON_H_
+#define _YUBOX_HOST_ARDUINOJSON_H_
+
+#include "Arduino.h"
+
+#define JSON_OBJECT_SIZE(n) ((n) * 16)
+#define JSON_ARRAY_SIZE(n) ((n) * 8 + 8)
+#define JSON_STRING_SIZE(n) ((n) + 1)
+
+class JsonVariant
+{
+public:
+  template <typename T> JsonVariant & operator=(const T &) { return *this; }
+  JsonVariant operator[](const char *) const { return JsonVariant(); }
+};
+
+class JsonDocument : public JsonVariant {};
+
+template <typename TAllocator> class BasicJsonDocument : public JsonDocument, TAllocator
+{
+private:
+  void * _pool;
+
+public:
+  explicit BasicJsonDocument(size_t capa) { _pool = this->allocate(capa); }
+  ~BasicJsonDocument() { this->deallocate(_pool); }
+};
+
+template <typename T> size_t serializeJson(const JsonVariant &, T &) { return 0; }
+
+#endif
@@ -0,0 +1,8 @@
+// Sustituto de AsyncJson.h
+#ifndef _YUBOX_HOST_ASYNCJSON_H_
+#define _YUBOX_HOST_ASYNCJSON_H_
+
+#include "ArduinoJson.h"
+#include "ESPAsyncWebServer.h"
+
+#endif
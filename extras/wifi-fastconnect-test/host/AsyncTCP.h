@@ -0,0 +1,13 @@
+// Sustituto de AsyncTCP.h, sólo el cliente que aparece en los encabezados
+#ifndef _YUBOX_HOST_ASYNCTCP_H_
+#define _YUBOX_HOST_ASYNCTCP_H_
+
+#include "Arduino.h"
+
+class AsyncClient
+{
+public:
+  bool connected(void) { return false; }
+};
+
+#endif
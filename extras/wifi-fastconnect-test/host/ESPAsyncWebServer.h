@@ -0,0 +1,118 @@
+// Sustituto mínimo de ESPAsyncWebServer.h para la prueba de YuboxWiFiClass.
+// La petición lleva sus parámetros POST y guarda el código de la respuesta
+// enviada, que es todo lo que la prueba consulta.
+#ifndef _YUBOX_HOST_ESPASYNCWEBSERVER_H_
+#define _YUBOX_HOST_ESPASYNCWEBSERVER_H_
+
+#include "Arduino.h"
+#include "FS.h"
+#include "WiFi.h"
+#include "AsyncTCP.h"
+
+#include <memory>
+#include <vector>
+
+typedef enum {
+  HTTP_GET     = 0b00000001,
+  HTTP_POST    = 0b00000010,
+  HTTP_DELETE  = 0b00000100,
+  HTTP_PUT     = 0b00001000,
+  HTTP_PATCH   = 0b00010000,
+  HTTP_HEAD    = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY     = 0b01111111,
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter
+{
+private:
+  String _name;
+  String _value;
+
+public:
+  AsyncWebParameter(const String & name, const String & value) : _name(name), _value(value) {}
+  const String & name(void) const { return _name; }
+  const String & value(void) const { return _value; }
+};
+
+class AsyncWebServerResponse
+{
+protected:
+  int _code;
+
+public:
+  AsyncWebServerResponse(void) : _code(0) {}
+  virtual ~AsyncWebServerResponse() {}
+  virtual void setCode(int code) { _code = code; }
+  int code(void) const { return _code; }
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print
+{
+public:
+  size_t write(uint8_t) { return 1; }
+  using Print::write;
+};
+
+class AsyncWebServerRequest
+{
+private:
+  std::vector<AsyncWebParameter> _params;
+
+public:
+  // Código de la respuesta enviada, o 0 si no se ha respondido
+  int sentCode;
+
+  AsyncWebServerRequest(void) : sentCode(0) {}
+  void addParam(const char * name, const char * value) { _params.push_back(AsyncWebParameter(name, value)); }
+
+  bool hasParam(const String & name, bool = false, bool = false) const { return getParam(name) != NULL; }
+  AsyncWebParameter * getParam(const String & name, bool = false, bool = false) const
+  {
+    for (auto & p : _params) if (p.name() == name) return const_cast<AsyncWebParameter *>(&p);
+    return NULL;
+  }
+  void addInterestingHeader(const String &) {}
+  void requestAuthentication(const char * = NULL, bool = true) { sentCode = 401; }
+  void send(int code, const String & = String(), const String & = String()) { sentCode = code; }
+  void send(AsyncWebServerResponse * response) { sentCode = response->code(); delete response; }
+  AsyncResponseStream * beginResponseStream(const String &, size_t = 1460) { return new AsyncResponseStream(); }
+};
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebHandler
+{
+public:
+  virtual ~AsyncWebHandler() {}
+  virtual bool canHandle(AsyncWebServerRequest *) { return false; }
+  virtual void handleRequest(AsyncWebServerRequest *) {}
+  virtual void handleUpload(AsyncWebServerRequest *, const String &, size_t, uint8_t *, size_t, bool) {}
+  virtual void handleBody(AsyncWebServerRequest *, uint8_t *, size_t, size_t, size_t) {}
+  virtual bool isRequestHandlerTrivial(void) { return true; }
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {};
+
+class AsyncWebServer
+{
+private:
+  AsyncCallbackWebHandler _dummy;
+
+public:
+  void begin(void) {}
+  AsyncWebHandler & addHandler(AsyncWebHandler * h) { return *h; }
+  AsyncCallbackWebHandler & on(const char *, WebRequestMethodComposite, ArRequestHandlerFunction) { return _dummy; }
+};
+
+// Sólo aparecen como punteros en YuboxWebSocketMuxClass.h
+class AsyncWebSocket;
+class AsyncWebSocketClient;
+class AsyncWebSocketMessageBuffer;
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+
+#endif
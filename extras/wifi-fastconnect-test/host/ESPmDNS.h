@@ -0,0 +1,16 @@
+// Sustituto de ESPmDNS.h, no anuncia nada en el anfitrión
+#ifndef _YUBOX_HOST_ESPMDNS_H_
+#define _YUBOX_HOST_ESPMDNS_H_
+
+#include "Arduino.h"
+
+class MDNSResponder
+{
+public:
+  bool begin(const char *) { return true; }
+  void addService(const char *, const char *, uint16_t) {}
+};
+
+extern MDNSResponder MDNS;
+
+#endif
@@ -0,0 +1,31 @@
+// Sustituto de FS.h. El sistema de archivos simulado está vacío.
+#ifndef _YUBOX_HOST_FS_H_
+#define _YUBOX_HOST_FS_H_
+
+#include "Arduino.h"
+
+namespace fs {
+
+class File
+{
+public:
+  operator bool() const { return false; }
+  const char * name(void) const { return ""; }
+  bool isDirectory(void) { return false; }
+  File openNextFile(const char * = "r") { return File(); }
+  size_t size(void) const { return 0; }
+  void close(void) {}
+};
+
+class FS
+{
+public:
+  File open(const char *, const char * = "r") { return File(); }
+};
+
+}
+
+using fs::FS;
+using fs::File;
+
+#endif
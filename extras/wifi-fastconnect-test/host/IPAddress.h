@@ -0,0 +1,28 @@
+// Sustituto de IPAddress del núcleo Arduino, con la dirección en el mismo
+// orden de bytes que el ESP32.
+#ifndef _YUBOX_HOST_IPADDRESS_H_
+#define _YUBOX_HOST_IPADDRESS_H_
+
+#include "Arduino.h"
+
+class IPAddress
+{
+private:
+  uint32_t _addr;
+
+public:
+  IPAddress(void) : _addr(0) {}
+  IPAddress(uint32_t addr) : _addr(addr) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    : _addr((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+  operator uint32_t() const { return _addr; }
+  String toString(void) const
+  {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u",
+      _addr & 0xff, (_addr >> 8) & 0xff, (_addr >> 16) & 0xff, (_addr >> 24) & 0xff);
+    return String(buf);
+  }
+};
+
+#endif
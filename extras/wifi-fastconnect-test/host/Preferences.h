@@ -0,0 +1,51 @@
+// NVRAM simulada en memoria. Cuenta las escrituras por clave para verificar
+// que no se desgasta la flash sin necesidad.
+#ifndef _YUBOX_HOST_PREFERENCES_H_
+#define _YUBOX_HOST_PREFERENCES_H_
+
+#include "Arduino.h"
+
+#include <map>
+
+class Preferences
+{
+public:
+  static std::map<std::string, std::string> store;
+  static std::map<std::string, unsigned int> writes;
+
+  static void mockReset(void) { store.clear(); writes.clear(); }
+
+  bool begin(const char *, bool = false, const char * = NULL) { return true; }
+  void end(void) {}
+
+  bool remove(const char * key) { return store.erase(key) > 0; }
+  size_t putBytes(const char * key, const void * value, size_t len)
+  {
+    store[key] = std::string((const char *)value, len);
+    writes[key]++;
+    return len;
+  }
+  size_t getBytes(const char * key, void * buf, size_t maxLen)
+  {
+    auto it = store.find(key);
+    if (it == store.end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+  size_t putString(const char * key, String value) { return putBytes(key, value.c_str(), value.length()); }
+  String getString(const char * key, String defaultValue = String())
+  {
+    auto it = store.find(key);
+    return (it == store.end()) ? defaultValue : String(it->second);
+  }
+
+  size_t putInt(const char * key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putUInt(const char * key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putBool(const char * key, bool value) { return putBytes(key, &value, sizeof(value)); }
+  int32_t getInt(const char * key, int32_t defaultValue = 0) { int32_t v; return (getBytes(key, &v, sizeof(v)) == sizeof(v)) ? v : defaultValue; }
+  uint32_t getUInt(const char * key, uint32_t defaultValue = 0) { uint32_t v; return (getBytes(key, &v, sizeof(v)) == sizeof(v)) ? v : defaultValue; }
+  bool getBool(const char * key, bool defaultValue = false) { bool v; return (getBytes(key, &v, sizeof(v)) == sizeof(v)) ? v : defaultValue; }
+};
+
+#endif
@@ -0,0 +1,20 @@
+// Sustituto de SPIFFS.h sobre el sistema de archivos vacío de FS.h
+#ifndef _YUBOX_HOST_SPIFFS_H_
+#define _YUBOX_HOST_SPIFFS_H_
+
+#include "FS.h"
+
+namespace fs {
+
+class SPIFFSFS : public FS
+{
+public:
+  size_t totalBytes(void) { return 0; }
+  size_t usedBytes(void) { return 0; }
+};
+
+}
+
+extern fs::SPIFFSFS SPIFFS;
+
+#endif
@@ -0,0 +1,167 @@
+// Controlador WiFi simulado. Registra las llamadas que hace YuboxWiFiClass
+// y permite a la prueba fijar el estado de la conexión y emitir eventos como
+// lo haría el SDK.
+#ifndef _YUBOX_HOST_WIFI_H_
+#define _YUBOX_HOST_WIFI_H_
+
+#include "Arduino.h"
+#include "esp_wifi.h"
+
+#include <vector>
+
+typedef enum {
+  WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL, WL_SCAN_COMPLETED, WL_CONNECTED,
+  WL_CONNECT_FAILED, WL_CONNECTION_LOST, WL_DISCONNECTED
+} wl_status_t;
+
+#define WIFI_OFF    WIFI_MODE_NULL
+#define WIFI_AP_STA WIFI_MODE_APSTA
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED  (-2)
+
+typedef enum {
+  SYSTEM_EVENT_WIFI_READY = 0, SYSTEM_EVENT_SCAN_DONE, SYSTEM_EVENT_STA_START, SYSTEM_EVENT_STA_STOP,
+  SYSTEM_EVENT_STA_CONNECTED, SYSTEM_EVENT_STA_DISCONNECTED, SYSTEM_EVENT_STA_AUTHMODE_CHANGE,
+  SYSTEM_EVENT_STA_GOT_IP, SYSTEM_EVENT_STA_LOST_IP, SYSTEM_EVENT_MAX
+} system_event_id_t;
+typedef system_event_id_t WiFiEvent_t;
+
+typedef struct { uint8_t ssid[32]; uint8_t ssid_len; uint8_t bssid[6]; uint8_t reason; } system_event_sta_disconnected_t;
+typedef union { system_event_sta_disconnected_t disconnected; } system_event_info_t;
+typedef system_event_info_t WiFiEventInfo_t;
+
+#define WIFI_REASON_ASSOC_LEAVE   8
+#define WIFI_REASON_NO_AP_FOUND   201
+
+typedef size_t wifi_event_id_t;
+typedef wifi_event_id_t WiFiEventId_t;
+typedef std::function<void(system_event_id_t event, system_event_info_t info)> WiFiEventFuncCb;
+
+class WiFiClass
+{
+private:
+  struct handler_t { wifi_event_id_t id; WiFiEventFuncCb cb; system_event_id_t event; };
+  std::vector<handler_t> _handlers;
+  wifi_event_id_t _nextId;
+
+public:
+  // Estado que fija la prueba
+  wl_status_t mockStatus;
+  String mockSSID;
+  uint8_t mockBSSID[6];
+  bool mockHasBSSID;
+  int32_t mockChannel;
+  uint32_t mockIP, mockGateway, mockNetmask, mockDNS;
+  std::vector<wifi_ap_record_t> mockScan;
+
+  // Llamadas registradas
+  unsigned int beginCount;
+  String beginSSID;
+  String beginPSK;
+  int32_t beginChannel;
+  bool beginHasBSSID;
+  uint8_t beginBSSID[6];
+  unsigned int configCount;
+  uint32_t configIP;
+  unsigned int disconnectCount;
+
+  void mockReset(void)
+  {
+    _handlers.clear();
+    _nextId = 1;
+    mockStatus = WL_DISCONNECTED;
+    mockSSID = "";
+    memset(mockBSSID, 0, sizeof(mockBSSID));
+    mockHasBSSID = false;
+    mockChannel = 0;
+    mockIP = mockGateway = mockNetmask = mockDNS = 0;
+    mockScan.clear();
+    beginCount = 0;
+    beginSSID = "";
+    beginPSK = "";
+    beginChannel = 0;
+    beginHasBSSID = false;
+    memset(beginBSSID, 0, sizeof(beginBSSID));
+    configCount = 0;
+    configIP = 0;
+    disconnectCount = 0;
+  }
+
+  // Entrega el evento a los manejadores instalados, como el SDK
+  void mockEvent(system_event_id_t event, uint8_t reason = 0)
+  {
+    system_event_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.disconnected.reason = reason;
+    std::vector<handler_t> h = _handlers;
+    for (auto & e : h) {
+      if (e.event == SYSTEM_EVENT_MAX || e.event == event) e.cb(event, info);
+    }
+  }
+
+  wifi_event_id_t onEvent(WiFiEventFuncCb cb, system_event_id_t event = SYSTEM_EVENT_MAX)
+  {
+    handler_t e = { _nextId++, cb, event };
+    _handlers.push_back(e);
+    return e.id;
+  }
+  void removeEvent(wifi_event_id_t id)
+  {
+    for (auto it = _handlers.begin(); it != _handlers.end(); it++) {
+      if (it->id == id) { _handlers.erase(it); break; }
+    }
+  }
+
+  void persistent(bool) {}
+  bool mode(wifi_mode_t) { return true; }
+  wifi_mode_t getMode(void) { return WIFI_MODE_APSTA; }
+  bool setSleep(bool) { return true; }
+  bool setAutoReconnect(bool) { return true; }
+  bool softAP(const char *, const char * = NULL, int = 1, int = 0, int = 4) { return true; }
+  bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+  bool softAPdisconnect(bool = false) { return true; }
+
+  wl_status_t begin(const char * ssid, const char * psk = NULL, int32_t channel = 0, const uint8_t * bssid = NULL, bool = true)
+  {
+    beginCount++;
+    beginSSID = ssid;
+    beginPSK = (psk != NULL) ? psk : "";
+    beginChannel = channel;
+    beginHasBSSID = (bssid != NULL);
+    if (bssid != NULL) memcpy(beginBSSID, bssid, 6);
+    return WL_DISCONNECTED;
+  }
+  bool config(IPAddress local_ip, IPAddress, IPAddress, IPAddress = (uint32_t)0, IPAddress = (uint32_t)0)
+  {
+    configCount++;
+    configIP = (uint32_t)local_ip;
+    return true;
+  }
+  bool disconnect(bool = false, bool = false)
+  {
+    disconnectCount++;
+    mockStatus = WL_DISCONNECTED;
+    return true;
+  }
+
+  wl_status_t status(void) { return mockStatus; }
+  String SSID(void) const { return mockSSID; }
+  uint8_t * BSSID(void) { return mockHasBSSID ? mockBSSID : NULL; }
+  String BSSIDstr(void) { return String(""); }
+  int8_t RSSI(void) { return -50; }
+  int32_t channel(void) { return mockChannel; }
+  IPAddress localIP(void) { return IPAddress(mockIP); }
+  IPAddress gatewayIP(void) { return IPAddress(mockGateway); }
+  IPAddress subnetMask(void) { return IPAddress(mockNetmask); }
+  IPAddress dnsIP(uint8_t = 0) { return IPAddress(mockDNS); }
+  uint8_t * macAddress(uint8_t * mac) { memset(mac, 0xAB, 6); return mac; }
+  String macAddress(void) { return String("AB:AB:AB:AB:AB:AB"); }
+
+  int16_t scanComplete(void) { return mockScan.size(); }
+  void scanDelete(void) {}
+  static void * getScanInfoByIndex(int i);
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,40 @@
+// Sustituto de esp_wifi.h con los tipos del escaneo. esp_wifi_scan_start()
+// sólo registra la llamada para que la prueba la verifique.
+#ifndef _YUBOX_HOST_ESP_WIFI_H_
+#define _YUBOX_HOST_ESP_WIFI_H_
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK    0
+#define ESP_FAIL  -1
+
+typedef enum { WIFI_MODE_NULL = 0, WIFI_MODE_STA, WIFI_MODE_AP, WIFI_MODE_APSTA, WIFI_MODE_MAX } wifi_mode_t;
+typedef enum { WIFI_AUTH_OPEN = 0, WIFI_AUTH_WEP, WIFI_AUTH_WPA_PSK, WIFI_AUTH_WPA2_PSK, WIFI_AUTH_WPA_WPA2_PSK, WIFI_AUTH_WPA2_ENTERPRISE, WIFI_AUTH_MAX } wifi_auth_mode_t;
+typedef enum { WIFI_SCAN_TYPE_ACTIVE = 0, WIFI_SCAN_TYPE_PASSIVE } wifi_scan_type_t;
+typedef struct { uint32_t min; uint32_t max; } wifi_active_scan_time_t;
+typedef struct { wifi_active_scan_time_t active; uint32_t passive; } wifi_scan_time_t;
+typedef struct {
+  uint8_t * ssid;
+  uint8_t * bssid;
+  uint8_t channel;
+  bool show_hidden;
+  wifi_scan_type_t scan_type;
+  wifi_scan_time_t scan_time;
+} wifi_scan_config_t;
+typedef struct {
+  uint8_t bssid[6];
+  uint8_t ssid[33];
+  uint8_t primary;
+  int second;
+  int8_t rssi;
+  wifi_auth_mode_t authmode;
+} wifi_ap_record_t;
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t * config, bool block);
+
+// Escaneos iniciados y canal del último (0 para todos los canales)
+extern unsigned int host_scanStarts;
+extern uint8_t host_scanChannel;
+
+#endif
@@ -0,0 +1,23 @@
+// Sustituto de esp_wpa2.h. Las funciones no hacen nada en el anfitrión.
+#ifndef _YUBOX_HOST_ESP_WPA2_H_
+#define _YUBOX_HOST_ESP_WPA2_H_
+
+#include "esp_wifi.h"
+
+typedef struct { int x; } esp_wpa2_config_t;
+#define WPA2_CONFIG_INIT_DEFAULT() { 0 }
+
+inline esp_err_t esp_wifi_sta_wpa2_ent_set_identity(const unsigned char *, int) { return ESP_OK; }
+inline esp_err_t esp_wifi_sta_wpa2_ent_set_username(const unsigned char *, int) { return ESP_OK; }
+inline esp_err_t esp_wifi_sta_wpa2_ent_set_password(const unsigned char *, int) { return ESP_OK; }
+inline esp_err_t esp_wifi_sta_wpa2_ent_set_new_password(const unsigned char *, int) { return ESP_OK; }
+inline void esp_wifi_sta_wpa2_ent_clear_identity(void) {}
+inline void esp_wifi_sta_wpa2_ent_clear_username(void) {}
+inline void esp_wifi_sta_wpa2_ent_clear_password(void) {}
+inline void esp_wifi_sta_wpa2_ent_clear_new_password(void) {}
+inline void esp_wifi_sta_wpa2_ent_clear_ca_cert(void) {}
+inline void esp_wifi_sta_wpa2_ent_clear_cert_key(void) {}
+inline esp_err_t esp_wifi_sta_wpa2_ent_enable(const esp_wpa2_config_t *) { return ESP_OK; }
+inline esp_err_t esp_wifi_sta_wpa2_ent_disable(void) { return ESP_OK; }
+
+#endif
@@ -0,0 +1,24 @@
+// Sustituto de FreeRTOS.h. Las pruebas corren en un solo hilo, así que las
+// secciones críticas no hacen nada.
+#ifndef _YUBOX_HOST_FREERTOS_H_
+#define _YUBOX_HOST_FREERTOS_H_
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  1
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define portMAX_DELAY 0xffffffffUL
+
+typedef struct { uint32_t owner; uint32_t count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+#define vPortCPUInitializeMutex(m) do {} while (0)
+#define portENTER_CRITICAL(m) do {} while (0)
+#define portEXIT_CRITICAL(m) do {} while (0)
+
+#endif
@@ -0,0 +1,9 @@
+// Sustituto de semphr.h, sólo el tipo que aparece en los encabezados
+#ifndef _YUBOX_HOST_SEMPHR_H_
+#define _YUBOX_HOST_SEMPHR_H_
+
+#include "FreeRTOS.h"
+
+typedef void * SemaphoreHandle_t;
+
+#endif
@@ -0,0 +1,18 @@
+// Sustituto de timers.h. Los temporizadores no disparan solos: la prueba
+// consulta si están activos y puede invocar su callback.
+#ifndef _YUBOX_HOST_TIMERS_H_
+#define _YUBOX_HOST_TIMERS_H_
+
+#include "FreeRTOS.h"
+
+typedef void * TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+TimerHandle_t xTimerCreate(const char *, TickType_t, UBaseType_t, void *, TimerCallbackFunction_t);
+BaseType_t xTimerStart(TimerHandle_t, TickType_t);
+BaseType_t xTimerStop(TimerHandle_t, TickType_t);
+BaseType_t xTimerChangePeriod(TimerHandle_t, TickType_t, TickType_t);
+BaseType_t xTimerIsTimerActive(TimerHandle_t);
+void * pvTimerGetTimerID(TimerHandle_t);
+
+#endif
@@ -0,0 +1,406 @@
+/*
+ * Prueba en el anfitrión (PC) de la conexión directa al arranque de
+ * YuboxWiFiClass. Compila el mismo src/YuboxWiFiClass.cpp del firmware contra
+ * un controlador WiFi y una NVRAM simulados en host/, y recorre los casos que
+ * no se pueden forzar de forma repetible con un AP real.
+ *
+ * Compilar y ejecutar desde este directorio, sin y con IP estática:
+ *
+ *   g++ -std=gnu++11 -Ihost -I../../src -o wifi-fastconnect-test \
+ *     wifi-fastconnect-test.cpp ../../src/YuboxWiFiClass.cpp
+ *   ./wifi-fastconnect-test
+ *
+ *   g++ -std=gnu++11 -DYUBOX_WIFI_FAST_STATIC_IP=1 -Ihost -I../../src -o wifi-fastconnect-test \
+ *     wifi-fastconnect-test.cpp ../../src/YuboxWiFiClass.cpp
+ *   ./wifi-fastconnect-test
+ *
+ * El programa termina con código distinto de 0 si falla alguna verificación.
+ */
+#include <Arduino.h>
+#include <ESPmDNS.h>
+
+#include "YuboxWiFiClass.h"
+#include "YuboxJSONSchema.h"
+#include "YuboxResponseCacheClass.h"
+#include "YuboxStatusClass.h"
+#include "YuboxMetricsClass.h"
+
+#include <map>
+
+// Estado de los sustitutos de host/
+unsigned long host_millis = 0;
+unsigned int host_scanStarts = 0;
+uint8_t host_scanChannel = 0;
+WiFiClass WiFi;
+MDNSResponder MDNS;
+fs::SPIFFSFS SPIFFS;
+std::map<std::string, std::string> Preferences::store;
+std::map<std::string, unsigned int> Preferences::writes;
+
+void * WiFiClass::getScanInfoByIndex(int i)
+{
+  return (i >= 0 && i < WiFi.mockScan.size()) ? &(WiFi.mockScan[i]) : NULL;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t * config, bool)
+{
+  host_scanStarts++;
+  host_scanChannel = config->channel;
+  return ESP_OK;
+}
+
+struct host_timer_t
+{
+  bool active;
+  void * id;
+};
+
+TimerHandle_t xTimerCreate(const char *, TickType_t, UBaseType_t, void * id, TimerCallbackFunction_t)
+{
+  host_timer_t * t = new host_timer_t;
+  t->active = false;
+  t->id = id;
+  return t;
+}
+BaseType_t xTimerStart(TimerHandle_t t, TickType_t) { ((host_timer_t *)t)->active = true; return pdPASS; }
+BaseType_t xTimerStop(TimerHandle_t t, TickType_t) { ((host_timer_t *)t)->active = false; return pdPASS; }
+BaseType_t xTimerChangePeriod(TimerHandle_t t, TickType_t, TickType_t) { ((host_timer_t *)t)->active = true; return pdPASS; }
+BaseType_t xTimerIsTimerActive(TimerHandle_t t) { return ((host_timer_t *)t)->active ? pdTRUE : pdFALSE; }
+void * pvTimerGetTimerID(TimerHandle_t t) { return ((host_timer_t *)t)->id; }
+
+// Sólo se definen los miembros que YuboxWiFiClass.cpp referencia. El
+// enrutador guarda los manejadores para que la prueba pueda invocarlos.
+static std::map<std::string, ArRequestHandlerFunction> routes;
+
+YuboxRouterClass::YuboxRouterClass(void) {}
+void YuboxRouterClass::begin(AsyncWebServer &) {}
+void YuboxRouterClass::on(const char * uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn)
+{
+  routes[std::to_string(method) + " " + uri] = fn;
+}
+void YuboxRouterClass::onCaptures(const char *, WebRequestMethodComposite, YuboxRouteHandlerFunction) {}
+bool YuboxRouterClass::canHandle(AsyncWebServerRequest *) { return false; }
+void YuboxRouterClass::handleRequest(AsyncWebServerRequest *) {}
+void YuboxRouterClass::handleUpload(AsyncWebServerRequest *, const String &, size_t, uint8_t *, size_t, bool) {}
+void YuboxRouterClass::handleBody(AsyncWebServerRequest *, uint8_t *, size_t, size_t, size_t) {}
+YuboxRouterClass YuboxRouter;
+
+const char * YuboxURLCaptures::get(const char *) const { return NULL; }
+
+YuboxWebAuthClass::YuboxWebAuthClass(void) {}
+bool YuboxWebAuthClass::authenticate(AsyncWebServerRequest *) { return true; }
+AsyncWebHandler & YuboxWebAuthClass::addManagedHandler(AsyncWebHandler * handler) { return *handler; }
+YuboxWebAuthClass YuboxWebAuth;
+
+YuboxMetricsClass::YuboxMetricsClass(void) {}
+AsyncWebHandler * YuboxMetricsClass::wrap(AsyncWebHandler * handler, const char *, bool) { return handler; }
+YuboxMetricsClass YuboxMetrics;
+
+YuboxStatusClass::YuboxStatusClass(void) {}
+void YuboxStatusClass::begin(AsyncWebServer &) {}
+void YuboxStatusClass::addProvider(const char *, YuboxStatusProvider) {}
+YuboxStatusClass YuboxStatus;
+
+YuboxResponseCacheClass::YuboxResponseCacheClass(void) {}
+bool YuboxResponseCacheClass::send(AsyncWebServerRequest *, const char *, uint32_t &) { return false; }
+void YuboxResponseCacheClass::storeAndSend(AsyncWebServerRequest *, const char *, uint32_t, const char *, const char *, size_t) {}
+void YuboxResponseCacheClass::invalidate(const char *) {}
+YuboxResponseCacheClass YuboxResponseCache;
+
+YuboxWebSocketMuxClass::YuboxWebSocketMuxClass(void) {}
+void YuboxWebSocketMuxClass::begin(AsyncWebServer &) {}
+void YuboxWebSocketMuxClass::bridge(YuboxEventSource &, const char *) {}
+YuboxWebSocketMuxClass YuboxWebSocketMux;
+
+YuboxEventSource::YuboxEventSource(const String & url, YuboxEventSourcePolicy) : _url(url) {}
+YuboxEventSource::~YuboxEventSource() {}
+bool YuboxEventSource::canHandle(AsyncWebServerRequest *) { return false; }
+void YuboxEventSource::handleRequest(AsyncWebServerRequest *) {}
+size_t YuboxEventSource::count(void) const { return 0; }
+void YuboxEventSource::send(const char *, const char *, uint32_t, uint32_t) {}
+void YuboxEventSourceClient::send(const char *, const char *, uint32_t, uint32_t) {}
+
+void * YuboxJSONPool::allocate(size_t n) { return malloc(n); }
+void YuboxJSONPool::deallocate(void * p) { free(p); }
+
+YuboxJSONWriter::YuboxJSONWriter(char * buf, size_t size) : _buf(buf), _size(size), _len(0) {}
+YuboxJSONWriter & YuboxJSONWriter::beginObject(void) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::endObject(void) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::beginArray(void) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::endArray(void) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::key(const char *) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::value(const char *) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::value(bool) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::value(int) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::value(unsigned int) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::value(unsigned long) { return *this; }
+YuboxJSONWriter & YuboxJSONWriter::valueNull(void) { return *this; }
+AsyncWebServerResponse * YuboxJSONWriter::beginArrayResponse(AsyncWebServerRequest *, ArrayItemWriter) { return NULL; }
+
+static unsigned int failures = 0;
+
+#define CHECK(cond) do { \
+  if (!(cond)) { printf("  FALLA %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+static const uint8_t savedBSSID[6] = { 0x24, 0x0A, 0xC4, 0x11, 0x22, 0x33 };
+
+static YuboxWiFi_fastconn savedFast(void)
+{
+  YuboxWiFi_fastconn fast;
+  memset(&fast, 0, sizeof(fast));
+  memcpy(fast.bssid, savedBSSID, 6);
+  fast.channel = 6;
+  fast.ip = IPAddress(192, 168, 1, 50);
+  fast.gateway = IPAddress(192, 168, 1, 1);
+  fast.netmask = IPAddress(255, 255, 255, 0);
+  fast.dns = IPAddress(192, 168, 1, 1);
+  return fast;
+}
+
+static YuboxWiFi_fastconn storedFast(void)
+{
+  YuboxWiFi_fastconn fast;
+  Preferences nvram;
+  if (nvram.getBytes("net/1/fast", &fast, sizeof(fast)) != sizeof(fast)) memset(&fast, 0, sizeof(fast));
+  return fast;
+}
+
+// NVRAM con una red guardada, usada con éxito en el arranque anterior
+static void seedNVRAM(void)
+{
+  YuboxWiFi_fastconn fast = savedFast();
+  Preferences nvram;
+
+  Preferences::mockReset();
+  nvram.putUInt("net/n", 1);
+  nvram.putString("net/1/ssid", "Oficina");
+  nvram.putString("net/1/psk", "clave-oficina");
+  nvram.putBool("net/1/lastsel", true);
+  nvram.putBytes("net/1/fast", &fast, sizeof(fast));
+  Preferences::writes.clear();
+}
+
+// Arranque del dispositivo con la NVRAM actual
+static YuboxWiFiClass * boot(AsyncWebServer & srv)
+{
+  WiFi.mockReset();
+  host_scanStarts = 0;
+  host_scanChannel = 0;
+  routes.clear();
+
+  YuboxWiFiClass * w = new YuboxWiFiClass();
+  w->begin(srv);
+  return w;
+}
+
+// Simula la asociación y la concesión DHCP con los datos indicados
+static void gotIP(const uint8_t * bssid, int32_t channel, uint32_t ip)
+{
+  WiFi.mockStatus = WL_CONNECTED;
+  WiFi.mockSSID = "Oficina";
+  memcpy(WiFi.mockBSSID, bssid, 6);
+  WiFi.mockHasBSSID = true;
+  WiFi.mockChannel = channel;
+  WiFi.mockIP = ip;
+  WiFi.mockGateway = IPAddress(192, 168, 1, 1);
+  WiFi.mockNetmask = IPAddress(255, 255, 255, 0);
+  WiFi.mockDNS = IPAddress(192, 168, 1, 1);
+  WiFi.mockEvent(SYSTEM_EVENT_STA_GOT_IP);
+}
+
+static void testDisconnectFallsBackToScan(AsyncWebServer & srv)
+{
+  printf("STA_DISCONNECTED durante conexión directa recurre al escaneo\n");
+  seedNVRAM();
+  boot(srv);
+
+  // Conexión directa al AP y canal guardados, sin escaneo previo
+  CHECK(WiFi.beginCount == 1);
+  CHECK(WiFi.beginSSID == "Oficina");
+  CHECK(WiFi.beginChannel == 6);
+  CHECK(WiFi.beginHasBSSID && memcmp(WiFi.beginBSSID, savedBSSID, 6) == 0);
+  CHECK(host_scanStarts == 0);
+
+  // El AP no responde en su canal
+  WiFi.mockEvent(SYSTEM_EVENT_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+  CHECK(host_scanStarts == 1);
+  CHECK(host_scanChannel == 0);
+  CHECK(WiFi.beginCount == 1);
+
+  // El AP se movió al canal 11. El escaneo lo encuentra y la conexión ya no
+  // fija canal ni AP.
+  wifi_ap_record_t ap;
+  memset(&ap, 0, sizeof(ap));
+  memcpy(ap.bssid, savedBSSID, 6);
+  strcpy((char *)ap.ssid, "Oficina");
+  ap.primary = 11;
+  ap.rssi = -60;
+  ap.authmode = WIFI_AUTH_WPA2_PSK;
+  WiFi.mockScan.push_back(ap);
+  WiFi.mockEvent(SYSTEM_EVENT_SCAN_DONE);
+  CHECK(WiFi.beginCount == 2);
+  CHECK(WiFi.beginSSID == "Oficina");
+  CHECK(WiFi.beginPSK == "clave-oficina");
+  CHECK(WiFi.beginChannel == 0);
+  CHECK(!WiFi.beginHasBSSID);
+
+  // Una desconexión luego de la conexión directa ya no lanza otro escaneo
+  // por su cuenta
+  gotIP(savedBSSID, 11, IPAddress(192, 168, 1, 50));
+  WiFi.mockStatus = WL_DISCONNECTED;
+  WiFi.mockEvent(SYSTEM_EVENT_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+  CHECK(host_scanStarts == 1);
+}
+
+static void testStaticIPRevertedToDHCP(AsyncWebServer & srv)
+{
+  printf("IP estática de conexión directa vuelve a DHCP al fallar (YUBOX_WIFI_FAST_STATIC_IP=%d)\n",
+    YUBOX_WIFI_FAST_STATIC_IP);
+  seedNVRAM();
+  boot(srv);
+
+#if YUBOX_WIFI_FAST_STATIC_IP
+  // La concesión anterior se fija antes de asociarse
+  CHECK(WiFi.configCount == 1);
+  CHECK(WiFi.configIP == (uint32_t)IPAddress(192, 168, 1, 50));
+
+  WiFi.mockEvent(SYSTEM_EVENT_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+  CHECK(WiFi.configCount == 2);
+  CHECK(WiFi.configIP == 0);
+#else
+  // Sin la opción nunca se toca la configuración IP
+  WiFi.mockEvent(SYSTEM_EVENT_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+  CHECK(WiFi.configCount == 0);
+#endif
+}
+
+static void testFastBlobWrittenOnlyOnChange(AsyncWebServer & srv)
+{
+  printf("net/N/fast se escribe sólo si cambió\n");
+  seedNVRAM();
+  boot(srv);
+
+  // Mismo AP, canal y concesión que los guardados
+  gotIP(savedBSSID, 6, IPAddress(192, 168, 1, 50));
+  CHECK(Preferences::writes["net/1/fast"] == 0);
+  CHECK(Preferences::writes["net/1/lastsel"] == 0);
+
+  // Reconexión idéntica, tampoco escribe
+  WiFi.mockEvent(SYSTEM_EVENT_STA_GOT_IP);
+  CHECK(Preferences::writes["net/1/fast"] == 0);
+
+  // El AP cambió de canal
+  gotIP(savedBSSID, 1, IPAddress(192, 168, 1, 50));
+  CHECK(Preferences::writes["net/1/fast"] == 1);
+  CHECK(storedFast().channel == 1);
+
+  // Nueva concesión DHCP en el mismo canal
+  gotIP(savedBSSID, 1, IPAddress(192, 168, 1, 77));
+  CHECK(Preferences::writes["net/1/fast"] == 2);
+  CHECK(storedFast().ip == (uint32_t)IPAddress(192, 168, 1, 77));
+}
+
+static void testCredentialUpdateKeepsFastData(AsyncWebServer & srv)
+{
+  printf("Actualizar credenciales conserva los datos de conexión directa\n");
+  seedNVRAM();
+  boot(srv);
+
+  auto it = routes.find(std::to_string(HTTP_PUT) + " /yubox-api/wificonfig/connection");
+  CHECK(it != routes.end());
+  if (it == routes.end()) return;
+
+  AsyncWebServerRequest req;
+  req.addParam("ssid", "Oficina");
+  req.addParam("authmode", "3");
+  req.addParam("psk", "clave-nueva-123");
+  it->second(&req);
+  CHECK(req.sentCode == 202);
+
+  YuboxWiFi_fastconn fast = savedFast();
+  YuboxWiFi_fastconn stored = storedFast();
+  CHECK(Preferences::store["net/1/psk"] == "clave-nueva-123");
+  CHECK(memcmp(&stored, &fast, sizeof(fast)) == 0);
+
+  // El siguiente arranque usa la conexión directa con la clave nueva
+  boot(srv);
+  CHECK(WiFi.beginCount == 1);
+  CHECK(WiFi.beginPSK == "clave-nueva-123");
+  CHECK(WiFi.beginChannel == 6);
+  CHECK(WiFi.beginHasBSSID && memcmp(WiFi.beginBSSID, savedBSSID, 6) == 0);
+  CHECK(host_scanStarts == 0);
+}
+
+static void testScanPolicyPUT(AsyncWebServer & srv)
+{
+  printf("PUT de política de escaneo valida igual que setScanPolicy()\n");
+  seedNVRAM();
+  YuboxWiFiClass * wifi = boot(srv);
+
+  auto it = routes.find(std::to_string(HTTP_PUT) + " /yubox-api/wificonfig/scanpolicy");
+  CHECK(it != routes.end());
+  if (it == routes.end()) return;
+  CHECK(routes.count(std::to_string(HTTP_GET) + " /yubox-api/wificonfig/scanpolicy") == 1);
+
+  YuboxWiFi_scanPolicy before = wifi->getScanPolicy();
+  const char * rejected[][2] = {
+    { "min_interval", "0" },
+    { "ui_interval", "0" },
+    { "max_interval", "1" },
+    { "full_scan_every", "0" },
+    { "full_scan_every", "256" },
+    { "budget_percent", "101" },
+    { "dwell_time", "65536" },
+    { "refresh_passive", "2" },
+    { "min_interval", "-5" },
+    { "min_interval", "10x" },
+    { "min_interval", "" },
+  };
+  for (auto & r : rejected) {
+    AsyncWebServerRequest req;
+    req.addParam(r[0], r[1]);
+    it->second(&req);
+    CHECK(req.sentCode == 400);
+  }
+  YuboxWiFi_scanPolicy after = wifi->getScanPolicy();
+  CHECK(after.uiInterval == before.uiInterval);
+  CHECK(after.minInterval == before.minInterval);
+  CHECK(after.maxInterval == before.maxInterval);
+  CHECK(after.fullScanEvery == before.fullScanEvery);
+  CHECK(after.budgetPercent == before.budgetPercent);
+  CHECK(after.refreshPassive == before.refreshPassive);
+
+  // Actualización parcial: los parámetros omitidos conservan su valor
+  AsyncWebServerRequest req;
+  req.addParam("max_interval", "120000");
+  req.addParam("budget_percent", "0");
+  req.addParam("refresh_passive", "1");
+  it->second(&req);
+  CHECK(req.sentCode == 202);
+  after = wifi->getScanPolicy();
+  CHECK(after.maxInterval == 120000);
+  CHECK(after.budgetPercent == 0);
+  CHECK(after.refreshPassive);
+  CHECK(after.minInterval == before.minInterval);
+  CHECK(after.dwellTime == before.dwellTime);
+  CHECK(after.fullScanEvery == before.fullScanEvery);
+}
+
+int main(void)
+{
+  AsyncWebServer srv;
+
+  testDisconnectFallsBackToScan(srv);
+  testStaticIPRevertedToDHCP(srv);
+  testFastBlobWrittenOnlyOnChange(srv);
+  testCredentialUpdateKeepsFastData(srv);
+  testScanPolicyPUT(srv);
+
+  if (failures > 0) {
+    printf("%u verificaciones fallidas\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
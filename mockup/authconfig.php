@@ -3,6 +3,16 @@ define ('MOCKUP_AUTH', '/tmp/auth.json');
 
 Header('Content-Type: application/json');
 
+// El mockup no maneja autenticación, la sesión se reporta como no habilitada
+if (isset($_SERVER['PATH_INFO']) && $_SERVER['PATH_INFO'] == '/session') {
+    print json_encode(array(
+        'success'   =>  TRUE,
+        'msg'       =>  'Sesiones no habilitadas',
+        'ttl'       =>  0,
+    ));
+    exit();
+}
+
 switch ($_SERVER['REQUEST_METHOD']) {
 case 'POST':
     if ($_POST['password1'] != $_POST['password2']) {
@@ -31,6 +31,9 @@ switch ($path_info) {
     case '/networks':
         handle_networks($ssid);
         break;
+    case '/roaming':
+        handle_roaming();
+        break;
     default:
         Header('HTTP/1.1 404 Not Found');
         print json_encode(array(
@@ -75,6 +78,8 @@ function handle_connection()
             'netmask'   =>  NULL,
             'dns'       =>  array(),
             //'linkspeed'
+            'boot_to_ip_ms' =>  412,
+            'fastconnect'   =>  TRUE,
         );
 
         // Sólo para mockup. Averiguar cuál interfaz reportar
@@ -287,12 +292,60 @@ function handle_netscan()
     Header('X-Accel-Buffering: no');
 
     sse_event(json_encode(array('yubox_control_wifi' => TRUE)), 'WiFiStatus');
-    sse_event(_buildAvailableNetworksJSONReport(), 'WiFiScanResult');
+    // Lista completa al conectarse, y luego sólo los cambios de cada escaneo
+    $seq = 1;
+    $prev = json_decode(_buildAvailableNetworksJSONReport(), TRUE);
+    sse_event(json_encode(array('seq' => $seq, 'networks' => $prev)), 'WiFiScanResult');
 
     while (connection_status() == CONNECTION_NORMAL) {
         sleep(2);   // Simular retraso en escaneo
-        sse_event(_buildAvailableNetworksJSONReport(), 'WiFiScanResult');
+        $scan = json_decode(_buildAvailableNetworksJSONReport(), TRUE);
+        $diff = _buildScanDiff($prev, $scan);
+        if (count($diff['added']) + count($diff['changed']) + count($diff['removed']) > 0) {
+            $diff = array_merge(array('seq' => $seq + 1, 'base' => $seq), $diff);
+            sse_event(json_encode($diff), 'WiFiScanDiff');
+            $seq++;
+        }
+    }
+}
+
+function handle_roaming()
+{
+    print json_encode(array(
+        'enabled'   =>  FALSE,
+        'inhibited' =>  FALSE,
+        'scans'     =>  0,
+        'attempts'  =>  0,
+        'roams'     =>  0,
+        'btm'       =>  0,
+        'failures'  =>  0,
+        'last'      =>  NULL,
+    ));
+}
+
+function _buildScanDiff(&$prev, $scan)
+{
+    $old = array();
+    foreach ($prev as $net) $old[$net['bssid']] = $net;
+
+    $diff = array('added' => array(), 'changed' => array(), 'removed' => array());
+    foreach ($scan as $i => $net) {
+        if (!isset($old[$net['bssid']])) {
+            $diff['added'][] = $net;
+        } else {
+            $o = $old[$net['bssid']];
+            unset($old[$net['bssid']]);
+            if (abs($o['rssi'] - $net['rssi']) < 4) {
+                // Variación menor de RSSI, se conserva el valor anterior
+                $net['rssi'] = $o['rssi'];
+                $scan[$i] = $net;
+            }
+            if ($o != $net) $diff['changed'][] = $net;
+        }
     }
+    $diff['removed'] = array_keys($old);
+    $prev = $scan;
+    return $diff;
 }
 
 function _buildAvailableNetworksJSONReport()
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Servidor de imitación de los endpoints OTA de un YUBOX, para probar
+# herramientas como yubox-fleet-ota-upload sin disponer de equipos reales.
+# Se pueden levantar varios "equipos" a la vez en puertos consecutivos, y
+# simular vetos y fallos con una probabilidad configurable.
+
+import sys
+import json
+import time
+import base64
+import random
+import argparse
+import threading
+import http.server
+
+parser = argparse.ArgumentParser(description='Imitación de endpoints OTA de YUBOX')
+parser.add_argument('--port', type=int, default=8080, help='Primer puerto a escuchar (por omisión 8080)')
+parser.add_argument('--count', type=int, default=1, help='Número de equipos a simular en puertos consecutivos (por omisión 1)')
+parser.add_argument('--user', default='admin', help='Usuario esperado (por omisión admin)')
+parser.add_argument('--password', default='yubox', help='Contraseña esperada (por omisión yubox)')
+parser.add_argument('--veto-rate', type=float, default=0.0, help='Probabilidad de vetar una carga o reinicio (0.0 a 1.0)')
+parser.add_argument('--fail-rate', type=float, default=0.0, help='Probabilidad de fallar una carga (0.0 a 1.0)')
+parser.add_argument('--throughput', type=int, default=65536, help='Bytes por segundo a simular en la escritura (por omisión 65536)')
+args = parser.parse_args()
+
+class YuboxStubDevice:
+    def __init__(self, port):
+        self.port = port
+        self.lock = threading.Lock()
+        self.listeners = []
+        self.canrollback = False
+
+    def emit(self, evname, data):
+        msg = 'event: {0}\ndata: {1}\n\n'.format(evname, json.dumps(data)).encode('utf-8')
+        with self.lock:
+            listeners = list(self.listeners)
+        for wfile in listeners:
+            try:
+                wfile.write(msg)
+                wfile.flush()
+            except OSError:
+                with self.lock:
+                    if wfile in self.listeners:
+                        self.listeners.remove(wfile)
+
+class YuboxStubHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.0'
+
+    def log_message(self, fmt, *a):
+        sys.stderr.write('[{0}] {1}\n'.format(self.server.device.port, fmt % a))
+
+    def _sendJSON(self, code, obj):
+        body = json.dumps(obj).encode('utf-8')
+        self.send_response(code)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def _checkAuth(self):
+        expected = 'Basic ' + base64.b64encode('{0}:{1}'.format(args.user, args.password).encode('utf-8')).decode('ascii')
+        if self.headers.get('Authorization') == expected:
+            return True
+        self.send_response(401)
+        self.send_header('WWW-Authenticate', 'Basic realm="Login Required"')
+        self.send_header('Content-Length', '0')
+        self.end_headers()
+        return False
+
+    def do_GET(self):
+        if not self._checkAuth():
+            return
+        dev = self.server.device
+        if self.path == '/yubox-api/yuboxOTA/firmwarelist.json':
+            self._sendJSON(200, [{
+                'tag': 'esp32',
+                'desc': 'YUBOX ESP32 Firmware',
+                'tgzupload': '/yubox-api/yuboxOTA/esp32/tgzupload',
+                'rollback': '/yubox-api/yuboxOTA/esp32/rollback',
+            }])
+        elif self.path == '/yubox-api/yuboxOTA/esp32/rollback':
+            self._sendJSON(200, { 'canrollback': dev.canrollback })
+        elif self.path == '/yubox-api/yuboxOTA/events':
+            self.send_response(200)
+            self.send_header('Content-Type', 'text/event-stream')
+            self.send_header('Cache-Control', 'no-cache')
+            self.end_headers()
+            self.wfile.write(b'retry: 1000\n\n')
+            self.wfile.flush()
+            with dev.lock:
+                dev.listeners.append(self.wfile)
+            # Mantener la conexión abierta hasta que el cliente la cierre
+            try:
+                while self.rfile.read(1):
+                    pass
+            except OSError:
+                pass
+            with dev.lock:
+                if self.wfile in dev.listeners:
+                    dev.listeners.remove(self.wfile)
+        else:
+            self._sendJSON(404, { 'success': False, 'msg': 'Ruta no implementada' })
+
+    def do_POST(self):
+        if not self._checkAuth():
+            return
+        dev = self.server.device
+        length = int(self.headers.get('Content-Length', '0'))
+        if self.path == '/yubox-api/yuboxOTA/esp32/tgzupload':
+            if random.random() < args.veto_rate:
+                self.rfile.read(length)
+                self._sendJSON(500, { 'success': False, 'msg': 'Actualización vetada por componente simulado' })
+                return
+            # Se simula la escritura de un único archivo con el contenido
+            # subido, emitiendo eventos como lo haría el equipo real.
+            dev.emit('uploadFileStart', {
+                'event': 'uploadFileStart', 'filename': 'firmware.ino.bin', 'firmware': True, 'total': length, 'currupload': 0 })
+            received = 0
+            lastev = 0
+            while received < length:
+                blk = self.rfile.read(min(4096, length - received))
+                if not blk:
+                    break
+                received += len(blk)
+                time.sleep(len(blk) / float(args.throughput))
+                if time.time() - lastev >= 0.2:
+                    lastev = time.time()
+                    dev.emit('uploadFileProgress', {
+                        'event': 'uploadFileProgress', 'filename': 'firmware.ino.bin', 'firmware': True,
+                        'current': received, 'total': length, 'currupload': received })
+            dev.emit('uploadFileEnd', {
+                'event': 'uploadFileEnd', 'filename': 'firmware.ino.bin', 'firmware': True, 'total': received, 'currupload': received })
+            if received < length or random.random() < args.fail_rate:
+                self._sendJSON(500, { 'success': False, 'msg': 'Fallo simulado al escribir firmware' })
+                return
+            dev.canrollback = True
+            self._sendJSON(200, {
+                'success': True,
+                'msg': 'Firmware actualizado correctamente. El equipo se reiniciará en unos momentos.',
+                'reboot': True
+            })
+        elif self.path == '/yubox-api/yuboxOTA/reboot':
+            self.rfile.read(length)
+            if random.random() < args.veto_rate:
+                self._sendJSON(500, { 'success': False, 'msg': 'Reinicio vetado por componente simulado' })
+                return
+            self._sendJSON(200, { 'success': True, 'msg': 'El equipo se reiniciará en unos momentos.' })
+        elif self.path == '/yubox-api/yuboxOTA/esp32/rollback':
+            self.rfile.read(length)
+            self._sendJSON(200, { 'success': dev.canrollback, 'msg': 'Rollback simulado' })
+        else:
+            self.rfile.read(length)
+            self._sendJSON(404, { 'success': False, 'msg': 'Ruta no implementada' })
+
+servers = []
+for i in range(args.count):
+    srv = http.server.ThreadingHTTPServer(('127.0.0.1', args.port + i), YuboxStubHandler)
+    srv.daemon_threads = True
+    srv.device = YuboxStubDevice(args.port + i)
+    threading.Thread(target=srv.serve_forever, daemon=True).start()
+    servers.append(srv)
+    print('127.0.0.1:{0}'.format(args.port + i))
+sys.stdout.flush()
+
+try:
+    while True:
+        time.sleep(3600)
+except KeyboardInterrupt:
+    pass
@@ -0,0 +1,288 @@
+#include <Arduino.h>
+#include "SPIFFS.h"
+
+#include "YuboxAssetBundleHandler.h"
+#include "YuboxWebAuthClass.h"
+#include "YuboxGzipClass.h"
+
+YuboxAssetBundleHandler::YuboxAssetBundleHandler(const char * partlabel)
+ : AsyncWebHandler(), _partlabel(partlabel), _defaultFile("index.htm")
+{
+  _mmap_handle = 0;
+  _base = NULL;
+  _index = NULL;
+  _count = 0;
+  _generation = 0;
+  _stale = false;
+}
+
+YuboxAssetBundleHandler::~YuboxAssetBundleHandler()
+{
+  end();
+}
+
+bool YuboxAssetBundleHandler::begin(void)
+{
+  const esp_partition_t * part;
+  yubox_bundle_header_t hdr;
+  esp_err_t err;
+
+  end();
+
+  part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, _partlabel.c_str());
+  if (part == NULL) {
+    log_d("no existe partición %s, no se usa bundle", _partlabel.c_str());
+    return false;
+  }
+
+  // Se lee primero la cabecera para mapear únicamente lo ocupado por el bundle
+  err = esp_partition_read(part, 0, &hdr, sizeof(hdr));
+  if (err != ESP_OK) {
+    log_e("fallo al leer cabecera de bundle (err=%d)", err);
+    return false;
+  }
+  if (memcmp(hdr.magic, YUBOX_BUNDLE_MAGIC, 4) != 0) {
+    log_w("partición %s no contiene un bundle válido", _partlabel.c_str());
+    return false;
+  }
+  if (hdr.version != YUBOX_BUNDLE_VERSION) {
+    log_w("versión de bundle no soportada: %u", hdr.version);
+    return false;
+  }
+  if (hdr.size > part->size || hdr.strtab > hdr.size
+    || sizeof(hdr) + hdr.count * sizeof(yubox_bundle_entry_t) > hdr.strtab) {
+    log_w("bundle inconsistente con tamaño de partición (%u > %u)", hdr.size, part->size);
+    return false;
+  }
+
+  const void * p;
+  err = esp_partition_mmap(part, 0, hdr.size, SPI_FLASH_MMAP_DATA, &p, &_mmap_handle);
+  if (err != ESP_OK) {
+    log_e("fallo al mapear bundle de %u bytes (err=%d)", hdr.size, err);
+    _mmap_handle = 0;
+    return false;
+  }
+  _base = (const uint8_t *)p;
+  _index = (const yubox_bundle_entry_t *)(_base + sizeof(hdr));
+  _count = hdr.count;
+
+  for (auto i = 0; i < _count; i++) {
+    if (_index[i].path_offset + _index[i].path_len > hdr.size || _index[i].data_offset + _index[i].data_len > hdr.size) {
+      log_w("entrada %d de bundle fuera de rango, se descarta bundle", i);
+      end();
+      return false;
+    }
+  }
+
+  int idxManifest = _findEntry("manifest.txt", 12);
+  if (idxManifest >= 0) {
+    _manifest.parse(_base + _index[idxManifest].data_offset, _index[idxManifest].data_len);
+  }
+
+  _generation = YuboxAssetManifest::generation();
+  if (!_matchesFilesystemManifest()) {
+    log_w("bundle en %s no corresponde a manifest.txt de SPIFFS, se sirve desde SPIFFS", _partlabel.c_str());
+    end();
+    return false;
+  }
+
+  log_i("bundle en %s mapeado: %u archivos, %u bytes", _partlabel.c_str(), _count, hdr.size);
+  return true;
+}
+
+void YuboxAssetBundleHandler::end(void)
+{
+  if (_base != NULL) spi_flash_munmap(_mmap_handle);
+  _mmap_handle = 0;
+  _base = NULL;
+  _index = NULL;
+  _count = 0;
+  _stale = false;
+  _manifest.clear();
+}
+
+bool YuboxAssetBundleHandler::_matchesFilesystemManifest(void)
+{
+  // Una actualización OTA reemplaza los archivos de SPIFFS pero no el bundle.
+  // Si SPIFFS no tiene manifest.txt, el bundle es la única fuente de archivos.
+  if (!SPIFFS.exists("/manifest.txt")) return true;
+
+  int idx = _findEntry("manifest.txt", 12);
+  if (idx < 0) return false;
+
+  File h = SPIFFS.open("/manifest.txt", FILE_READ);
+  if (!h) return false;
+
+  const uint8_t * data = _base + _index[idx].data_offset;
+  uint32_t len = _index[idx].data_len;
+  bool match = (h.size() == len);
+  uint8_t buf[64];
+  uint32_t pos = 0;
+  while (match && pos < len) {
+    size_t r = h.read(buf, (len - pos > sizeof(buf)) ? sizeof(buf) : (len - pos));
+    if (r <= 0 || memcmp(buf, data + pos, r) != 0) match = false;
+    pos += r;
+  }
+  h.close();
+
+  return match;
+}
+
+int YuboxAssetBundleHandler::_findEntry(const char * path, size_t len)
+{
+  int lo = 0;
+  int hi = (int)_count - 1;
+
+  while (lo <= hi) {
+    int mid = (lo + hi) >> 1;
+    const yubox_bundle_entry_t & e = _index[mid];
+    size_t n = (e.path_len < len) ? e.path_len : len;
+    int c = memcmp(_base + e.path_offset, path, n);
+    if (c == 0) c = (e.path_len < len) ? -1 : ((e.path_len > len) ? 1 : 0);
+
+    if (c == 0) return mid;
+    if (c < 0) lo = mid + 1; else hi = mid - 1;
+  }
+  return -1;
+}
+
+int YuboxAssetBundleHandler::_findRequestEntry(AsyncWebServerRequest * request, const char * & encoding)
+{
+  char path[96];
+  const String & url = request->url();
+  size_t len;
+
+  // Se quita la barra inicial, y se agrega el archivo por omisión a directorios
+  const char * p = url.c_str();
+  if (*p == '/') p++;
+  len = strlen(p);
+  if (len == 0 || p[len - 1] == '/') {
+    if (len + _defaultFile.length() + 4 > sizeof(path)) return -1;
+    memcpy(path, p, len);
+    memcpy(path + len, _defaultFile.c_str(), _defaultFile.length());
+    len += _defaultFile.length();
+  } else {
+    if (len + 4 > sizeof(path)) return -1;
+    memcpy(path, p, len);
+  }
+
+  // Igual que serveStatic(), se prefiere el archivo tal cual, luego el .br si
+  // el cliente acepta brotli, y luego el .gz
+  encoding = NULL;
+  int idx = _findEntry(path, len);
+  if (idx < 0 && YuboxGzipClass::acceptsEncoding(request, "br")) {
+    memcpy(path + len, ".br", 3);
+    idx = _findEntry(path, len + 3);
+    if (idx >= 0) encoding = "br";
+  }
+  if (idx < 0) {
+    memcpy(path + len, ".gz", 3);
+    idx = _findEntry(path, len + 3);
+    if (idx >= 0) encoding = "gzip";
+  }
+  return idx;
+}
+
+void YuboxAssetBundleHandler::_checkGeneration(void)
+{
+  uint32_t gen = YuboxAssetManifest::generation();
+  if (gen == _generation) return;
+
+  // Una instalación de archivos de datos sin reinicio reemplazó el manifest de
+  // SPIFFS. El bundle no se desmapea, porque puede haber respuestas enviándose
+  // todavía desde la flash mapeada.
+  _generation = gen;
+  bool stale = !_matchesFilesystemManifest();
+  if (stale != _stale) {
+    if (stale) {
+      log_w("bundle en %s ya no corresponde a manifest.txt de SPIFFS, se sirve desde SPIFFS", _partlabel.c_str());
+    } else {
+      log_i("bundle en %s vuelve a corresponder a manifest.txt de SPIFFS", _partlabel.c_str());
+    }
+  }
+  _stale = stale;
+}
+
+bool YuboxAssetBundleHandler::canHandle(AsyncWebServerRequest * request)
+{
+  if (_base == NULL) return false;
+  if (request->method() != HTTP_GET) return false;
+  _checkGeneration();
+  if (_stale) return false;
+
+  // Las cabeceras aún no se han leído, así que aquí la búsqueda no considera
+  // el .br. Todo archivo .br tiene su .gz correspondiente.
+  const char * encoding;
+  if (_findRequestEntry(request, encoding) < 0) return false;
+
+  // Sin esto las cabeceras se descartan antes de llegar a handleRequest()
+  request->addInterestingHeader("If-None-Match");
+  request->addInterestingHeader("Accept-Encoding");
+  YuboxWebAuth.addInterestingHeaders(request);
+  return true;
+}
+
+void YuboxAssetBundleHandler::handleRequest(AsyncWebServerRequest * request)
+{
+  if ((_username != "" && _password != "") && !YuboxWebAuth.authenticate(request))
+    return request->requestAuthentication();
+
+  const char * encoding;
+  int idx = _findRequestEntry(request, encoding);
+  if (idx < 0) {
+    request->send(404);
+    return;
+  }
+
+  // El tipo de contenido se deduce de la ruta sin el .gz o .br
+  const yubox_bundle_entry_t & e = _index[idx];
+  const char * path = (const char *)(_base + e.path_offset);
+  size_t pathlen = (encoding != NULL) ? e.path_len - 3 : e.path_len;
+  const char * ctype = _contentTypeForPath(path, pathlen);
+
+  // Validadores de caché según el hash de contenido registrado en el manifest
+  char name[96];
+  const char * hash = NULL;
+  if (pathlen < sizeof(name)) {
+    memcpy(name, path, pathlen);
+    name[pathlen] = '\0';
+    _manifest.lookup(name, &hash);
+  }
+  if (YuboxAssetManifest::handleNotModified(request, hash, encoding)) return;
+
+  // El contenido se envía directamente desde la flash mapeada, sin copia previa a RAM
+  AsyncWebServerResponse * response = request->beginResponse_P(200, ctype, _base + e.data_offset, e.data_len);
+  if (encoding != NULL) response->addHeader("Content-Encoding", encoding);
+  YuboxAssetManifest::addCacheHeaders(request, response, hash, encoding);
+  request->send(response);
+}
+
+const char * YuboxAssetBundleHandler::_contentTypeForPath(const char * path, size_t len)
+{
+  static const struct { const char * ext; const char * ctype; } ctypes[] = {
+    { ".html",  "text/html" },
+    { ".htm",   "text/html" },
+    { ".css",   "text/css" },
+    { ".json",  "application/json" },
+    { ".js",    "application/javascript" },
+    { ".png",   "image/png" },
+    { ".gif",   "image/gif" },
+    { ".jpg",   "image/jpeg" },
+    { ".ico",   "image/x-icon" },
+    { ".svg",   "image/svg+xml" },
+    { ".eot",   "font/eot" },
+    { ".woff",  "font/woff" },
+    { ".woff2", "font/woff2" },
+    { ".ttf",   "font/ttf" },
+    { ".xml",   "text/xml" },
+    { ".pdf",   "application/pdf" },
+    { ".zip",   "application/zip" },
+    { ".gz",    "application/x-gzip" },
+  };
+
+  for (auto i = 0; i < sizeof(ctypes) / sizeof(ctypes[0]); i++) {
+    size_t n = strlen(ctypes[i].ext);
+    if (len >= n && memcmp(path + len - n, ctypes[i].ext, n) == 0) return ctypes[i].ctype;
+  }
+  return "text/plain";
+}
@@ -0,0 +1,79 @@
+#ifndef _YUBOX_ASSET_BUNDLE_HANDLER_H_
+#define _YUBOX_ASSET_BUNDLE_HANDLER_H_
+
+#include <ESPAsyncWebServer.h>
+
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+
+#include "YuboxAssetManifest.h"
+
+// Formato del bundle generado por "yubox-framework-assemble --bundle". Todos
+// los valores son little-endian. Tras la cabecera sigue el índice de entradas
+// ordenado por ruta (comparación byte a byte), luego la tabla de rutas, y
+// luego el contenido de los archivos, cada uno alineado a 4 bytes.
+#define YUBOX_BUNDLE_MAGIC    "YBXB"
+#define YUBOX_BUNDLE_VERSION  1
+
+typedef struct
+{
+  char magic[4];        // "YBXB"
+  uint16_t version;     // YUBOX_BUNDLE_VERSION
+  uint16_t count;       // Número de entradas en el índice
+  uint32_t strtab;      // Desplazamiento de tabla de rutas
+  uint32_t size;        // Tamaño total del bundle
+} yubox_bundle_header_t;
+
+typedef struct
+{
+  uint32_t path_offset; // Desplazamiento de la ruta, sin "/" inicial ni '\0'
+  uint16_t path_len;    // Longitud de la ruta
+  uint16_t flags;       // Reservado
+  uint32_t data_offset; // Desplazamiento del contenido
+  uint32_t data_len;    // Longitud del contenido
+} yubox_bundle_entry_t;
+
+class YuboxAssetBundleHandler : public AsyncWebHandler
+{
+private:
+  String _partlabel;
+  String _defaultFile;
+
+  spi_flash_mmap_handle_t _mmap_handle;
+  const uint8_t * _base;
+  const yubox_bundle_entry_t * _index;
+  uint16_t _count;
+  YuboxAssetManifest _manifest;
+
+  // Generación del manifest de SPIFFS con la que se validó el bundle
+  uint32_t _generation;
+  bool _stale;
+
+  int _findEntry(const char * path, size_t len);
+  int _findRequestEntry(AsyncWebServerRequest *, const char * & encoding);
+  bool _matchesFilesystemManifest(void);
+  void _checkGeneration(void);
+
+  static const char * _contentTypeForPath(const char *, size_t);
+
+public:
+  YuboxAssetBundleHandler(const char * partlabel = "yuboxbundle");
+  ~YuboxAssetBundleHandler();
+
+  // Mapear la partición del bundle y validar su contenido. Devuelve falso si
+  // no existe la partición, si el bundle es inválido, o si su manifest.txt no
+  // coincide con el de SPIFFS (por ejemplo luego de una actualización OTA que
+  // sólo reemplaza los archivos de SPIFFS). La comparación se repite cada vez
+  // que cambia YuboxAssetManifest::generation(), y el bundle deja de servirse
+  // mientras no coincida.
+  bool begin(void);
+  void end(void);
+  bool isAvailable(void) { return (_base != NULL && !_stale); }
+
+  YuboxAssetBundleHandler & setDefaultFile(const char * filename) { _defaultFile = filename; return *this; }
+
+  virtual bool canHandle(AsyncWebServerRequest *request) override final;
+  virtual void handleRequest(AsyncWebServerRequest *request) override final;
+};
+
+#endif
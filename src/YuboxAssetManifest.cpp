@@ -0,0 +1,184 @@
+#include <Arduino.h>
+
+#include "YuboxAssetManifest.h"
+
+#include <algorithm>
+
+volatile uint32_t YuboxAssetManifest::_generation = 0;
+
+void YuboxAssetManifest::_addLine(const char * line, size_t len)
+{
+  if (len > 0 && line[len - 1] == '\r') len--;
+  if (len == 0) return;
+
+  const char * tab = (const char *)memchr(line, '\t', len);
+  size_t namelen = (tab != NULL) ? (size_t)(tab - line) : len;
+
+  char name[96];
+  if (namelen >= sizeof(name)) {
+    log_w("nombre de archivo demasiado largo en manifest, se ignora");
+    return;
+  }
+  memcpy(name, line, namelen);
+  name[namelen] = '\0';
+
+  entry_t e;
+  e.name = name;
+  e.hash[0] = '\0';
+  if (tab != NULL) {
+    size_t hashlen = len - namelen - 1;
+    if (hashlen > YUBOX_ASSET_HASH_MAXLEN) hashlen = YUBOX_ASSET_HASH_MAXLEN;
+    memcpy(e.hash, tab + 1, hashlen);
+    e.hash[hashlen] = '\0';
+  }
+  _entries.push_back(e);
+}
+
+void YuboxAssetManifest::parse(const uint8_t * data, size_t len)
+{
+  const char * p = (const char *)data;
+  const char * end = p + len;
+
+  _entries.clear();
+  while (p < end) {
+    const char * nl = (const char *)memchr(p, '\n', end - p);
+    if (nl == NULL) nl = end;
+    _addLine(p, nl - p);
+    p = nl + 1;
+  }
+
+  std::sort(_entries.begin(), _entries.end(), [](const entry_t & a, const entry_t & b) {
+    return strcmp(a.name.c_str(), b.name.c_str()) < 0;
+  });
+}
+
+bool YuboxAssetManifest::load(FS & fs, const char * path)
+{
+  File h = fs.open(path, FILE_READ);
+  if (!h) {
+    _entries.clear();
+    return false;
+  }
+
+  size_t len = h.size();
+  uint8_t * buf = (uint8_t *)malloc(len + 1);
+  if (buf == NULL) {
+    h.close();
+    log_e("no hay memoria para leer %s de %u bytes", path, len);
+    return false;
+  }
+  len = h.read(buf, len);
+  h.close();
+
+  parse(buf, len);
+  free(buf);
+  return true;
+}
+
+void YuboxAssetManifest::resolveStoredNames(FS & fs)
+{
+  bool renamed = false;
+
+  for (auto i = 0; i < _entries.size(); i++) {
+    String & name = _entries[i].name;
+    if (name.endsWith(".gz") || name.endsWith(".br")) continue;
+
+    String fullname = "/"; fullname += name;
+    if (fs.exists(fullname)) continue;
+    fullname += ".gz";
+    if (!fs.exists(fullname)) continue;
+
+    name += ".gz";
+    renamed = true;
+  }
+
+  if (renamed) std::sort(_entries.begin(), _entries.end(), [](const entry_t & a, const entry_t & b) {
+    return strcmp(a.name.c_str(), b.name.c_str()) < 0;
+  });
+}
+
+int YuboxAssetManifest::_find(const char * path, size_t len)
+{
+  int lo = 0;
+  int hi = (int)_entries.size() - 1;
+
+  while (lo <= hi) {
+    int mid = (lo + hi) >> 1;
+    const String & n = _entries[mid].name;
+    int c = strncmp(n.c_str(), path, len);
+    if (c == 0 && n.length() != len) c = (n.length() < len) ? -1 : 1;
+
+    if (c == 0) return mid;
+    if (c < 0) lo = mid + 1; else hi = mid - 1;
+  }
+  return -1;
+}
+
+const char * YuboxAssetManifest::lookup(const char * path, const char ** hash, bool brotli)
+{
+  char zpath[96];
+  size_t len = strlen(path);
+
+  int idx = _find(path, len);
+  if (idx < 0 && len + 4 <= sizeof(zpath)) {
+    memcpy(zpath, path, len);
+    if (brotli) {
+      memcpy(zpath + len, ".br", 4);
+      idx = _find(zpath, len + 3);
+    }
+    if (idx < 0) {
+      memcpy(zpath + len, ".gz", 4);
+      idx = _find(zpath, len + 3);
+    }
+  }
+  if (idx < 0) return NULL;
+
+  if (hash != NULL) *hash = _entries[idx].hash;
+  return _entries[idx].name.c_str();
+}
+
+void YuboxAssetManifest::_formatETag(char * etag, size_t len, const char * hash, const char * encoding)
+{
+  // Cada codificación es una representación distinta del mismo contenido, y
+  // debe tener su propio ETag (RFC 7232). De lo contrario una caché intermedia
+  // podría revalidar una copia brotli para un cliente que sólo acepta gzip.
+  if (encoding != NULL) {
+    snprintf(etag, len, "\"%s-%s\"", hash, encoding);
+  } else {
+    snprintf(etag, len, "\"%s\"", hash);
+  }
+}
+
+bool YuboxAssetManifest::handleNotModified(AsyncWebServerRequest * request, const char * hash, const char * encoding)
+{
+  if (hash == NULL || *hash == '\0') return false;
+  if (!request->hasHeader("If-None-Match")) return false;
+
+  // El ETag se envía entre comillas, como exige el estándar
+  char etag[YUBOX_ASSET_ETAG_MAXLEN];
+  _formatETag(etag, sizeof(etag), hash, encoding);
+  const String & inm = request->header("If-None-Match");
+  if (strstr(inm.c_str(), etag) == NULL) return false;
+
+  AsyncWebServerResponse * response = request->beginResponse(304);
+  addCacheHeaders(request, response, hash, encoding);
+  request->send(response);
+  return true;
+}
+
+void YuboxAssetManifest::addCacheHeaders(AsyncWebServerRequest * request, AsyncWebServerResponse * response, const char * hash, const char * encoding)
+{
+  if (encoding != NULL) response->addHeader("Vary", "Accept-Encoding");
+  if (hash == NULL || *hash == '\0') return;
+
+  char etag[YUBOX_ASSET_ETAG_MAXLEN];
+  _formatETag(etag, sizeof(etag), hash, encoding);
+  response->addHeader("ETag", etag);
+
+  AsyncWebParameter * v = request->getParam("v");
+  if (v != NULL && v->value() == hash) {
+    response->addHeader("Cache-Control", "public, max-age=31536000, immutable");
+  } else {
+    response->addHeader("Cache-Control", "no-cache");
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef _YUBOX_ASSET_MANIFEST_H_
+#define _YUBOX_ASSET_MANIFEST_H_
+
+#include <ESPAsyncWebServer.h>
+#include "FS.h"
+
+#include <vector>
+
+// Longitud máxima del hash de contenido generado por yubox-framework-assemble
+#define YUBOX_ASSET_HASH_MAXLEN 16
+
+// Longitud máxima del ETag entre comillas, con sufijo de codificación "-gzip"
+#define YUBOX_ASSET_ETAG_MAXLEN (YUBOX_ASSET_HASH_MAXLEN + 8)
+
+// Tabla de archivos y hashes de contenido leída del manifest.txt. Cada línea
+// del manifest tiene el formato "archivo\thash". Las líneas sin hash (formato
+// anterior) se aceptan con hash vacío.
+class YuboxAssetManifest
+{
+private:
+  typedef struct
+  {
+    String name;
+    char hash[YUBOX_ASSET_HASH_MAXLEN + 1];
+  } entry_t;
+
+  std::vector<entry_t> _entries;
+
+  void _addLine(const char *, size_t);
+  int _find(const char *, size_t);
+
+  static void _formatETag(char *, size_t, const char * hash, const char * encoding);
+
+  static volatile uint32_t _generation;
+
+public:
+  // Contador de cambios del manifest.txt de SPIFFS. Quien reemplace los
+  // archivos de datos sin reiniciar debe llamar a changed(), y quien guarde
+  // algo derivado del manifest lo vuelve a validar al cambiar el contador.
+  static uint32_t generation(void) { return _generation; }
+  static void changed(void) { _generation++; }
+
+  void clear(void) { _entries.clear(); }
+  size_t count(void) { return _entries.size(); }
+
+  void parse(const uint8_t *, size_t);
+  bool load(FS &, const char * path = "/manifest.txt");
+
+  // Un manifest generado antes de que yubox-framework-assemble comprimiera
+  // los archivos lista los .gz sin la extensión, de la misma forma que lo
+  // interpreta YuboxOTA_Flasher_ESP32::_loadManifest(). Esta función agrega
+  // ".gz" a las entradas cuyo archivo sólo existe comprimido en el sistema de
+  // archivos, para que lookup() devuelva siempre el nombre almacenado.
+  void resolveStoredNames(FS &);
+
+  // Buscar archivo a servir para la ruta indicada (sin "/" inicial). Se busca
+  // primero la ruta tal cual, luego con ".br" si el cliente acepta brotli, y
+  // luego con ".gz". Devuelve el nombre de archivo encontrado en el manifest,
+  // o NULL si la ruta no consta en el manifest.
+  const char * lookup(const char * path, const char ** hash = NULL, bool brotli = false);
+
+  // Verificación de validador ETag de la petición. Si el cliente ya tiene el
+  // contenido con el hash indicado, se responde 304 y se devuelve true. La
+  // codificación ("gzip", "br" o NULL) distingue el ETag de cada variante.
+  static bool handleNotModified(AsyncWebServerRequest *, const char * hash, const char * encoding = NULL);
+
+  // Agregar cabeceras de caché según el hash de contenido. Una petición con
+  // parámetro ?v= igual al hash es una URL con huella y se marca inmutable.
+  // El resto debe revalidarse siempre vía ETag. Una variante comprimida lleva
+  // además Vary: Accept-Encoding.
+  static void addCacheHeaders(AsyncWebServerRequest *, AsyncWebServerResponse *, const char * hash, const char * encoding = NULL);
+};
+
+#endif
@@ -0,0 +1,387 @@
+#include <Arduino.h>
+
+#include "YuboxEventSource.h"
+#include "YuboxWebAuthClass.h"
+
+// Respuesta que envía las cabeceras de text/event-stream y luego entrega la
+// conexión a un YuboxEventSourceClient.
+class YuboxEventSourceResponse : public AsyncWebServerResponse
+{
+private:
+  YuboxEventSource * _server;
+
+public:
+  YuboxEventSourceResponse(YuboxEventSource * server)
+  {
+    _server = server;
+    _code = 200;
+    _contentType = "text/event-stream";
+    _sendContentLength = false;
+    addHeader("Cache-Control", "no-cache");
+    addHeader("Connection", "keep-alive");
+  }
+
+  void _respond(AsyncWebServerRequest * request)
+  {
+    String out = _assembleHead(request->version());
+    request->client()->write(out.c_str(), _headLength);
+    _state = RESPONSE_WAIT_ACK;
+  }
+
+  size_t _ack(AsyncWebServerRequest * request, size_t len, uint32_t time)
+  {
+    // El cliente toma control de la conexión y destruye la petición
+    if (len) new YuboxEventSourceClient(request, _server);
+    return 0;
+  }
+
+  bool _sourceValid(void) const { return true; }
+};
+
+static size_t _putEventText(char * buf, size_t pos, const char * s, size_t n)
+{
+  if (buf != NULL) memcpy(buf + pos, s, n);
+  return pos + n;
+}
+
+// Formatear el evento en buf, o sólo medirlo si buf es NULL
+static size_t _formatEvent(char * buf, const char * message, const char * event, uint32_t id, uint32_t reconnect)
+{
+  char num[24];
+  size_t pos = 0;
+  int n;
+
+  if (reconnect) {
+    n = snprintf(num, sizeof(num), "retry: %u\r\n", reconnect);
+    pos = _putEventText(buf, pos, num, n);
+  }
+  if (id) {
+    n = snprintf(num, sizeof(num), "id: %u\r\n", id);
+    pos = _putEventText(buf, pos, num, n);
+  }
+  if (event != NULL) {
+    pos = _putEventText(buf, pos, "event: ", 7);
+    pos = _putEventText(buf, pos, event, strlen(event));
+    pos = _putEventText(buf, pos, "\r\n", 2);
+  }
+  if (message != NULL) {
+    // Cada línea del mensaje va en su propio campo data
+    const char * p = message;
+    while (true) {
+      const char * nl = strchr(p, '\n');
+      size_t l = (nl != NULL) ? (size_t)(nl - p) : strlen(p);
+      size_t vl = (l > 0 && p[l - 1] == '\r') ? l - 1 : l;
+
+      pos = _putEventText(buf, pos, "data: ", 6);
+      pos = _putEventText(buf, pos, p, vl);
+      pos = _putEventText(buf, pos, "\r\n", 2);
+      if (nl == NULL) break;
+      p = nl + 1;
+    }
+  }
+  pos = _putEventText(buf, pos, "\r\n", 2);
+  return pos;
+}
+
+std::shared_ptr<YuboxEventPayload> YuboxEventSource::formatEvent(const char * message, const char * event, uint32_t id, uint32_t reconnect)
+{
+  std::shared_ptr<YuboxEventPayload> payload = std::make_shared<YuboxEventPayload>();
+
+  size_t len = _formatEvent(NULL, message, event, id, reconnect);
+  payload->data = (char *)malloc(len);
+  if (payload->data == NULL) {
+    log_e("no hay memoria para evento SSE de %u bytes", len);
+    return std::shared_ptr<YuboxEventPayload>();
+  }
+  payload->len = _formatEvent(payload->data, message, event, id, reconnect);
+  if (event != NULL) payload->event = event;
+  return payload;
+}
+
+YuboxEventSourceClient::YuboxEventSourceClient(AsyncWebServerRequest * request, YuboxEventSource * server)
+{
+  _client = request->client();
+  _server = server;
+  _lastId = 0;
+  _head = 0;
+  _count = 0;
+  _dropped = 0;
+  _coalesced = 0;
+
+  if (request->hasHeader("Last-Event-ID"))
+    _lastId = atoi(request->getHeader("Last-Event-ID")->value().c_str());
+
+  _client->setRxTimeout(0);
+  _client->onError(NULL, NULL);
+  _client->onAck([](void *r, AsyncClient * c, size_t len, uint32_t time) { ((YuboxEventSourceClient *)(r))->_onAck(len, time); }, this);
+  _client->onPoll([](void *r, AsyncClient * c) { ((YuboxEventSourceClient *)(r))->_onPoll(); }, this);
+  _client->onData(NULL, NULL);
+  _client->onTimeout([](void *r, AsyncClient * c, uint32_t time) { ((YuboxEventSourceClient *)(r))->_onTimeout(time); }, this);
+  _client->onDisconnect([](void *r, AsyncClient * c) { ((YuboxEventSourceClient *)(r))->_onDisconnect(); delete c; }, this);
+
+  _server->_addClient(this);
+  delete request;
+}
+
+YuboxEventSourceClient::~YuboxEventSourceClient()
+{
+}
+
+void YuboxEventSourceClient::close(void)
+{
+  // El cierre efectivo ocurre en el siguiente sondeo de la conexión
+  if (_client != NULL) _client->close();
+}
+
+void YuboxEventSourceClient::_dropSlot(uint8_t i)
+{
+  for (auto j = i; j + 1 < _count; j++) {
+    _queue[(_head + j) % YUBOX_EVENTSOURCE_QUEUE_LEN] = _queue[(_head + j + 1) % YUBOX_EVENTSOURCE_QUEUE_LEN];
+  }
+  _queue[(_head + _count - 1) % YUBOX_EVENTSOURCE_QUEUE_LEN].payload.reset();
+  _count--;
+  _dropped++;
+}
+
+void YuboxEventSourceClient::_queueMessage(const std::shared_ptr<YuboxEventPayload> & payload, YuboxEventSourcePolicy policy)
+{
+  if (policy == YUBOX_EVENTSOURCE_COALESCE) {
+    for (auto i = 0; i < _count; i++) {
+      slot_t & s = _queue[(_head + i) % YUBOX_EVENTSOURCE_QUEUE_LEN];
+      if (s.sent == 0 && s.payload->event == payload->event) {
+        // Se conserva la marca de tiempo original para medir el retraso
+        s.payload = payload;
+        _coalesced++;
+        return;
+      }
+    }
+  }
+
+  if (_count >= YUBOX_EVENTSOURCE_QUEUE_LEN) {
+    // Sólo el primer evento puede estar a medio enviar
+    for (auto i = 0; i < _count; i++) {
+      if (_queue[(_head + i) % YUBOX_EVENTSOURCE_QUEUE_LEN].sent == 0) {
+        _dropSlot(i);
+        break;
+      }
+    }
+    if (_count >= YUBOX_EVENTSOURCE_QUEUE_LEN) {
+      _dropped++;
+      return;
+    }
+  }
+
+  slot_t & s = _queue[(_head + _count) % YUBOX_EVENTSOURCE_QUEUE_LEN];
+  s.payload = payload;
+  s.sent = 0;
+  s.ts = millis();
+  _count++;
+}
+
+void YuboxEventSourceClient::_runQueue(void)
+{
+  if (_client == NULL || !_client->connected()) return;
+
+  // Se copia a TCP sólo lo que cabe. El resto espera al siguiente ACK.
+  bool added = false;
+  while (_count > 0) {
+    slot_t & s = _queue[_head];
+    size_t space = _client->space();
+    if (space == 0) break;
+
+    size_t n = s.payload->len - s.sent;
+    if (n > space) n = space;
+    size_t w = _client->add(s.payload->data + s.sent, n);
+    if (w == 0) break;
+    added = true;
+    s.sent += w;
+    if (s.sent < s.payload->len) break;
+
+    s.payload.reset();
+    _head = (_head + 1) % YUBOX_EVENTSOURCE_QUEUE_LEN;
+    _count--;
+  }
+  if (added) _client->send();
+}
+
+void YuboxEventSourceClient::_onAck(size_t len, uint32_t time)
+{
+  if (_server == NULL) return;
+  xSemaphoreTakeRecursive(_server->_lock, portMAX_DELAY);
+  _runQueue();
+  xSemaphoreGiveRecursive(_server->_lock);
+}
+
+void YuboxEventSourceClient::_onPoll(void)
+{
+  if (_server == NULL) return;
+  xSemaphoreTakeRecursive(_server->_lock, portMAX_DELAY);
+  if (_count > 0) _runQueue();
+  xSemaphoreGiveRecursive(_server->_lock);
+}
+
+void YuboxEventSourceClient::_onTimeout(uint32_t time)
+{
+  _client->close(true);
+}
+
+void YuboxEventSourceClient::_onDisconnect(void)
+{
+  if (_server != NULL) _server->_handleDisconnect(this);
+  delete this;
+}
+
+void YuboxEventSourceClient::send(const char * message, const char * event, uint32_t id, uint32_t reconnect)
+{
+  std::shared_ptr<YuboxEventPayload> payload = YuboxEventSource::formatEvent(message, event, id, reconnect);
+  if (!payload || _server == NULL) return;
+
+  xSemaphoreTakeRecursive(_server->_lock, portMAX_DELAY);
+  _queueMessage(payload, _server->_policy);
+  _runQueue();
+  xSemaphoreGiveRecursive(_server->_lock);
+}
+
+void YuboxEventSourceClient::stats(YuboxEventSourceClientStats & st) const
+{
+  st.remoteIP = (_client != NULL) ? _client->remoteIP() : IPAddress();
+  st.lastId = _lastId;
+  st.queued = _count;
+  st.pendingBytes = 0;
+  for (auto i = 0; i < _count; i++) {
+    const slot_t & s = _queue[(_head + i) % YUBOX_EVENTSOURCE_QUEUE_LEN];
+    st.pendingBytes += s.payload->len - s.sent;
+  }
+  st.lagMs = (_count > 0) ? millis() - _queue[_head].ts : 0;
+  st.dropped = _dropped;
+  st.coalesced = _coalesced;
+}
+
+YuboxEventSource::YuboxEventSource(const String & url, YuboxEventSourcePolicy policy)
+  : _url(url), _connectcb(NULL), _policy(policy), _mirrorSend(NULL), _mirrorCount(NULL)
+{
+  _lock = xSemaphoreCreateRecursiveMutex();
+}
+
+YuboxEventSource::~YuboxEventSource()
+{
+  // Los clientes que aún no se desconectan quedan sin servidor, y el mutex se
+  // conserva porque todavía pueden estar en un callback.
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  for (auto i = 0; i < _clients.size(); i++) {
+    _clients[i]->_server = NULL;
+    _clients[i]->close();
+  }
+  _clients.clear();
+  xSemaphoreGiveRecursive(_lock);
+}
+
+void YuboxEventSource::_addClient(YuboxEventSourceClient * client)
+{
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  _clients.push_back(client);
+  xSemaphoreGiveRecursive(_lock);
+
+  if (_connectcb) _connectcb(client);
+}
+
+void YuboxEventSource::_handleDisconnect(YuboxEventSourceClient * client)
+{
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  for (auto i = 0; i < _clients.size(); i++) {
+    if (_clients[i] == client) {
+      client->_client = NULL;
+      _clients.erase(_clients.begin() + i);
+      break;
+    }
+  }
+  xSemaphoreGiveRecursive(_lock);
+}
+
+void YuboxEventSource::close(void)
+{
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  for (auto i = 0; i < _clients.size(); i++) {
+    if (_clients[i]->connected()) _clients[i]->close();
+  }
+  xSemaphoreGiveRecursive(_lock);
+}
+
+void YuboxEventSource::setMirror(YuboxEventSourceMirrorSend fnSend, YuboxEventSourceMirrorCount fnCount)
+{
+  _mirrorSend = fnSend;
+  _mirrorCount = fnCount;
+}
+
+void YuboxEventSource::send(const char * message, const char * event, uint32_t id, uint32_t reconnect)
+{
+  if (_mirrorSend && (!_mirrorCount || _mirrorCount() > 0)) _mirrorSend(message, event);
+
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  bool hasClients = !_clients.empty();
+  xSemaphoreGiveRecursive(_lock);
+  if (!hasClients) return;
+
+  // El evento se formatea una sola vez, y cada cola guarda una referencia
+  std::shared_ptr<YuboxEventPayload> payload = formatEvent(message, event, id, reconnect);
+  if (!payload) return;
+
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  for (auto i = 0; i < _clients.size(); i++) {
+    if (!_clients[i]->connected()) continue;
+    _clients[i]->_queueMessage(payload, _policy);
+    _clients[i]->_runQueue();
+  }
+  xSemaphoreGiveRecursive(_lock);
+}
+
+size_t YuboxEventSource::count(void) const
+{
+  size_t n = 0;
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  for (auto i = 0; i < _clients.size(); i++) {
+    if (_clients[i]->connected()) n++;
+  }
+  xSemaphoreGiveRecursive(_lock);
+  if (_mirrorCount) n += _mirrorCount();
+  return n;
+}
+
+size_t YuboxEventSource::avgPacketsWaiting(void) const
+{
+  size_t n = 0, q = 0;
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  for (auto i = 0; i < _clients.size(); i++) {
+    if (_clients[i]->connected()) {
+      q += _clients[i]->packetsWaiting();
+      n++;
+    }
+  }
+  xSemaphoreGiveRecursive(_lock);
+  return (n > 0) ? (q + n - 1) / n : 0;
+}
+
+std::vector<YuboxEventSourceClientStats> YuboxEventSource::clientStats(void) const
+{
+  std::vector<YuboxEventSourceClientStats> r;
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  r.resize(_clients.size());
+  for (auto i = 0; i < _clients.size(); i++) _clients[i]->stats(r[i]);
+  xSemaphoreGiveRecursive(_lock);
+  return r;
+}
+
+bool YuboxEventSource::canHandle(AsyncWebServerRequest *request)
+{
+  if (request->method() != HTTP_GET || !request->url().equals(_url)) return false;
+  request->addInterestingHeader("Last-Event-ID");
+  YuboxWebAuth.addInterestingHeaders(request);
+  return true;
+}
+
+void YuboxEventSource::handleRequest(AsyncWebServerRequest *request)
+{
+  if ((_username != "" && _password != "") && !YuboxWebAuth.authenticate(request))
+    return request->requestAuthentication();
+  request->send(new YuboxEventSourceResponse(this));
+}
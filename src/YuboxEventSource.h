@@ -0,0 +1,169 @@
+#ifndef _YUBOX_EVENT_SOURCE_H_
+#define _YUBOX_EVENT_SOURCE_H_
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Máximo de eventos pendientes por cliente
+#define YUBOX_EVENTSOURCE_QUEUE_LEN   8
+
+class YuboxEventSource;
+class YuboxEventSourceClient;
+
+// Evento ya formateado en el formato de text/event-stream. Se construye una
+// sola vez por cada envío y se comparte entre todas las colas de clientes.
+class YuboxEventPayload
+{
+public:
+  char * data;
+  size_t len;
+  String event;
+
+  YuboxEventPayload(void) : data(NULL), len(0) {}
+  ~YuboxEventPayload() { if (data != NULL) free(data); }
+};
+
+// Política a aplicar cuando un evento se encola para un cliente
+typedef enum
+{
+  // Si la cola está llena, se descarta el evento más antiguo que no haya
+  // empezado a enviarse.
+  YUBOX_EVENTSOURCE_DROP_OLDEST,
+
+  // Un evento que todavía no ha empezado a enviarse se reemplaza por uno
+  // nuevo del mismo tipo, conservando su lugar. Adecuado para eventos en que
+  // sólo interesa el último valor, como reportes de escaneo o progreso. Los
+  // eventos sin nombre son todos del mismo tipo. Si la cola está llena, se
+  // aplica DROP_OLDEST.
+  YUBOX_EVENTSOURCE_COALESCE
+} YuboxEventSourcePolicy;
+
+// Estadísticas de retraso de un cliente conectado
+typedef struct
+{
+  IPAddress remoteIP;
+  uint32_t lastId;
+  uint32_t queued;        // Eventos en cola, incluyendo uno a medio enviar
+  uint32_t pendingBytes;  // Bytes de eventos en cola que faltan por escribir
+  uint32_t lagMs;         // Antigüedad del evento más antiguo en cola
+  uint32_t dropped;       // Eventos descartados por cola llena
+  uint32_t coalesced;     // Eventos reemplazados por uno más reciente
+} YuboxEventSourceClientStats;
+
+class YuboxEventSourceClient
+{
+private:
+  friend class YuboxEventSource;
+
+  typedef struct
+  {
+    std::shared_ptr<YuboxEventPayload> payload;
+    size_t sent;
+    uint32_t ts;
+  } slot_t;
+
+  AsyncClient * _client;
+  YuboxEventSource * _server;
+  uint32_t _lastId;
+
+  // Cola circular de eventos pendientes
+  slot_t _queue[YUBOX_EVENTSOURCE_QUEUE_LEN];
+  uint8_t _head;
+  uint8_t _count;
+
+  uint32_t _dropped;
+  uint32_t _coalesced;
+
+  void _dropSlot(uint8_t pos);
+  void _queueMessage(const std::shared_ptr<YuboxEventPayload> &, YuboxEventSourcePolicy);
+  void _runQueue(void);
+
+  void _onAck(size_t len, uint32_t time);
+  void _onPoll(void);
+  void _onTimeout(uint32_t time);
+  void _onDisconnect(void);
+
+public:
+  YuboxEventSourceClient(AsyncWebServerRequest * request, YuboxEventSource * server);
+  ~YuboxEventSourceClient();
+
+  AsyncClient * client(void) { return _client; }
+  void close(void);
+  bool connected(void) const { return (_client != NULL) && _client->connected(); }
+  uint32_t lastId(void) const { return _lastId; }
+  size_t packetsWaiting(void) const { return _count; }
+  void stats(YuboxEventSourceClientStats &) const;
+
+  // Enviar un evento sólo a este cliente
+  void send(const char * message, const char * event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+};
+
+// El cliente es NULL cuando el suscriptor llegó por un transporte réplica,
+// como el canal WebSocket. En ese caso el evento inicial debe enviarse a todos.
+typedef std::function<void(YuboxEventSourceClient *)> YuboxEventSourceConnectHandler;
+
+// Réplica de cada evento hacia otro transporte, y cantidad de suscriptores en él
+typedef std::function<void(const char * message, const char * event)> YuboxEventSourceMirrorSend;
+typedef std::function<size_t(void)> YuboxEventSourceMirrorCount;
+
+/*
+ * Fuente de eventos SSE con la misma interfaz básica que AsyncEventSource,
+ * pero que formatea cada evento una sola vez y comparte el resultado entre
+ * todos los clientes conectados. Cada cliente tiene una cola de tamaño fijo,
+ * por lo que un cliente lento pierde eventos en lugar de agotar el heap. Los
+ * datos se copian a los búferes de TCP sólo a medida que hay espacio.
+ */
+class YuboxEventSource : public AsyncWebHandler
+{
+private:
+  friend class YuboxEventSourceClient;
+
+  String _url;
+  std::vector<YuboxEventSourceClient *> _clients;
+  SemaphoreHandle_t _lock;
+  YuboxEventSourceConnectHandler _connectcb;
+  YuboxEventSourcePolicy _policy;
+  YuboxEventSourceMirrorSend _mirrorSend;
+  YuboxEventSourceMirrorCount _mirrorCount;
+
+  void _addClient(YuboxEventSourceClient *);
+  void _handleDisconnect(YuboxEventSourceClient *);
+
+public:
+  YuboxEventSource(const String & url, YuboxEventSourcePolicy policy = YUBOX_EVENTSOURCE_DROP_OLDEST);
+  ~YuboxEventSource();
+
+  const char * url(void) const { return _url.c_str(); }
+  void setPolicy(YuboxEventSourcePolicy policy) { _policy = policy; }
+  void close(void);
+  void onConnect(YuboxEventSourceConnectHandler cb) { _connectcb = cb; }
+
+  // Replicar cada evento enviado hacia otro transporte. Los suscriptores de la
+  // réplica se incluyen en count(), y se notifican con notifyMirrorConnect().
+  void setMirror(YuboxEventSourceMirrorSend fnSend, YuboxEventSourceMirrorCount fnCount);
+  void notifyMirrorConnect(void) { if (_connectcb) _connectcb(NULL); }
+
+  // Formatear el evento y encolarlo para todos los clientes conectados, y
+  // pasarlo a la réplica si tiene suscriptores
+  void send(const char * message, const char * event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+
+  size_t count(void) const;
+  size_t avgPacketsWaiting(void) const;
+
+  // Estadísticas de cada cliente conectado, en el orden de conexión
+  std::vector<YuboxEventSourceClientStats> clientStats(void) const;
+
+  static std::shared_ptr<YuboxEventPayload> formatEvent(const char * message, const char * event, uint32_t id, uint32_t reconnect);
+
+  virtual bool canHandle(AsyncWebServerRequest *request) override final;
+  virtual void handleRequest(AsyncWebServerRequest *request) override final;
+};
+
+#endif
@@ -0,0 +1,383 @@
+#include <Arduino.h>
+
+#include "YuboxFSClass.h"
+#include "YuboxWebAuthClass.h"
+#include "YuboxRouterClass.h"
+#include "YuboxJSONWriter.h"
+#include "YuboxAssetManifest.h"
+
+#include <memory>
+
+typedef struct
+{
+  File dir;
+  size_t limit;
+} yubox_fs_list_state_t;
+
+YuboxFSClass::YuboxFSClass(void)
+{
+  _routesInstalled = false;
+  _uploadRequest = NULL;
+  _uploadRejected = false;
+  _uploadDone = false;
+  _uploadCode = 0;
+}
+
+void YuboxFSClass::begin(AsyncWebServer & srv)
+{
+  if (_routesInstalled) return;
+
+  YuboxRouter.begin(srv);
+  YuboxRouter.on("/yubox-api/fs", HTTP_GET, std::bind(&YuboxFSClass::_routeHandler_yuboxAPI_fs_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/fs/files", HTTP_GET, std::bind(&YuboxFSClass::_routeHandler_yuboxAPI_fs_files_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/fs/file", HTTP_GET, std::bind(&YuboxFSClass::_routeHandler_yuboxAPI_fs_file_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/fs/file", HTTP_POST,
+    std::bind(&YuboxFSClass::_routeHandler_yuboxAPI_fs_file_POST, this, std::placeholders::_1),
+    std::bind(&YuboxFSClass::_routeHandler_yuboxAPI_fs_file_handleUpload, this, std::placeholders::_1,
+      std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6));
+  _routesInstalled = true;
+}
+
+bool YuboxFSClass::_validPath(const String & path)
+{
+  if (path.length() < 2 || path.length() > YUBOX_FS_MAX_PATH) return false;
+  if (path[0] != '/') return false;
+  if (path.indexOf("..") >= 0) return false;
+  if (path == YUBOX_FS_UPLOAD_TMP) return false;
+  return true;
+}
+
+bool YuboxFSClass::_isManifestAsset(const String & path)
+{
+  // Los archivos del manifest se sirven con su hash de contenido como ETag y
+  // en URLs inmutables, que no cambiarían al reemplazar el archivo.
+  const char * name = path.c_str() + 1;
+  if (strcmp(name, "manifest.txt") == 0) return true;
+
+  YuboxAssetManifest manifest;
+  if (!manifest.load(SPIFFS)) return false;
+  if (manifest.lookup(name, NULL, true) != NULL) return true;
+
+  // Un manifest anterior a la compresión lista los .gz sin la extensión
+  if (path.endsWith(".gz") || path.endsWith(".br")) {
+    String base = path.substring(1, path.length() - 3);
+    if (manifest.lookup(base.c_str()) != NULL) return true;
+  }
+  return false;
+}
+
+// Interpretar una cabecera Range con un solo rango de bytes. Devuelve 1 si el
+// rango es válido, 0 si debe ignorarse y enviarse el archivo completo, y -1 si
+// el rango no puede satisfacerse.
+int YuboxFSClass::_parseRange(const String & hdr, size_t size, size_t & start, size_t & end)
+{
+  const char * p = hdr.c_str();
+  if (strncmp(p, "bytes=", 6) != 0) return 0;
+  p += 6;
+
+  // Varios rangos requieren multipart/byteranges, y se permite ignorarlos
+  if (strchr(p, ',') != NULL) return 0;
+
+  char * q;
+  if (*p == '-') {
+    // Sufijo: los últimos n bytes
+    unsigned long n = strtoul(p + 1, &q, 10);
+    if (q == p + 1 || *q != '\0') return 0;
+    if (n == 0 || size == 0) return -1;
+    if (n > size) n = size;
+    start = size - n;
+    end = size - 1;
+    return 1;
+  }
+
+  unsigned long a = strtoul(p, &q, 10);
+  if (q == p || *q != '-') return 0;
+  p = q + 1;
+  unsigned long b = size - 1;
+  if (*p != '\0') {
+    b = strtoul(p, &q, 10);
+    if (q == p || *q != '\0') return 0;
+    if (b < a) return 0;
+    if (b >= size) b = size - 1;
+  }
+  if (a >= size) return -1;
+  start = a;
+  end = b;
+  return 1;
+}
+
+void YuboxFSClass::_routeHandler_yuboxAPI_fs_GET(AsyncWebServerRequest * request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  char json_str[64];
+  YuboxJSONWriter json(json_str, sizeof(json_str));
+  json.beginObject();
+  json.field("total", (unsigned long)SPIFFS.totalBytes());
+  json.field("used", (unsigned long)SPIFFS.usedBytes());
+  json.endObject();
+  request->send(200, "application/json", json_str);
+}
+
+void YuboxFSClass::_routeHandler_yuboxAPI_fs_files_GET(AsyncWebServerRequest * request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  std::shared_ptr<yubox_fs_list_state_t> st = std::make_shared<yubox_fs_list_state_t>();
+  st->limit = YUBOX_FS_PAGE_DEFAULT;
+  if (request->hasParam("limit")) {
+    long n = request->getParam("limit")->value().toInt();
+    if (n <= 0 || n > YUBOX_FS_PAGE_MAX) {
+      request->send(400, "application/json", "{\"success\":false,\"msg\":\"Cantidad de archivos por p\\u00e1gina fuera de rango\"}");
+      return;
+    }
+    st->limit = n;
+  }
+
+  st->dir = SPIFFS.open("/");
+  if (!st->dir || !st->dir.isDirectory()) {
+    request->send(500, "application/json", "{\"success\":false,\"msg\":\"No se puede abrir directorio\"}");
+    return;
+  }
+
+  // Avanzar hasta el archivo indicado como cursor. Si ya no existe, el
+  // cliente debe reiniciar el listado.
+  if (request->hasParam("cursor")) {
+    const String & cursor = request->getParam("cursor")->value();
+    bool found = false;
+    File f;
+    while (!found && (f = st->dir.openNextFile())) {
+      found = (cursor == f.name());
+      f.close();
+    }
+    if (!found) {
+      request->send(410, "application/json", "{\"success\":false,\"msg\":\"El cursor indicado ya no existe\"}");
+      return;
+    }
+  }
+
+  AsyncWebServerResponse * response = YuboxJSONWriter::beginArrayResponse(request, [st](YuboxJSONWriter & json, size_t idx) -> bool {
+    if (idx >= st->limit) return false;
+    File f = st->dir.openNextFile();
+    if (!f) return false;
+
+    json.beginObject();
+    json.field("name", f.name());
+    json.field("size", (unsigned long)f.size());
+    json.endObject();
+    f.close();
+    return true;
+  });
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+void YuboxFSClass::_routeHandler_yuboxAPI_fs_file_GET(AsyncWebServerRequest * request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  if (!request->hasParam("path") || !_validPath(request->getParam("path")->value())) {
+    request->send(400, "application/json", "{\"success\":false,\"msg\":\"Ruta de archivo no v\\u00e1lida\"}");
+    return;
+  }
+  const String & path = request->getParam("path")->value();
+  if (!SPIFFS.exists(path)) {
+    request->send(404, "application/json", "{\"success\":false,\"msg\":\"No existe el archivo indicado\"}");
+    return;
+  }
+
+  std::shared_ptr<File> fp = std::make_shared<File>(SPIFFS.open(path, "r"));
+  if (!*fp || fp->isDirectory()) {
+    request->send(500, "application/json", "{\"success\":false,\"msg\":\"No se puede abrir el archivo\"}");
+    return;
+  }
+
+  size_t size = fp->size();
+  size_t start = 0;
+  size_t end = (size > 0) ? size - 1 : 0;
+  int r = 0;
+  if (request->hasHeader("Range")) r = _parseRange(request->header("Range"), size, start, end);
+  if (r < 0) {
+    char crange[32];
+    snprintf(crange, sizeof(crange), "bytes */%u", size);
+    AsyncWebServerResponse * response = request->beginResponse(416);
+    response->addHeader("Content-Range", crange);
+    request->send(response);
+    return;
+  }
+  if (r > 0 && start > 0 && !fp->seek(start)) {
+    request->send(500, "application/json", "{\"success\":false,\"msg\":\"No se puede leer el archivo\"}");
+    return;
+  }
+
+  // El archivo permanece abierto mientras dure el envío, y se lee sólo lo que
+  // cabe en cada paquete.
+  size_t len = (size > 0) ? end - start + 1 : 0;
+  AsyncWebServerResponse * response = request->beginResponse("application/octet-stream", len,
+    [fp, len](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+      if (index >= len) return 0;
+      size_t n = len - index;
+      if (n > maxLen) n = maxLen;
+      return fp->read(buf, n);
+    });
+  if (r > 0) {
+    char crange[48];
+    snprintf(crange, sizeof(crange), "bytes %u-%u/%u", start, end, size);
+    response->setCode(206);
+    response->addHeader("Content-Range", crange);
+  }
+  response->addHeader("Accept-Ranges", "bytes");
+  response->addHeader("Cache-Control", "no-cache");
+
+  String disp = "attachment; filename=\"";
+  disp += path.substring(path.lastIndexOf('/') + 1);
+  disp += "\"";
+  response->addHeader("Content-Disposition", disp);
+  request->send(response);
+}
+
+void YuboxFSClass::_rejectUpload(int code, const char * msg)
+{
+  _uploadRejected = true;
+  _uploadCode = code;
+  _uploadMsg = msg;
+}
+
+void YuboxFSClass::_abortUpload(void)
+{
+  if (_uploadFile) {
+    _uploadFile.close();
+    SPIFFS.remove(YUBOX_FS_UPLOAD_TMP);
+  }
+}
+
+void YuboxFSClass::_resetUpload(void)
+{
+  _abortUpload();
+  _uploadRequest = NULL;
+  _uploadPath = "";
+  _uploadRejected = false;
+  _uploadDone = false;
+  _uploadCode = 0;
+  _uploadMsg = "";
+}
+
+void YuboxFSClass::_routeHandler_yuboxAPI_fs_file_handleUpload(AsyncWebServerRequest * request,
+  const String & filename, size_t index, uint8_t *data, size_t len, bool final)
+{
+  if (index == 0) {
+    if (_uploadRequest != NULL && _uploadRequest != request) {
+      // Otro upload en curso. Este se rechaza sin tocar el estado del otro,
+      // y su manejador POST responde sin consultar dicho estado.
+      return;
+    }
+    if (_uploadRequest == NULL) {
+      _resetUpload();
+      _uploadRequest = request;
+
+      // Si la conexión se pierde a media subida, se descarta el temporal
+      request->onDisconnect([this, request]() {
+        if (_uploadRequest == request) _resetUpload();
+      });
+
+      /* La macro YUBOX_RUN_AUTH no es adecuada porque requestAuthentication() no puede llamarse
+         aquí - vienen más fragmentos del upload. Se debe rechazar el upload si la autenticación
+         ha fallado.
+       */
+      if (!YuboxWebAuth.authenticate(request)) {
+        _uploadRejected = true;
+        return;
+      }
+    }
+    if (_uploadRejected) return;
+    if (_uploadDone) {
+      // Sólo se admite un archivo por petición, el resto se ignora
+      return;
+    }
+
+    _uploadPath = request->hasParam("path") ? request->getParam("path")->value() : String("/") + filename;
+    if (!_validPath(_uploadPath)) {
+      _rejectUpload(400, "Ruta de archivo no válida");
+      return;
+    }
+    if (_isManifestAsset(_uploadPath)) {
+      _rejectUpload(409, "El archivo pertenece a la interfaz web y sólo puede reemplazarse con una actualización");
+      return;
+    }
+
+    // El largo de la petición incluye la codificación multipart, por lo que
+    // esta revisión sólo descarta lo que de seguro no cabe.
+    size_t avail = SPIFFS.totalBytes() - SPIFFS.usedBytes();
+    if (request->contentLength() > avail + (SPIFFS.exists(_uploadPath) ? SPIFFS.open(_uploadPath, "r").size() : 0)) {
+      _rejectUpload(507, "No hay espacio suficiente para el archivo");
+      return;
+    }
+
+    _uploadFile = SPIFFS.open(YUBOX_FS_UPLOAD_TMP, "w");
+    if (!_uploadFile) {
+      _rejectUpload(500, "No se puede crear archivo temporal");
+      return;
+    }
+  }
+
+  if (_uploadRequest != request || _uploadRejected || _uploadDone || !_uploadFile) return;
+
+  if (len > 0 && _uploadFile.write(data, len) != len) {
+    _abortUpload();
+    _rejectUpload(507, "No hay espacio suficiente para el archivo");
+    return;
+  }
+
+  if (final) {
+    _uploadFile.close();
+    if (SPIFFS.exists(_uploadPath)) SPIFFS.remove(_uploadPath);
+    if (!SPIFFS.rename(YUBOX_FS_UPLOAD_TMP, _uploadPath)) {
+      SPIFFS.remove(YUBOX_FS_UPLOAD_TMP);
+      _rejectUpload(500, "No se puede renombrar archivo temporal");
+      return;
+    }
+    _uploadDone = true;
+  }
+}
+
+void YuboxFSClass::_routeHandler_yuboxAPI_fs_file_POST(AsyncWebServerRequest * request)
+{
+  if (_uploadRequest != NULL && _uploadRequest != request) {
+    request->send(409, "application/json", "{\"success\":false,\"msg\":\"Ya hay otro archivo subi\\u00e9ndose\"}");
+    return;
+  }
+
+  /* La macro YUBOX_RUN_AUTH no es adecuada aquí porque el manejador de upload se ejecuta primero
+     y puede haber rechazado el upload. El estado del upload debe limpiarse antes de rechazar la
+     autenticación.
+   */
+  if (!YuboxWebAuth.authenticate(request)) {
+    _resetUpload();
+    return request->requestAuthentication();
+  }
+
+  int code = 200;
+  String msg;
+  if (_uploadRequest == NULL || (!_uploadRejected && !_uploadDone)) {
+    code = 400;
+    msg = "No se ha especificado archivo a subir";
+  } else if (_uploadRejected) {
+    code = _uploadCode;
+    msg = _uploadMsg;
+  } else {
+    msg = "Archivo subido correctamente";
+  }
+
+  char json_str[192];
+  YuboxJSONWriter json(json_str, sizeof(json_str));
+  json.beginObject();
+  json.field("success", (code == 200));
+  json.field("msg", msg);
+  if (code == 200) json.field("path", _uploadPath);
+  json.endObject();
+
+  _resetUpload();
+  request->send(code, "application/json", json_str);
+}
+
+YuboxFSClass YuboxFS;
@@ -0,0 +1,69 @@
+#ifndef _YUBOX_FS_CLASS_H_
+#define _YUBOX_FS_CLASS_H_
+
+#include <ESPAsyncWebServer.h>
+#include <SPIFFS.h>
+
+// Cantidad de archivos por página del listado, por omisión y máxima
+#define YUBOX_FS_PAGE_DEFAULT         50
+#define YUBOX_FS_PAGE_MAX             200
+
+// Archivo temporal donde se recibe un upload antes de renombrarlo a su ruta
+// final, para no dejar un archivo a medias si la subida se interrumpe.
+#define YUBOX_FS_UPLOAD_TMP           "/_yuboxfs_upload.tmp"
+
+// Largo máximo de ruta de archivo en SPIFFS, sin el '\0'
+#define YUBOX_FS_MAX_PATH             31
+
+/*
+ * API JSON para examinar el sistema de archivos SPIFFS:
+ *  GET  /yubox-api/fs                        espacio total y usado
+ *  GET  /yubox-api/fs/files?cursor=&limit=   listado paginado
+ *  GET  /yubox-api/fs/file?path=             descarga, con soporte de Range
+ *  POST /yubox-api/fs/file?path=             subida de un archivo, excepto
+ *                                            los que constan en manifest.txt
+ *
+ * El listado se genera a medida que TCP tiene espacio, leyendo el directorio
+ * de a un archivo. Para pedir la página siguiente se indica como cursor el
+ * nombre del último archivo recibido, y el listado termina cuando una página
+ * trae menos de limit archivos. Las descargas se leen del archivo según se
+ * envían, por lo que su tamaño no está limitado por la memoria disponible.
+ */
+class YuboxFSClass
+{
+private:
+  bool _routesInstalled;
+
+  // Estado del upload en curso. Sólo se admite un upload a la vez.
+  AsyncWebServerRequest * _uploadRequest;
+  File _uploadFile;
+  String _uploadPath;
+  bool _uploadRejected;
+  bool _uploadDone;
+  int _uploadCode;
+  String _uploadMsg;
+
+  static bool _validPath(const String &);
+  static bool _isManifestAsset(const String &);
+  static int _parseRange(const String &, size_t size, size_t & start, size_t & end);
+
+  void _rejectUpload(int code, const char * msg);
+  void _abortUpload(void);
+  void _resetUpload(void);
+
+  void _routeHandler_yuboxAPI_fs_GET(AsyncWebServerRequest *);
+  void _routeHandler_yuboxAPI_fs_files_GET(AsyncWebServerRequest *);
+  void _routeHandler_yuboxAPI_fs_file_GET(AsyncWebServerRequest *);
+  void _routeHandler_yuboxAPI_fs_file_POST(AsyncWebServerRequest *);
+  void _routeHandler_yuboxAPI_fs_file_handleUpload(AsyncWebServerRequest *, const String &, size_t, uint8_t *, size_t, bool);
+
+public:
+  YuboxFSClass(void);
+
+  // Instalar las rutas /yubox-api/fs. Puede llamarse más de una vez.
+  void begin(AsyncWebServer & srv);
+};
+
+extern YuboxFSClass YuboxFS;
+
+#endif
@@ -0,0 +1,356 @@
+#include <Arduino.h>
+
+#include "YuboxGzipClass.h"
+
+#include <memory>
+
+#define YUBOX_GZIP_WINDOW_SIZE  (1UL << YUBOX_GZIP_WINDOW_BITS)
+
+// Datos acumulados antes de comprimir. Comprimir por bloques reduce las
+// llamadas al compresor, y las coincidencias perdidas en el borde de cada
+// bloque.
+#define YUBOX_GZIP_BLOCK_SIZE   (YUBOX_GZIP_WINDOW_SIZE / 2)
+
+YuboxGzipEncoder::YuboxGzipEncoder(void)
+{
+  memset(&_comp, 0, sizeof(_comp));
+  _window = NULL;
+  _pos = 0;
+  _fill = 0;
+  _outOff = 0;
+  _crc = 0xFFFFFFFFUL;
+  _totalIn = 0;
+  _finished = false;
+}
+
+YuboxGzipEncoder::~YuboxGzipEncoder()
+{
+  if (_window != NULL) free(_window);
+  if (_comp.hash_table != NULL) free(_comp.hash_table);
+  if (_comp.hash_chain != NULL) free(_comp.hash_chain);
+  if (_comp.out.outbuf != NULL) free(_comp.out.outbuf);
+}
+
+bool YuboxGzipEncoder::begin(void)
+{
+  // La salida de un bloque es a lo sumo 9 bits por byte de entrada
+  size_t outsize = YUBOX_GZIP_BLOCK_SIZE + YUBOX_GZIP_BLOCK_SIZE / 8 + 64;
+
+  _window = (uint8_t *)malloc(2 * YUBOX_GZIP_WINDOW_SIZE);
+  _comp.hash_table = (uzlib_hash_entry_t *)calloc(1 << YUBOX_GZIP_HASH_BITS, sizeof(uzlib_hash_entry_t));
+  _comp.hash_chain = (uzlib_hash_entry_t *)calloc(YUBOX_GZIP_WINDOW_SIZE, sizeof(uzlib_hash_entry_t));
+  _comp.out.outbuf = (unsigned char *)malloc(outsize);
+  if (_window == NULL || _comp.hash_table == NULL || _comp.hash_chain == NULL || _comp.out.outbuf == NULL) {
+    return false;
+  }
+  _comp.out.outsize = outsize;
+  _comp.hash_bits = YUBOX_GZIP_HASH_BITS;
+  _comp.dict_size = YUBOX_GZIP_WINDOW_SIZE;
+  _comp.max_chain = YUBOX_GZIP_MAX_CHAIN;
+
+  // Cabecera gzip mínima: deflate, sin nombre ni fecha, sistema desconocido
+  static const uint8_t header[10] = { 0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF };
+  for (auto i = 0; i < sizeof(header); i++) _putByte(header[i]);
+  zlib_start_block(&_comp.out);
+  return true;
+}
+
+void YuboxGzipEncoder::_putByte(uint8_t b)
+{
+  outbits(&_comp.out, b, 8);
+}
+
+void YuboxGzipEncoder::_compress(void)
+{
+  if (_fill <= _pos) return;
+  uzlib_compress(&_comp, _window + _pos, _fill - _pos);
+  _pos = _fill;
+}
+
+void YuboxGzipEncoder::_slide(void)
+{
+  // Se conserva la última ventana como diccionario. El desplazamiento es el
+  // tamaño de la ventana, así que cada posición conserva su casilla en la
+  // tabla de cadenas y sólo hay que corregir los punteros.
+  const uint8_t * base = _window + YUBOX_GZIP_WINDOW_SIZE;
+  memmove(_window, base, YUBOX_GZIP_WINDOW_SIZE);
+  _pos -= YUBOX_GZIP_WINDOW_SIZE;
+  _fill -= YUBOX_GZIP_WINDOW_SIZE;
+
+  for (auto i = 0; i < (1 << YUBOX_GZIP_HASH_BITS); i++) {
+    const uint8_t * p = _comp.hash_table[i];
+    _comp.hash_table[i] = (p != NULL && p >= base) ? p - YUBOX_GZIP_WINDOW_SIZE : NULL;
+  }
+  for (auto i = 0; i < YUBOX_GZIP_WINDOW_SIZE; i++) {
+    const uint8_t * p = _comp.hash_chain[i];
+    _comp.hash_chain[i] = (p != NULL && p >= base) ? p - YUBOX_GZIP_WINDOW_SIZE : NULL;
+  }
+}
+
+uint8_t * YuboxGzipEncoder::inputBuffer(size_t & avail)
+{
+  // Nunca se acumula más de un bloque sin comprimir, lo que acota la salida
+  // de cada compresión al tamaño reservado en begin().
+  if (_fill - _pos >= YUBOX_GZIP_BLOCK_SIZE) _compress();
+  if (_fill >= 2 * YUBOX_GZIP_WINDOW_SIZE) _slide();
+
+  avail = 2 * YUBOX_GZIP_WINDOW_SIZE - _fill;
+  if (avail > YUBOX_GZIP_BLOCK_SIZE - (_fill - _pos)) avail = YUBOX_GZIP_BLOCK_SIZE - (_fill - _pos);
+  return _window + _fill;
+}
+
+void YuboxGzipEncoder::commit(size_t n)
+{
+  _crc = uzlib_crc32(_window + _fill, n, _crc);
+  _fill += n;
+  _totalIn += n;
+
+  if (_fill - _pos >= YUBOX_GZIP_BLOCK_SIZE) _compress();
+}
+
+void YuboxGzipEncoder::finish(void)
+{
+  if (_finished) return;
+  _compress();
+  zlib_finish_block(&_comp.out);
+
+  // zlib_finish_block() ya completó el último byte, lo que quede es relleno
+  _comp.out.outbits = 0;
+  _comp.out.noutbits = 0;
+
+  uint32_t crc = ~_crc;
+  for (auto i = 0; i < 4; i++) _putByte(crc >> (8 * i));
+  for (auto i = 0; i < 4; i++) _putByte(_totalIn >> (8 * i));
+  _finished = true;
+}
+
+size_t YuboxGzipEncoder::read(uint8_t * buf, size_t maxLen)
+{
+  size_t n = pending();
+  if (n > maxLen) n = maxLen;
+  memcpy(buf, _comp.out.outbuf + _outOff, n);
+  _outOff += n;
+  if (_outOff >= _comp.out.outlen) {
+    _outOff = 0;
+    _comp.out.outlen = 0;
+  }
+  return n;
+}
+
+// Respuesta chunked que comprime la salida de un AwsResponseFiller
+class YuboxGzipResponse : public AsyncAbstractResponse
+{
+private:
+  YuboxGzipEncoder _enc;
+  bool _valid;
+  AwsResponseFiller _content;
+  size_t _len;                      // Largo original, o 0 si es desconocido
+  size_t _index;                    // Datos ya pedidos a _content
+  bool _eof;
+  std::shared_ptr<uint8_t> _prefetch;
+  size_t _prefetchLen;
+  uint32_t _cpuUs;
+
+public:
+  YuboxGzipResponse(const char * contentType, size_t len, AwsResponseFiller filler,
+    std::shared_ptr<uint8_t> prefetch, size_t prefetchLen)
+    : _content(filler), _len(len), _index(0), _eof(false), _prefetch(prefetch), _prefetchLen(prefetchLen), _cpuUs(0)
+  {
+    _code = 200;
+    _contentType = contentType;
+    _contentLength = 0;
+    _sendContentLength = false;
+    _chunked = true;
+    addHeader("Content-Encoding", "gzip");
+    addHeader("Vary", "Accept-Encoding");
+
+    _valid = _enc.begin();
+  }
+
+  ~YuboxGzipResponse()
+  {
+    if (_valid) {
+      log_d("gzip: %u bytes de contenido, %u bytes enviados, %u us de CPU", _enc.totalIn(), _writtenLength, _cpuUs);
+    }
+    YuboxGzip._releaseStream();
+  }
+
+  bool _sourceValid(void) const { return _valid; }
+
+  virtual size_t _fillBuffer(uint8_t * buf, size_t maxLen) override
+  {
+    uint32_t t = micros();
+
+    while (_enc.pending() == 0 && !_enc.finished()) {
+      if (_eof) {
+        _enc.finish();
+        break;
+      }
+
+      size_t avail, r;
+      uint8_t * in = _enc.inputBuffer(avail);
+      if (_index < _prefetchLen) {
+        // Primero lo que se pidió de antemano en beginChunkedResponse()
+        r = _prefetchLen - _index;
+        if (r > avail) r = avail;
+        memcpy(in, _prefetch.get() + _index, r);
+        if (_index + r >= _prefetchLen) _prefetch.reset();
+      } else {
+        if (_len > 0 && avail > _len - _index) avail = _len - _index;
+        r = (avail > 0) ? _content(in, avail, _index) : 0;
+      }
+      if (r == RESPONSE_TRY_AGAIN) {
+        _cpuUs += micros() - t;
+        return RESPONSE_TRY_AGAIN;
+      }
+      if (r == 0) {
+        _eof = true;
+        continue;
+      }
+      _index += r;
+      _enc.commit(r);
+    }
+
+    size_t n = _enc.read(buf, maxLen);
+    _cpuUs += micros() - t;
+    return n;
+  }
+};
+
+YuboxGzipClass::YuboxGzipClass(void)
+{
+  _enabled = true;
+  _threshold = YUBOX_GZIP_MIN_SIZE;
+  _numStreams = 0;
+  vPortCPUInitializeMutex(&_mux);
+}
+
+bool YuboxGzipClass::_acquireStream(void)
+{
+  bool ok = false;
+  portENTER_CRITICAL(&_mux);
+  if (_numStreams < YUBOX_GZIP_MAX_STREAMS) {
+    _numStreams++;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&_mux);
+  return ok;
+}
+
+void YuboxGzipClass::_releaseStream(void)
+{
+  portENTER_CRITICAL(&_mux);
+  if (_numStreams > 0) _numStreams--;
+  portEXIT_CRITICAL(&_mux);
+}
+
+void YuboxGzipClass::addInterestingHeaders(AsyncWebServerRequest * request)
+{
+  if (_enabled) request->addInterestingHeader("Accept-Encoding");
+}
+
+bool YuboxGzipClass::accepts(AsyncWebServerRequest * request)
+{
+  // El largo de la respuesta comprimida no se conoce de antemano, así que
+  // se requiere HTTP/1.1 para enviarla como chunked.
+  if (!_enabled || request->version() == 0) return false;
+  return acceptsEncoding(request, "gzip");
+}
+
+bool YuboxGzipClass::acceptsEncoding(AsyncWebServerRequest * request, const char * encoding)
+{
+  if (!request->hasHeader("Accept-Encoding")) return false;
+
+  // Buscar la codificación o * en la lista de codificaciones, descartando las
+  // que tienen calidad cero, como en "gzip;q=0"
+  size_t enclen = strlen(encoding);
+  const char * p = request->header("Accept-Encoding").c_str();
+  while (*p != '\0') {
+    while (*p == ' ' || *p == ',') p++;
+    const char * name = p;
+    while (*p != '\0' && *p != ',' && *p != ';' && *p != ' ') p++;
+    size_t namelen = p - name;
+
+    bool zeroq = false;
+    while (*p != '\0' && *p != ',') {
+      if (*p == '=' && p[-1] == 'q') {
+        zeroq = (atof(p + 1) <= 0.0);
+      }
+      p++;
+    }
+
+    if ((namelen == enclen && strncasecmp(name, encoding, enclen) == 0) || (namelen == 1 && *name == '*')) {
+      return !zeroq;
+    }
+  }
+  return false;
+}
+
+AsyncWebServerResponse * YuboxGzipClass::beginResponse(AsyncWebServerRequest * request, const char * contentType,
+  size_t len, AwsResponseFiller filler)
+{
+  if (len < _threshold || len == 0 || !accepts(request) || !_acquireStream()) {
+    return request->beginResponse(contentType, len, filler);
+  }
+
+  YuboxGzipResponse * response = new YuboxGzipResponse(contentType, len, filler, std::shared_ptr<uint8_t>(), 0);
+  if (!response->_sourceValid()) {
+    log_w("no hay memoria para comprimir respuesta, se envía sin comprimir");
+    delete response;
+    return request->beginResponse(contentType, len, filler);
+  }
+  return response;
+}
+
+AsyncWebServerResponse * YuboxGzipClass::beginChunkedResponse(AsyncWebServerRequest * request, const char * contentType,
+  AwsResponseFiller filler)
+{
+  if (_threshold == 0 || !accepts(request)) {
+    return request->beginChunkedResponse(contentType, filler);
+  }
+
+  // Se piden los primeros datos para decidir si vale la pena comprimir
+  std::shared_ptr<uint8_t> prefetch((uint8_t *)malloc(_threshold), free);
+  if (!prefetch) return request->beginChunkedResponse(contentType, filler);
+
+  size_t n = 0;
+  bool eof = false;
+  while (n < _threshold) {
+    size_t r = filler(prefetch.get() + n, _threshold - n, n);
+    if (r == RESPONSE_TRY_AGAIN) break;
+    if (r == 0) {
+      eof = true;
+      break;
+    }
+    n += r;
+  }
+
+  // Lo que ya se pidió al callback se entrega desde la copia, y el resto,
+  // si lo hay, de nuevo desde el callback.
+  auto replay = [prefetch, n, filler](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+    if (index >= n) return filler(buf, maxLen, index);
+    size_t c = n - index;
+    if (c > maxLen) c = maxLen;
+    memcpy(buf, prefetch.get() + index, c);
+    return c;
+  };
+
+  if (eof) {
+    // Contenido corto y completo, se envía sin comprimir con su largo exacto
+    AsyncWebServerResponse * response = request->beginResponse(contentType, n, replay);
+    response->addHeader("Vary", "Accept-Encoding");
+    return response;
+  }
+
+  if (!_acquireStream()) return request->beginChunkedResponse(contentType, replay);
+
+  YuboxGzipResponse * response = new YuboxGzipResponse(contentType, 0, filler, prefetch, n);
+  if (!response->_sourceValid()) {
+    log_w("no hay memoria para comprimir respuesta, se envía sin comprimir");
+    delete response;
+    return request->beginChunkedResponse(contentType, replay);
+  }
+  return response;
+}
+
+YuboxGzipClass YuboxGzip;
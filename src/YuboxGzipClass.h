@@ -0,0 +1,135 @@
+#ifndef _YUBOX_GZIP_CLASS_H_
+#define _YUBOX_GZIP_CLASS_H_
+
+#include <ESPAsyncWebServer.h>
+
+#include "uzlib/uzlib.h"
+
+// Tamaño mínimo de respuesta, en bytes, para comprimir por omisión. Las
+// respuestas más cortas no compensan la cabecera gzip y el costo de CPU.
+#ifndef YUBOX_GZIP_MIN_SIZE
+#define YUBOX_GZIP_MIN_SIZE           512
+#endif
+
+// log2 de la ventana de compresión. La memoria por respuesta comprimida es de
+// 2 ventanas de datos más una tabla de cadenas de 4 bytes por byte de ventana.
+#ifndef YUBOX_GZIP_WINDOW_BITS
+#define YUBOX_GZIP_WINDOW_BITS        10
+#endif
+
+// log2 de la cantidad de entradas de la tabla hash
+#ifndef YUBOX_GZIP_HASH_BITS
+#define YUBOX_GZIP_HASH_BITS          9
+#endif
+
+// Máximo de candidatos examinados por posición en la cadena hash
+#ifndef YUBOX_GZIP_MAX_CHAIN
+#define YUBOX_GZIP_MAX_CHAIN          8
+#endif
+
+// Máximo de respuestas comprimiéndose a la vez. Las que excedan este número
+// se envían sin comprimir.
+#ifndef YUBOX_GZIP_MAX_STREAMS
+#define YUBOX_GZIP_MAX_STREAMS        2
+#endif
+
+/*
+ * Compresor gzip incremental sobre uzlib, con memoria fija reservada en
+ * begin(). Los datos se escriben directamente en la ventana del compresor,
+ * y la salida comprimida se lee por partes con read().
+ */
+class YuboxGzipEncoder
+{
+private:
+  struct uzlib_comp _comp;
+  uint8_t * _window;
+  size_t _pos;        // Datos ya comprimidos en la ventana
+  size_t _fill;       // Datos escritos en la ventana
+  size_t _outOff;     // Salida ya entregada por read()
+  uint32_t _crc;
+  uint32_t _totalIn;
+  bool _finished;
+
+  void _compress(void);
+  void _slide(void);
+  void _putByte(uint8_t);
+
+public:
+  YuboxGzipEncoder(void);
+  ~YuboxGzipEncoder();
+
+  // Reservar la memoria y escribir la cabecera gzip
+  bool begin(void);
+
+  // Espacio donde escribir los siguientes datos de entrada. Sólo puede pedirse
+  // cuando no hay salida pendiente de leer.
+  uint8_t * inputBuffer(size_t & avail);
+
+  // Registrar n bytes escritos en inputBuffer(). Los datos se comprimen por
+  // bloques, por lo que puede no producirse salida hasta más adelante.
+  void commit(size_t n);
+
+  // Comprimir lo que quede y escribir el cierre del flujo
+  void finish(void);
+
+  size_t pending(void) const { return _comp.out.outlen - _outOff; }
+  size_t read(uint8_t * buf, size_t maxLen);
+
+  bool finished(void) const { return _finished; }
+  uint32_t totalIn(void) const { return _totalIn; }
+};
+
+/*
+ * Compresión gzip al vuelo de respuestas dinámicas. Las respuestas construidas
+ * con beginResponse() y beginChunkedResponse() de esta clase se comprimen si
+ * el cliente acepta gzip y superan el tamaño mínimo, y en caso contrario se
+ * construyen igual que con los métodos de AsyncWebServerRequest.
+ */
+class YuboxGzipClass
+{
+private:
+  bool _enabled;
+  size_t _threshold;
+  portMUX_TYPE _mux;
+  uint8_t _numStreams;
+
+  bool _acquireStream(void);
+
+  friend class YuboxGzipResponse;
+  void _releaseStream(void);
+
+public:
+  YuboxGzipClass(void);
+
+  void setEnabled(bool e) { _enabled = e; }
+  bool isEnabled(void) const { return _enabled; }
+
+  // Tamaño mínimo de respuesta a comprimir
+  void setThreshold(size_t n) { _threshold = n; }
+  size_t threshold(void) const { return _threshold; }
+
+  // Debe llamarse desde canHandle() de los manejadores que usen esta clase,
+  // para que la biblioteca conserve la cabecera Accept-Encoding.
+  void addInterestingHeaders(AsyncWebServerRequest * request);
+
+  // Verdadero si la petición admite una respuesta comprimida con gzip
+  bool accepts(AsyncWebServerRequest * request);
+
+  // Verdadero si la cabecera Accept-Encoding admite la codificación indicada,
+  // como "gzip" o "br", sin considerar si la compresión al vuelo está activa.
+  static bool acceptsEncoding(AsyncWebServerRequest * request, const char * encoding);
+
+  // Respuesta de largo conocido, que se comprime si es de al menos threshold()
+  AsyncWebServerResponse * beginResponse(AsyncWebServerRequest * request, const char * contentType,
+    size_t len, AwsResponseFiller filler);
+
+  // Respuesta de largo desconocido. Se piden de antemano hasta threshold()
+  // bytes, y si el contenido termina antes se envía sin comprimir y con su
+  // largo exacto.
+  AsyncWebServerResponse * beginChunkedResponse(AsyncWebServerRequest * request, const char * contentType,
+    AwsResponseFiller filler);
+};
+
+extern YuboxGzipClass YuboxGzip;
+
+#endif
@@ -0,0 +1,98 @@
+#include <Arduino.h>
+
+#include "YuboxJSONSchema.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef struct
+{
+  portMUX_TYPE mux;
+  uint32_t freemask;
+  uint8_t blocks[YUBOX_JSON_POOL_BLOCKS][YUBOX_JSON_POOL_BLOCKSIZE] __attribute__((aligned(8)));
+} yubox_json_pool_t;
+
+static yubox_json_pool_t _pools[portNUM_PROCESSORS];
+static volatile uint32_t _fallback_count = 0;
+
+// Los pools se inicializan con los constructores globales, antes de setup()
+static struct YuboxJSONPool_init
+{
+  YuboxJSONPool_init(void)
+  {
+    for (auto i = 0; i < portNUM_PROCESSORS; i++) {
+      vPortCPUInitializeMutex(&(_pools[i].mux));
+      _pools[i].freemask = (1UL << YUBOX_JSON_POOL_BLOCKS) - 1;
+    }
+  }
+} _pools_init;
+
+static yubox_json_pool_t * _poolFromPtr(void * p, int & idx)
+{
+  for (auto i = 0; i < portNUM_PROCESSORS; i++) {
+    uint8_t * base = &(_pools[i].blocks[0][0]);
+    if ((uint8_t *)p >= base && (uint8_t *)p < base + sizeof(_pools[i].blocks)) {
+      idx = ((uint8_t *)p - base) / YUBOX_JSON_POOL_BLOCKSIZE;
+      return &(_pools[i]);
+    }
+  }
+  return NULL;
+}
+
+void * YuboxJSONPool::allocate(size_t n)
+{
+  if (n <= YUBOX_JSON_POOL_BLOCKSIZE) {
+    yubox_json_pool_t * pool = &(_pools[xPortGetCoreID()]);
+    int idx = -1;
+
+    portENTER_CRITICAL(&(pool->mux));
+    if (pool->freemask != 0) {
+      idx = __builtin_ctz(pool->freemask);
+      pool->freemask &= ~(1UL << idx);
+    }
+    portEXIT_CRITICAL(&(pool->mux));
+
+    if (idx >= 0) return pool->blocks[idx];
+  }
+
+  _fallback_count++;
+  return malloc(n);
+}
+
+void YuboxJSONPool::deallocate(void * p)
+{
+  if (p == NULL) return;
+
+  int idx;
+  yubox_json_pool_t * pool = _poolFromPtr(p, idx);
+  if (pool == NULL) {
+    free(p);
+    return;
+  }
+
+  portENTER_CRITICAL(&(pool->mux));
+  pool->freemask |= (1UL << idx);
+  portEXIT_CRITICAL(&(pool->mux));
+}
+
+void * YuboxJSONPool::reallocate(void * p, size_t n)
+{
+  int idx;
+  if (p == NULL) return allocate(n);
+  if (_poolFromPtr(p, idx) == NULL) return realloc(p, n);
+
+  // Un bloque del pool no cambia de lugar mientras quepa el nuevo tamaño
+  if (n <= YUBOX_JSON_POOL_BLOCKSIZE) return p;
+
+  void * np = malloc(n);
+  if (np == NULL) return NULL;
+  _fallback_count++;
+  memcpy(np, p, YUBOX_JSON_POOL_BLOCKSIZE);
+  deallocate(p);
+  return np;
+}
+
+uint32_t YuboxJSONPool::fallbackCount(void)
+{
+  return _fallback_count;
+}
@@ -0,0 +1,74 @@
+#ifndef _YUBOX_JSON_SCHEMA_H_
+#define _YUBOX_JSON_SCHEMA_H_
+
+#include <Arduino.h>
+
+#define ARDUINOJSON_USE_LONG_LONG 1
+
+#include "ArduinoJson.h"
+
+// Tamaño y número de bloques del pool de documentos JSON, por núcleo. Todo
+// esquema declarado con YuboxJSONSchema debe caber en un bloque.
+#define YUBOX_JSON_POOL_BLOCKSIZE   256
+#define YUBOX_JSON_POOL_BLOCKS      4
+
+/*
+ * Componentes de un esquema de documento JSON. La capacidad de cada uno se
+ * calcula en tiempo de compilación a partir de las macros de ArduinoJson.
+ * Las cadenas asignadas como const char * no ocupan espacio en el documento,
+ * pero las asignadas como String o char * se copian y deben declararse con
+ * YuboxJSONString<longitud máxima>.
+ */
+template <size_t N> struct YuboxJSONObject { static constexpr size_t capacity = JSON_OBJECT_SIZE(N); };
+template <size_t N> struct YuboxJSONArray { static constexpr size_t capacity = JSON_ARRAY_SIZE(N); };
+template <size_t N> struct YuboxJSONString { static constexpr size_t capacity = JSON_STRING_SIZE(N); };
+
+// Esquema de documento como suma de sus componentes, por ejemplo:
+//  typedef YuboxJSONSchema< YuboxJSONObject<10>, YuboxJSONArray<3> > connection_schema_t;
+template <typename... Parts> struct YuboxJSONSchema;
+template <> struct YuboxJSONSchema<> { static constexpr size_t capacity = 0; };
+template <typename First, typename... Rest> struct YuboxJSONSchema<First, Rest...>
+{
+  static constexpr size_t capacity = First::capacity + YuboxJSONSchema<Rest...>::capacity;
+};
+
+// Esquema común de las respuestas {"success":..., "msg":...}
+typedef YuboxJSONSchema< YuboxJSONObject<2> > YuboxJSONSchema_StatusMsg;
+
+// Pool de bloques de tamaño fijo, uno por núcleo. El bloque se toma del pool
+// del núcleo que ejecuta la petición, y se devuelve al pool del que provino.
+// Si el pool está agotado, el bloque se pide al heap.
+class YuboxJSONPool
+{
+public:
+  static void * allocate(size_t n);
+  static void deallocate(void * p);
+  static void * reallocate(void * p, size_t n);
+
+  // Estadísticas para diagnóstico
+  static uint32_t fallbackCount(void);
+};
+
+struct YuboxJSONPoolAllocator
+{
+  void * allocate(size_t n) { return YuboxJSONPool::allocate(n); }
+  void deallocate(void * p) { YuboxJSONPool::deallocate(p); }
+  void * reallocate(void * p, size_t n) { return YuboxJSONPool::reallocate(p, n); }
+};
+
+typedef BasicJsonDocument<YuboxJSONPoolAllocator> YuboxPooledJsonDocument;
+
+// Documento JSON con la capacidad exacta del esquema, tomado del pool. Un
+// esquema que no cabe en un bloque del pool produce un error de compilación.
+template <typename Schema>
+class YuboxJsonDocument : public YuboxPooledJsonDocument
+{
+public:
+  static constexpr size_t capacity = Schema::capacity;
+  static_assert(Schema::capacity > 0, "Esquema JSON vacío");
+  static_assert(Schema::capacity <= YUBOX_JSON_POOL_BLOCKSIZE, "Esquema JSON excede tamaño de bloque del pool");
+
+  YuboxJsonDocument(void) : YuboxPooledJsonDocument(Schema::capacity) {}
+};
+
+#endif
@@ -0,0 +1,312 @@
+#include <Arduino.h>
+
+#include "YuboxJSONWriter.h"
+#include "YuboxGzipClass.h"
+
+#include <memory>
+#include <stdarg.h>
+
+YuboxJSONWriter::YuboxJSONWriter(char * buf, size_t size)
+{
+  _buf = buf;
+  _size = (buf != NULL) ? size : 0;
+  reset();
+}
+
+void YuboxJSONWriter::reset(void)
+{
+  _len = 0;
+  _depth = 0;
+  _afterKey = false;
+  _hasItems[0] = 0;
+  if (_size > 0) _buf[0] = '\0';
+}
+
+void YuboxJSONWriter::truncate(size_t len)
+{
+  if (len >= _len) return;
+  _len = len;
+  _depth = 0;
+  _afterKey = false;
+  _hasItems[0] = (len > 0) ? 1 : 0;
+  if (_len < _size) _buf[_len] = '\0';
+}
+
+void YuboxJSONWriter::_put(char c)
+{
+  if (_len + 1 < _size) {
+    _buf[_len] = c;
+    _buf[_len + 1] = '\0';
+  }
+  _len++;
+}
+
+void YuboxJSONWriter::_put(const char * s, size_t n)
+{
+  if (_len + n < _size) {
+    memcpy(_buf + _len, s, n);
+    _buf[_len + n] = '\0';
+    _len += n;
+  } else {
+    for (size_t i = 0; i < n; i++) _put(s[i]);
+  }
+}
+
+void YuboxJSONWriter::_beforeValue(void)
+{
+  if (_afterKey) {
+    _afterKey = false;
+    return;
+  }
+  if (_hasItems[_depth]) _put(',');
+  _hasItems[_depth] = 1;
+}
+
+void YuboxJSONWriter::_string(const char * s)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  _put('"');
+  for (; *s != '\0'; s++) {
+    unsigned char c = (unsigned char)*s;
+    switch (c) {
+    case '"':   _put("\\\"", 2); break;
+    case '\\':  _put("\\\\", 2); break;
+    case '\n':  _put("\\n", 2); break;
+    case '\r':  _put("\\r", 2); break;
+    case '\t':  _put("\\t", 2); break;
+    default:
+      if (c < 0x20) {
+        char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0f] };
+        _put(u, sizeof(u));
+      } else {
+        _put((char)c);
+      }
+      break;
+    }
+  }
+  _put('"');
+}
+
+void YuboxJSONWriter::_number(const char * fmt, ...)
+{
+  char tmp[24];
+  va_list ap;
+
+  va_start(ap, fmt);
+  int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+  va_end(ap);
+  if (n > 0) _put(tmp, (n < sizeof(tmp)) ? n : sizeof(tmp) - 1);
+}
+
+YuboxJSONWriter & YuboxJSONWriter::beginObject(void)
+{
+  _beforeValue();
+  _put('{');
+  if (_depth + 1 < YUBOX_JSON_WRITER_MAX_DEPTH) {
+    _depth++;
+    _hasItems[_depth] = 0;
+  } else {
+    log_e("profundidad máxima de JSON excedida");
+  }
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::endObject(void)
+{
+  if (_depth > 0) _depth--;
+  _put('}');
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::beginArray(void)
+{
+  _beforeValue();
+  _put('[');
+  if (_depth + 1 < YUBOX_JSON_WRITER_MAX_DEPTH) {
+    _depth++;
+    _hasItems[_depth] = 0;
+  } else {
+    log_e("profundidad máxima de JSON excedida");
+  }
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::endArray(void)
+{
+  if (_depth > 0) _depth--;
+  _put(']');
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::key(const char * k)
+{
+  _beforeValue();
+  _string(k);
+  _put(':');
+  _afterKey = true;
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(const char * s)
+{
+  if (s == NULL) return valueNull();
+  _beforeValue();
+  _string(s);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(bool b)
+{
+  _beforeValue();
+  if (b) _put("true", 4); else _put("false", 5);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(int n)
+{
+  _beforeValue();
+  _number("%d", n);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(unsigned int n)
+{
+  _beforeValue();
+  _number("%u", n);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(long n)
+{
+  _beforeValue();
+  _number("%ld", n);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(unsigned long n)
+{
+  _beforeValue();
+  _number("%lu", n);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(long long n)
+{
+  _beforeValue();
+  _number("%lld", n);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(unsigned long long n)
+{
+  _beforeValue();
+  _number("%llu", n);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(float n)
+{
+  if (isnan(n) || isinf(n)) return valueNull();
+  _beforeValue();
+  _number("%.7g", (double)n);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::value(double n)
+{
+  if (isnan(n) || isinf(n)) return valueNull();
+  _beforeValue();
+  _number("%.15g", n);
+  return *this;
+}
+
+YuboxJSONWriter & YuboxJSONWriter::valueNull(void)
+{
+  _beforeValue();
+  _put("null", 4);
+  return *this;
+}
+
+typedef struct
+{
+  YuboxJSONWriter::ArrayItemWriter cb;
+  size_t idx;         // Siguiente elemento a pedir al callback
+  size_t emitted;     // Elementos ya escritos, para decidir '[' o la coma
+  uint8_t phase;      // 0: elementos, 1: falta ']', 2: fin
+  bool failed;        // Un elemento no cupo en el registro
+  size_t pendOff;
+  size_t pendLen;
+  char pend[YUBOX_JSON_WRITER_RECORD_SIZE];
+} yubox_json_array_state_t;
+
+// Avanzar el arreglo un paso, dejando en pend lo siguiente a enviar
+static void _arrayNext(yubox_json_array_state_t * st)
+{
+  st->pendOff = 0;
+  st->pendLen = 0;
+  if (st->phase == 0) {
+    // Se reserva el primer byte para '[' o la coma separadora
+    YuboxJSONWriter w(st->pend + 1, sizeof(st->pend) - 1);
+    if (!st->cb(w, st->idx)) {
+      st->phase = 1;
+      return;
+    }
+    if (w.overflow()) {
+      // Omitir el elemento entregaría un arreglo válido pero incompleto. Se
+      // corta el arreglo para que el cliente no lo tome como completo.
+      log_e("elemento %u de arreglo JSON excede %u bytes, se interrumpe arreglo", st->idx, sizeof(st->pend) - 1);
+      st->failed = true;
+      st->phase = 2;
+      return;
+    }
+    if (w.length() > 0) {
+      st->pend[0] = (st->emitted > 0) ? ',' : '[';
+      st->pendLen = w.length() + 1;
+      st->emitted++;
+    }
+    st->idx++;
+  } else if (st->phase == 1) {
+    if (st->emitted == 0) st->pend[st->pendLen++] = '[';
+    st->pend[st->pendLen++] = ']';
+    st->phase = 2;
+  }
+}
+
+AsyncWebServerResponse * YuboxJSONWriter::beginArrayResponse(AsyncWebServerRequest * request, ArrayItemWriter cb)
+{
+  std::shared_ptr<yubox_json_array_state_t> st = std::make_shared<yubox_json_array_state_t>();
+  st->cb = cb;
+  st->idx = 0;
+  st->emitted = 0;
+  st->phase = 0;
+  st->failed = false;
+  st->pendOff = 0;
+  st->pendLen = 0;
+
+  // El primer elemento se genera antes de enviar las cabeceras, para que uno
+  // que no cabe todavía pueda reportarse con un código de error.
+  while (st->phase < 2 && st->pendLen == 0) _arrayNext(st.get());
+  if (st->failed) {
+    return request->beginResponse(500, "application/json", "{\"success\":false,\"msg\":\"Elemento de reporte excede tama\\u00f1o m\\u00e1ximo\"}");
+  }
+
+  return YuboxGzip.beginChunkedResponse(request, "application/json", [st](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+    size_t n = 0;
+
+    while (n < maxLen) {
+      // Copiar lo pendiente del paso anterior, tanto como quepa
+      if (st->pendOff < st->pendLen) {
+        size_t c = st->pendLen - st->pendOff;
+        if (c > maxLen - n) c = maxLen - n;
+        memcpy(buf + n, st->pend + st->pendOff, c);
+        st->pendOff += c;
+        n += c;
+        continue;
+      }
+      if (st->phase == 2) break;
+      _arrayNext(st.get());
+    }
+    return n;
+  });
+}
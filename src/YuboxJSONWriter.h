@@ -0,0 +1,94 @@
+#ifndef _YUBOX_JSON_WRITER_H_
+#define _YUBOX_JSON_WRITER_H_
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include <functional>
+
+// Máxima profundidad de anidamiento de objetos y arreglos
+#define YUBOX_JSON_WRITER_MAX_DEPTH     8
+
+// Tamaño del búfer de registro usado por beginArrayResponse(). Cada elemento
+// del arreglo debe caber completo en este espacio.
+#define YUBOX_JSON_WRITER_RECORD_SIZE   512
+
+// Escritor de JSON sobre un búfer de tamaño fijo, sin memoria dinámica. Si el
+// búfer se llena, la escritura se detiene pero length() sigue contando los
+// bytes necesarios, por lo que un escritor con búfer NULL sirve para medir de
+// antemano el tamaño exacto de un documento.
+class YuboxJSONWriter
+{
+private:
+  char * _buf;
+  size_t _size;
+  size_t _len;
+  uint8_t _depth;
+  bool _afterKey;
+  uint8_t _hasItems[YUBOX_JSON_WRITER_MAX_DEPTH];
+
+  void _put(char);
+  void _put(const char *, size_t);
+  void _beforeValue(void);
+  void _string(const char *);
+  void _number(const char *, ...) __attribute__ ((format (printf, 2, 3)));
+
+public:
+  YuboxJSONWriter(char * buf, size_t size);
+
+  void reset(void);
+
+  // Bytes necesarios para el documento escrito hasta ahora, sin el '\0'
+  size_t length(void) const { return _len; }
+  bool overflow(void) const { return (_buf == NULL || _len >= _size); }
+  const char * c_str(void) const { return overflow() ? NULL : _buf; }
+
+  // Descartar lo escrito a partir de la posición indicada. Sólo debe usarse
+  // para deshacer un valor completo al nivel superior.
+  void truncate(size_t len);
+
+  YuboxJSONWriter & beginObject(void);
+  YuboxJSONWriter & endObject(void);
+  YuboxJSONWriter & beginArray(void);
+  YuboxJSONWriter & endArray(void);
+  YuboxJSONWriter & key(const char *);
+
+  YuboxJSONWriter & value(const char *);     // NULL se escribe como null
+  YuboxJSONWriter & value(const String & s) { return value(s.c_str()); }
+  YuboxJSONWriter & value(bool);
+  YuboxJSONWriter & value(int);
+  YuboxJSONWriter & value(unsigned int);
+  YuboxJSONWriter & value(long);
+  YuboxJSONWriter & value(unsigned long);
+  YuboxJSONWriter & value(long long);
+  YuboxJSONWriter & value(unsigned long long);
+  YuboxJSONWriter & value(float);             // NaN e infinito se escriben como null
+  YuboxJSONWriter & value(double);
+  YuboxJSONWriter & valueNull(void);
+
+  // Atajo para key(k).value(v)
+  template<typename T> YuboxJSONWriter & field(const char * k, const T & v) { return key(k).value(v); }
+
+  // Escribir un documento ArduinoJson como un solo valor
+  template<typename TDoc> YuboxJSONWriter & document(const TDoc & doc)
+  {
+    _beforeValue();
+    serializeJson(doc, *this);
+    return *this;
+  }
+
+  // Escritura cruda, para uso de serializeJson() a través de document()
+  size_t write(uint8_t c) { _put((char)c); return 1; }
+  size_t write(const uint8_t * s, size_t n) { _put((const char *)s, n); return n; }
+
+  // Construir una respuesta chunked con un arreglo JSON. El callback escribe el
+  // elemento idx como un solo valor y devuelve verdadero, o devuelve falso si no
+  // hay más elementos. Los elementos se generan a medida que TCP tiene espacio,
+  // por lo que el consumo de memoria no depende del número de elementos. Si el
+  // primer elemento excede YUBOX_JSON_WRITER_RECORD_SIZE se devuelve una
+  // respuesta 500; si es uno posterior, el arreglo se corta sin cerrarse.
+  typedef std::function<bool(YuboxJSONWriter &, size_t idx)> ArrayItemWriter;
+  static AsyncWebServerResponse * beginArrayResponse(AsyncWebServerRequest * request, ArrayItemWriter cb);
+};
+
+#endif
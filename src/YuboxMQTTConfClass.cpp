@@ -1,6 +1,9 @@
 #include "YuboxWiFiClass.h"
 #include "YuboxMQTTConfClass.h"
 #include "YuboxWebAuthClass.h"
+#include "YuboxRouterClass.h"
+#include "YuboxResponseCacheClass.h"
+#include "YuboxStatusClass.h"
 
 #include <functional>
 
@@ -11,10 +14,14 @@
 
 #include "AsyncJson.h"
 #include "ArduinoJson.h"
+#include "YuboxJSONSchema.h"
 
 #define MQTT_PORT 1883
 
 const char * YuboxMQTTConfClass::_ns_nvram_yuboxframework_mqtt = "YUBOX/MQTT";
+static const char * _cachekey_mqttconfjson = "/yubox-api/mqtt/conf.json";
+
+typedef YuboxJSONSchema< YuboxJSONObject<7> > mqttconf_schema_t;
 
 void _cb_YuboxMQTTConfClass_connectMQTT(TimerHandle_t);
 YuboxMQTTConfClass::YuboxMQTTConfClass(void)
@@ -28,6 +35,7 @@ YuboxMQTTConfClass::YuboxMQTTConfClass(void)
     pdFALSE,
     (void*)this,
     &_cb_YuboxMQTTConfClass_connectMQTT);
+  _mqttClient.onConnect(std::bind(&YuboxMQTTConfClass::_cbHandler_onMqttConnect, this, std::placeholders::_1));
   _mqttClient.onDisconnect(std::bind(&YuboxMQTTConfClass::_cbHandler_onMqttDisconnect, this, std::placeholders::_1));
 }
 
@@ -105,15 +113,23 @@ void YuboxMQTTConfClass::_connectMQTT(void)
 void YuboxMQTTConfClass::setAutoConnect(bool c)
 {
   _autoConnect = c;
+  YuboxResponseCache.invalidate(_cachekey_mqttconfjson);
   if (WiFi.isConnected() && _autoConnect && !_mqttClient.connected()) {
     //Serial.println("DEBUG: YuboxMQTTConfClass::setAutoConnect se intenta arrancar MQTT...");
     _connectMQTT();
   }
 }
 
+void YuboxMQTTConfClass::_cbHandler_onMqttConnect(bool sessionPresent)
+{
+  // El estado de conexión es parte de la respuesta de conf.json
+  YuboxResponseCache.invalidate(_cachekey_mqttconfjson);
+}
+
 void YuboxMQTTConfClass::_cbHandler_onMqttDisconnect(AsyncMqttClientDisconnectReason reason)
 {
   _lastdisconnect = reason;
+  YuboxResponseCache.invalidate(_cachekey_mqttconfjson);
   //Serial.printf("DEBUG: YuboxMQTTConfClass::_cbHandler_onMqttDisconnect Disconnected from MQTT reason=%d\r\n.", reason);
 
   if (WiFi.isConnected()) {
@@ -123,17 +139,33 @@ void YuboxMQTTConfClass::_cbHandler_onMqttDisconnect(AsyncMqttClientDisconnectRe
 
 void YuboxMQTTConfClass::_setupHTTPRoutes(AsyncWebServer & srv)
 {
-  srv.on("/yubox-api/mqtt/conf.json", HTTP_GET, std::bind(&YuboxMQTTConfClass::_routeHandler_yuboxAPI_mqttconfjson_GET, this, std::placeholders::_1));
-  srv.on("/yubox-api/mqtt/conf.json", HTTP_POST, std::bind(&YuboxMQTTConfClass::_routeHandler_yuboxAPI_mqttconfjson_POST, this, std::placeholders::_1));
+  YuboxRouter.begin(srv);
+  YuboxRouter.on("/yubox-api/mqtt/conf.json", HTTP_GET, std::bind(&YuboxMQTTConfClass::_routeHandler_yuboxAPI_mqttconfjson_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/mqtt/conf.json", HTTP_POST, std::bind(&YuboxMQTTConfClass::_routeHandler_yuboxAPI_mqttconfjson_POST, this, std::placeholders::_1));
+
+  YuboxStatus.begin(srv);
+  YuboxStatus.addProvider("mqtt/conf.json", [this](YuboxJSONWriter & json) {
+    YuboxJsonDocument<mqttconf_schema_t> json_doc;
+    _buildConfJSON(json_doc);
+    json.document(json_doc);
+  });
 }
 
 void YuboxMQTTConfClass::_routeHandler_yuboxAPI_mqttconfjson_GET(AsyncWebServerRequest *request)
 {
   YUBOX_RUN_AUTH(request);
-  
-  AsyncResponseStream *response = request->beginResponseStream("application/json");
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(8));
 
+  uint32_t cachegen;
+  if (YuboxResponseCache.send(request, _cachekey_mqttconfjson, cachegen)) return;
+
+  YuboxJsonDocument<mqttconf_schema_t> json_doc;
+  _buildConfJSON(json_doc);
+
+  YuboxResponseCache.storeAndSend(request, _cachekey_mqttconfjson, cachegen, json_doc);
+}
+
+void YuboxMQTTConfClass::_buildConfJSON(JsonDocument & json_doc)
+{
   // Valores informativos, no pueden cambiarse vía web
   json_doc["want2connect"] = _autoConnect;
   if (_mqttClient.connected()) {
@@ -160,9 +192,6 @@ void YuboxMQTTConfClass::_routeHandler_yuboxAPI_mqttconfjson_GET(AsyncWebServerR
     json_doc["user"] = (char *)NULL;
     json_doc["pass"] = (char *)NULL;
   }
-
-  serializeJson(json_doc, *response);
-  request->send(response);
 }
 
 #define NVRAM_PUTSTRING(nvram, k, s) \
@@ -261,6 +290,7 @@ void YuboxMQTTConfClass::_routeHandler_yuboxAPI_mqttconfjson_POST(AsyncWebServer
         _mqttClient.disconnect();
       }
       _loadSavedCredentialsFromNVRAM();
+      YuboxResponseCache.invalidate(_cachekey_mqttconfjson);
       if (WiFi.isConnected()) _connectMQTT();
     }
   }
@@ -274,7 +304,7 @@ void YuboxMQTTConfClass::_routeHandler_yuboxAPI_mqttconfjson_POST(AsyncWebServer
 
   AsyncResponseStream *response = request->beginResponseStream("application/json");
   response->setCode(httpCode);
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(2));
+  YuboxJsonDocument<YuboxJSONSchema_StatusMsg> json_doc;
   json_doc["success"] = !(clientError || serverError);
   json_doc["msg"] = responseMsg.c_str();
 
@@ -38,10 +38,12 @@ private:
 
   void _routeHandler_yuboxAPI_mqttconfjson_GET(AsyncWebServerRequest *);
   void _routeHandler_yuboxAPI_mqttconfjson_POST(AsyncWebServerRequest *);
+  void _buildConfJSON(JsonDocument &);
 
   bool _isValidHostname(String & h);
 
   void _cbHandler_WiFiEvent(WiFiEvent_t event);
+  void _cbHandler_onMqttConnect(bool sessionPresent);
   void _cbHandler_onMqttDisconnect(AsyncMqttClientDisconnectReason reason);
   void _connectMQTT(void);
 
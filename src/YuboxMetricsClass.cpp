@@ -0,0 +1,444 @@
+#include <Arduino.h>
+
+#include "YuboxMetricsClass.h"
+#include "YuboxWebAuthClass.h"
+#include "YuboxRouterClass.h"
+#include "YuboxJSONWriter.h"
+#include "YuboxGzipClass.h"
+
+#include "lwip/tcp.h"
+
+#include <memory>
+
+// Espacio para todas las líneas de una familia de métricas de una sola ruta.
+// Un histograma ocupa una línea por bucket más la suma y la cuenta.
+#define YUBOX_METRICS_RECORD_SIZE     1536
+
+static const uint32_t _bucketBoundsMs[YUBOX_METRICS_BUCKETS - 1] = YUBOX_METRICS_BUCKET_BOUNDS;
+
+// Familias de métricas en el orden en que se exportan
+typedef enum
+{
+  METRICS_REQUESTS,
+  METRICS_TTFB,
+  METRICS_DURATION,
+  METRICS_BYTES,
+  METRICS_HEAP_BEFORE,
+  METRICS_HEAP_AFTER,
+  METRICS_HEAP_AFTER_MIN,
+  METRICS_GLOBAL,
+  METRICS_END
+} metrics_family_t;
+
+static const char * _methodName(WebRequestMethodComposite method)
+{
+  switch (method) {
+  case HTTP_GET:      return "GET";
+  case HTTP_POST:     return "POST";
+  case HTTP_DELETE:   return "DELETE";
+  case HTTP_PUT:      return "PUT";
+  case HTTP_PATCH:    return "PATCH";
+  case HTTP_HEAD:     return "HEAD";
+  case HTTP_OPTIONS:  return "OPTIONS";
+  default:            return "ANY";
+  }
+}
+
+// Manejador que mide las peticiones de otro y le delega todo lo demás
+class YuboxMetricsHandler : public AsyncWebHandler
+{
+private:
+  AsyncWebHandler * _inner;
+  int16_t _slot;
+
+public:
+  YuboxMetricsHandler(AsyncWebHandler * inner, int16_t slot) : _inner(inner), _slot(slot) {}
+
+  virtual bool canHandle(AsyncWebServerRequest * request) override final
+  {
+    return _inner->filter(request) && _inner->canHandle(request);
+  }
+
+  virtual void handleRequest(AsyncWebServerRequest * request) override final
+  {
+    YuboxMetricsSample ms;
+    YuboxMetrics.beginRequest(ms, request, _slot);
+    _inner->handleRequest(request);
+    YuboxMetrics.endRequest(ms, request);
+  }
+
+  virtual void handleUpload(AsyncWebServerRequest * request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) override final
+  {
+    _inner->handleUpload(request, filename, index, data, len, final);
+  }
+
+  virtual void handleBody(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total) override final
+  {
+    _inner->handleBody(request, data, len, index, total);
+  }
+
+  virtual bool isRequestHandlerTrivial(void) override final { return _inner->isRequestHandlerTrivial(); }
+};
+
+int8_t (*YuboxMetricsClass::_lwipSent)(void *, struct tcp_pcb *, uint16_t) = NULL;
+
+YuboxMetricsClass::YuboxMetricsClass(void)
+{
+  _numRoutes = 0;
+  _routesInstalled = false;
+  memset(_conns, 0, sizeof(_conns));
+  vPortCPUInitializeMutex(&_mux);
+}
+
+void YuboxMetricsClass::begin(AsyncWebServer & srv)
+{
+  if (_routesInstalled) return;
+
+  YuboxRouter.begin(srv);
+  YuboxRouter.on("/yubox-api/metrics", HTTP_GET, std::bind(&YuboxMetricsClass::_routeHandler_yuboxAPI_metrics_GET, this, std::placeholders::_1));
+  _routesInstalled = true;
+}
+
+int16_t YuboxMetricsClass::registerRoute(const char * label, WebRequestMethodComposite method, bool handoff)
+{
+  int16_t slot = -1;
+
+  portENTER_CRITICAL(&_mux);
+  if (_numRoutes < YUBOX_METRICS_MAX_ROUTES) {
+    slot = _numRoutes;
+    route_t & r = _routes[slot];
+    memset(&r, 0, sizeof(route_t));
+    r.method = method;
+    r.heapAfterMin = UINT32_MAX;
+    r.handoff = handoff;
+
+    // Las comillas y barras invertidas no pueden aparecer en una etiqueta
+    // de Prometheus sin escaparse, y no tienen uso en una ruta.
+    size_t i;
+    for (i = 0; i + 1 < sizeof(r.label) && label[i] != '\0'; i++) {
+      r.label[i] = (label[i] == '"' || label[i] == '\\') ? '_' : label[i];
+    }
+    r.label[i] = '\0';
+    _numRoutes++;
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  if (slot < 0) log_w("tabla de métricas llena, no se mide %s", label);
+  return slot;
+}
+
+AsyncWebHandler * YuboxMetricsClass::wrap(AsyncWebHandler * handler, const char * label, bool handoff)
+{
+  int16_t slot = registerRoute(label, HTTP_ANY, handoff);
+  if (slot < 0) return handler;
+  return new YuboxMetricsHandler(handler, slot);
+}
+
+uint8_t YuboxMetricsClass::_bucket(uint32_t us)
+{
+  uint32_t ms = us / 1000;
+  uint8_t i;
+  for (i = 0; i < YUBOX_METRICS_BUCKETS - 1; i++) {
+    if (ms <= _bucketBoundsMs[i]) break;
+  }
+  return i;
+}
+
+int8_t YuboxMetricsClass::_cbHandler_tcpSent(void * arg, struct tcp_pcb * pcb, uint16_t len)
+{
+  // Se ejecuta en la tarea de lwIP con cada confirmación del cliente
+  YuboxMetricsClass & m = YuboxMetrics;
+  portENTER_CRITICAL(&m._mux);
+  for (auto i = 0; i < YUBOX_METRICS_MAX_CONNS; i++) {
+    if (m._conns[i].pcb == pcb) {
+      m._conns[i].acked += len;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&m._mux);
+
+  return _lwipSent(arg, pcb, len);
+}
+
+int8_t YuboxMetricsClass::_trackConnection(struct tcp_pcb * pcb)
+{
+  if (pcb == NULL) return -1;
+
+  // Todas las conexiones de AsyncTCP comparten el mismo callback de envío,
+  // que se invoca desde el nuestro luego de contar los bytes.
+  if (_lwipSent == NULL) _lwipSent = pcb->sent;
+  if (pcb->sent != _lwipSent) return -1;
+
+  // Una fila con el mismo pcb quedó de una conexión anterior que no llegó a
+  // cerrarse por esta vía, y se reutiliza.
+  int8_t idx = -1;
+  portENTER_CRITICAL(&_mux);
+  for (auto i = 0; i < YUBOX_METRICS_MAX_CONNS; i++) {
+    if (_conns[i].pcb == pcb || (idx < 0 && _conns[i].pcb == NULL)) idx = i;
+    if (_conns[i].pcb == pcb) break;
+  }
+  if (idx >= 0) {
+    _conns[idx].pcb = pcb;
+    _conns[idx].acked = 0;
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  if (idx >= 0) tcp_sent(pcb, &YuboxMetricsClass::_cbHandler_tcpSent);
+  return idx;
+}
+
+uint32_t YuboxMetricsClass::_releaseConnection(int8_t idx)
+{
+  if (idx < 0) return 0;
+
+  // AsyncTCP ya quitó el callback de envío al cerrar la conexión
+  portENTER_CRITICAL(&_mux);
+  uint32_t acked = _conns[idx].acked;
+  _conns[idx].pcb = NULL;
+  _conns[idx].acked = 0;
+  portEXIT_CRITICAL(&_mux);
+
+  return acked;
+}
+
+void YuboxMetricsClass::beginRequest(YuboxMetricsSample & ms, AsyncWebServerRequest * request, int16_t slot)
+{
+  ms.slot = slot;
+  if (slot < 0) return;
+
+  ms.start = micros();
+  ms.heapBefore = ESP.getFreeHeap();
+
+  // La petición se destruye sin aviso de desconexión cuando el manejador se
+  // queda con la conexión, por lo que no hay final que medir.
+  if (_routes[slot].handoff) return;
+
+  // El final se registra al cerrarse la conexión. La captura cabe en el
+  // búfer interno de std::function, por lo que no pide memoria.
+  int8_t conn = _trackConnection(request->client()->pcb());
+  uint32_t start = ms.start;
+  request->onDisconnect([slot, start, conn]() {
+    YuboxMetrics._recordTotal(slot, micros() - start, ESP.getFreeHeap(), YuboxMetrics._releaseConnection(conn));
+  });
+}
+
+void YuboxMetricsClass::endRequest(YuboxMetricsSample & ms, AsyncWebServerRequest * request)
+{
+  if (ms.slot < 0) return;
+
+  uint32_t us = micros() - ms.start;
+  uint8_t b = _bucket(us);
+
+  portENTER_CRITICAL(&_mux);
+  route_t & r = _routes[ms.slot];
+  r.count++;
+  r.ttfb[b]++;
+  r.ttfbSumUs += us;
+  r.heapBefore = ms.heapBefore;
+  portEXIT_CRITICAL(&_mux);
+}
+
+void YuboxMetricsClass::_recordTotal(int16_t slot, uint32_t us, uint32_t heapAfter, uint32_t bytes)
+{
+  uint8_t b = _bucket(us);
+
+  portENTER_CRITICAL(&_mux);
+  route_t & r = _routes[slot];
+  r.total[b]++;
+  r.totalSumUs += us;
+  r.bytes += bytes;
+  r.heapAfter = heapAfter;
+  if (heapAfter < r.heapAfterMin) r.heapAfterMin = heapAfter;
+  portEXIT_CRITICAL(&_mux);
+}
+
+bool YuboxMetricsClass::_snapshot(size_t idx, route_t & r)
+{
+  bool ok = false;
+
+  portENTER_CRITICAL(&_mux);
+  if (idx < _numRoutes) {
+    memcpy(&r, &(_routes[idx]), sizeof(route_t));
+    ok = true;
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  return ok;
+}
+
+#define METRICS_APPEND(...) \
+  do { if (n < size) n += snprintf(buf + n, size - n, __VA_ARGS__); } while (0)
+
+static size_t _writeHistogram(char * buf, size_t size, const char * name, const char * labels,
+  const uint32_t * buckets, uint64_t sumUs)
+{
+  size_t n = 0;
+  uint32_t acc = 0;
+
+  for (auto i = 0; i < YUBOX_METRICS_BUCKETS - 1; i++) {
+    acc += buckets[i];
+    METRICS_APPEND("%s_bucket{%s,le=\"%.3f\"} %u\n", name, labels, _bucketBoundsMs[i] / 1000.0, acc);
+  }
+  acc += buckets[YUBOX_METRICS_BUCKETS - 1];
+  METRICS_APPEND("%s_bucket{%s,le=\"+Inf\"} %u\n", name, labels, acc);
+  METRICS_APPEND("%s_sum{%s} %.6f\n", name, labels, sumUs / 1000000.0);
+  METRICS_APPEND("%s_count{%s} %u\n", name, labels, acc);
+  return n;
+}
+
+size_t YuboxMetricsClass::_writePrometheus(char * buf, size_t size, size_t family, size_t idx)
+{
+  static const char * const headers[] = {
+    "# HELP yubox_http_requests_total Peticiones atendidas por ruta\n"
+    "# TYPE yubox_http_requests_total counter\n",
+    "# HELP yubox_http_ttfb_seconds Tiempo hasta que el manejador entrega la respuesta\n"
+    "# TYPE yubox_http_ttfb_seconds histogram\n",
+    "# HELP yubox_http_duration_seconds Tiempo hasta el cierre de la conexión\n"
+    "# TYPE yubox_http_duration_seconds histogram\n",
+    "# HELP yubox_http_response_bytes_total Bytes de respuesta confirmados por el cliente\n"
+    "# TYPE yubox_http_response_bytes_total counter\n",
+    "# HELP yubox_http_heap_before_bytes Heap libre al iniciar la última petición\n"
+    "# TYPE yubox_http_heap_before_bytes gauge\n",
+    "# HELP yubox_http_heap_after_bytes Heap libre al cerrar la última petición\n"
+    "# TYPE yubox_http_heap_after_bytes gauge\n",
+    "# HELP yubox_http_heap_after_min_bytes Menor heap libre al cerrar una petición\n"
+    "# TYPE yubox_http_heap_after_min_bytes gauge\n",
+  };
+  size_t n = 0;
+
+  if (family == METRICS_GLOBAL) {
+    METRICS_APPEND("# HELP yubox_heap_free_bytes Heap libre\n# TYPE yubox_heap_free_bytes gauge\n");
+    METRICS_APPEND("yubox_heap_free_bytes %u\n", ESP.getFreeHeap());
+    METRICS_APPEND("# HELP yubox_heap_min_free_bytes Menor heap libre desde el arranque\n# TYPE yubox_heap_min_free_bytes gauge\n");
+    METRICS_APPEND("yubox_heap_min_free_bytes %u\n", ESP.getMinFreeHeap());
+    return n;
+  }
+
+  route_t r;
+  if (!_snapshot(idx, r)) return 0;
+
+  char labels[YUBOX_METRICS_LABEL_LEN + 32];
+  snprintf(labels, sizeof(labels), "route=\"%s\",method=\"%s\"", r.label, _methodName(r.method));
+
+  if (idx == 0) METRICS_APPEND("%s", headers[family]);
+  switch (family) {
+  case METRICS_REQUESTS:
+    METRICS_APPEND("yubox_http_requests_total{%s} %u\n", labels, r.count);
+    break;
+  case METRICS_TTFB:
+    if (n < size) n += _writeHistogram(buf + n, size - n, "yubox_http_ttfb_seconds", labels, r.ttfb, r.ttfbSumUs);
+    break;
+  case METRICS_DURATION:
+    if (r.handoff) break;
+    if (n < size) n += _writeHistogram(buf + n, size - n, "yubox_http_duration_seconds", labels, r.total, r.totalSumUs);
+    break;
+  case METRICS_BYTES:
+    if (r.handoff) break;
+    METRICS_APPEND("yubox_http_response_bytes_total{%s} %llu\n", labels, (unsigned long long)r.bytes);
+    break;
+  case METRICS_HEAP_BEFORE:
+    if (r.count > 0) METRICS_APPEND("yubox_http_heap_before_bytes{%s} %u\n", labels, r.heapBefore);
+    break;
+  case METRICS_HEAP_AFTER:
+    if (r.heapAfterMin != UINT32_MAX) METRICS_APPEND("yubox_http_heap_after_bytes{%s} %u\n", labels, r.heapAfter);
+    break;
+  case METRICS_HEAP_AFTER_MIN:
+    if (r.heapAfterMin != UINT32_MAX) METRICS_APPEND("yubox_http_heap_after_min_bytes{%s} %u\n", labels, r.heapAfterMin);
+    break;
+  }
+  return n;
+}
+
+typedef struct
+{
+  size_t family;
+  size_t idx;
+  char pend[YUBOX_METRICS_RECORD_SIZE];
+  size_t pendOff;
+  size_t pendLen;
+} yubox_metrics_prom_state_t;
+
+void YuboxMetricsClass::_routeHandler_yuboxAPI_metrics_GET(AsyncWebServerRequest * request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  AsyncWebServerResponse * response;
+  if (request->hasParam("format") && request->getParam("format")->value() == "json") {
+    response = YuboxJSONWriter::beginArrayResponse(request, [this](YuboxJSONWriter & json, size_t idx) -> bool {
+      route_t r;
+      if (!_snapshot(idx, r)) return false;
+
+      json.beginObject();
+      json.field("route", (const char *)r.label);
+      json.field("method", _methodName(r.method));
+      json.field("count", r.count);
+      json.key("le_ms").beginArray();
+      for (auto i = 0; i < YUBOX_METRICS_BUCKETS - 1; i++) json.value(_bucketBoundsMs[i]);
+      json.endArray();
+      json.key("ttfb").beginObject();
+      json.key("buckets").beginArray();
+      for (auto i = 0; i < YUBOX_METRICS_BUCKETS; i++) json.value(r.ttfb[i]);
+      json.endArray();
+      json.field("sum_us", r.ttfbSumUs);
+      json.endObject();
+      if (r.handoff) {
+        json.key("total").valueNull();
+        json.key("bytes").valueNull();
+      } else {
+        json.key("total").beginObject();
+        json.key("buckets").beginArray();
+        for (auto i = 0; i < YUBOX_METRICS_BUCKETS; i++) json.value(r.total[i]);
+        json.endArray();
+        json.field("sum_us", r.totalSumUs);
+        json.endObject();
+        json.field("bytes", r.bytes);
+      }
+      json.field("heap_before", r.heapBefore);
+      json.field("heap_after", r.heapAfter);
+      if (r.heapAfterMin != UINT32_MAX) json.field("heap_after_min", r.heapAfterMin); else json.key("heap_after_min").valueNull();
+      json.endObject();
+      return true;
+    });
+  } else {
+    std::shared_ptr<yubox_metrics_prom_state_t> st = std::make_shared<yubox_metrics_prom_state_t>();
+    st->family = 0;
+    st->idx = 0;
+    st->pendOff = 0;
+    st->pendLen = 0;
+
+    response = YuboxGzip.beginChunkedResponse(request, "text/plain; version=0.0.4", [this, st](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+      size_t n = 0;
+
+      while (n < maxLen) {
+        // Copiar lo pendiente del registro anterior, tanto como quepa
+        if (st->pendOff < st->pendLen) {
+          size_t c = st->pendLen - st->pendOff;
+          if (c > maxLen - n) c = maxLen - n;
+          memcpy(buf + n, st->pend + st->pendOff, c);
+          st->pendOff += c;
+          n += c;
+          continue;
+        }
+        if (st->family >= METRICS_END) break;
+
+        st->pendOff = 0;
+        st->pendLen = _writePrometheus(st->pend, sizeof(st->pend), st->family, st->idx);
+        if (st->pendLen >= sizeof(st->pend)) {
+          log_e("registro de métricas excede %u bytes, se omite", sizeof(st->pend));
+          st->pendLen = 0;
+        }
+        if (st->family == METRICS_GLOBAL || st->idx >= _numRoutes) {
+          st->family++;
+          st->idx = 0;
+        } else {
+          st->idx++;
+        }
+      }
+      return n;
+    });
+  }
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+YuboxMetricsClass YuboxMetrics;
@@ -0,0 +1,114 @@
+#ifndef _YUBOX_METRICS_CLASS_H_
+#define _YUBOX_METRICS_CLASS_H_
+
+#include <ESPAsyncWebServer.h>
+
+// Máximo de rutas y manejadores con métricas propias. Los que se registren
+// después de llenarse la tabla no se miden.
+#define YUBOX_METRICS_MAX_ROUTES      40
+
+// Largo máximo de la etiqueta de ruta, incluyendo el '\0'
+#define YUBOX_METRICS_LABEL_LEN       48
+
+// Límites superiores de los buckets de latencia, en milisegundos. Hay un
+// bucket adicional para las peticiones que exceden el último límite.
+#define YUBOX_METRICS_BUCKET_BOUNDS   { 5, 10, 25, 50, 100, 250, 500, 1000, 2500 }
+#define YUBOX_METRICS_BUCKETS         10
+
+// Máximo de conexiones medidas a la vez. Coincide con el máximo de conexiones
+// TCP activas por omisión de lwIP en ESP32.
+#define YUBOX_METRICS_MAX_CONNS       16
+
+struct tcp_pcb;
+
+// Estado de una petición en curso. Vive en la pila del manejador, por lo que
+// medir una petición no pide memoria.
+typedef struct
+{
+  int16_t slot;
+  uint32_t start;
+  uint32_t heapBefore;
+} YuboxMetricsSample;
+
+/*
+ * Métricas por ruta de las peticiones HTTP: cantidad, latencia hasta el primer
+ * byte y hasta el cierre de la conexión como histogramas, bytes de respuesta,
+ * y heap libre antes y después. Toda la memoria es una tabla fija reservada de
+ * antemano. Las rutas de YuboxRouter se miden automáticamente, y cualquier
+ * otro manejador puede envolverse con wrap().
+ *
+ * El primer byte se toma al volver el manejador, cuando todos los manejadores
+ * de YUBOX ya han entregado la respuesta a TCP. El final se toma al cerrarse
+ * la conexión, y los bytes de respuesta son los confirmados por el cliente
+ * hasta entonces, contados con el callback de envío de lwIP. Los manejadores
+ * que se quedan con la conexión, como SSE y WebSocket, sólo registran
+ * cantidad y primer byte.
+ */
+class YuboxMetricsClass
+{
+private:
+  typedef struct
+  {
+    char label[YUBOX_METRICS_LABEL_LEN];
+    WebRequestMethodComposite method;
+    uint32_t count;
+    uint32_t ttfb[YUBOX_METRICS_BUCKETS];
+    uint64_t ttfbSumUs;
+    uint32_t total[YUBOX_METRICS_BUCKETS];
+    uint64_t totalSumUs;
+    uint64_t bytes;
+    uint32_t heapBefore;
+    uint32_t heapAfter;
+    uint32_t heapAfterMin;
+    bool handoff;
+  } route_t;
+
+  // Bytes confirmados de cada conexión medida, hasta su cierre
+  typedef struct
+  {
+    struct tcp_pcb * pcb;
+    uint32_t acked;
+  } conn_t;
+
+  route_t _routes[YUBOX_METRICS_MAX_ROUTES];
+  uint16_t _numRoutes;
+  conn_t _conns[YUBOX_METRICS_MAX_CONNS];
+  portMUX_TYPE _mux;
+  bool _routesInstalled;
+
+  static int8_t (*_lwipSent)(void *, struct tcp_pcb *, uint16_t);
+  static int8_t _cbHandler_tcpSent(void *, struct tcp_pcb *, uint16_t);
+  int8_t _trackConnection(struct tcp_pcb *);
+  uint32_t _releaseConnection(int8_t);
+
+  static uint8_t _bucket(uint32_t us);
+  void _recordTotal(int16_t slot, uint32_t us, uint32_t heapAfter, uint32_t bytes);
+  bool _snapshot(size_t idx, route_t & r);
+
+  size_t _writePrometheus(char * buf, size_t size, size_t family, size_t idx);
+
+  void _routeHandler_yuboxAPI_metrics_GET(AsyncWebServerRequest *);
+
+public:
+  YuboxMetricsClass(void);
+
+  // Instalar la ruta /yubox-api/metrics. Puede llamarse más de una vez.
+  void begin(AsyncWebServer & srv);
+
+  // Reservar una fila de la tabla. Devuelve -1 si la tabla está llena. Con
+  // handoff, el manejador se queda con la conexión y no se mide su final.
+  int16_t registerRoute(const char * label, WebRequestMethodComposite method, bool handoff = false);
+
+  // Medir una petición. endRequest() debe llamarse al volver el manejador.
+  void beginRequest(YuboxMetricsSample &, AsyncWebServerRequest *, int16_t slot);
+  void endRequest(YuboxMetricsSample &, AsyncWebServerRequest *);
+
+  // Envolver un manejador para medir sus peticiones con la etiqueta indicada.
+  // Devuelve el manejador que debe agregarse al servidor en su lugar. Los
+  // manejadores SSE y WebSocket deben envolverse con handoff.
+  AsyncWebHandler * wrap(AsyncWebHandler * handler, const char * label, bool handoff = false);
+};
+
+extern YuboxMetricsClass YuboxMetrics;
+
+#endif
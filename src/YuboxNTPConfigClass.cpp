@@ -1,6 +1,9 @@
 #include "YuboxWiFiClass.h"
 #include "YuboxNTPConfigClass.h"
 #include "YuboxWebAuthClass.h"
+#include "YuboxRouterClass.h"
+#include "YuboxResponseCacheClass.h"
+#include "YuboxStatusClass.h"
 
 #include <functional>
 
@@ -10,12 +13,17 @@
 
 #include "AsyncJson.h"
 #include "ArduinoJson.h"
+#include "YuboxJSONSchema.h"
 
 #include "lwip/apps/sntp.h"
 
 static const char * yubox_default_ntpserver = "pool.ntp.org";
 
 const char * YuboxNTPConfigClass::_ns_nvram_yuboxframework_ntpclient = "YUBOX/NTP";
+static const char * _cachekey_ntpconfjson = "/yubox-api/ntpconfig/conf.json";
+
+typedef YuboxJSONSchema< YuboxJSONObject<3> > ntpconf_schema_t;
+
 YuboxNTPConfigClass::YuboxNTPConfigClass(void)
 {
     _ntpStart = false;
@@ -72,26 +80,44 @@ void YuboxNTPConfigClass::_cbHandler_WiFiEvent(WiFiEvent_t event)
 
 void YuboxNTPConfigClass::_setupHTTPRoutes(AsyncWebServer & srv)
 {
-  srv.on("/yubox-api/ntpconfig/conf.json", HTTP_GET, std::bind(&YuboxNTPConfigClass::_routeHandler_yuboxAPI_ntpconfjson_GET, this, std::placeholders::_1));
-  srv.on("/yubox-api/ntpconfig/conf.json", HTTP_POST, std::bind(&YuboxNTPConfigClass::_routeHandler_yuboxAPI_ntpconfjson_POST, this, std::placeholders::_1));
+  YuboxRouter.begin(srv);
+  YuboxRouter.on("/yubox-api/ntpconfig/conf.json", HTTP_GET, std::bind(&YuboxNTPConfigClass::_routeHandler_yuboxAPI_ntpconfjson_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/ntpconfig/conf.json", HTTP_POST, std::bind(&YuboxNTPConfigClass::_routeHandler_yuboxAPI_ntpconfjson_POST, this, std::placeholders::_1));
+
+  // El reporte agregado no espera por la sincronización NTP
+  YuboxStatus.begin(srv);
+  YuboxStatus.addProvider("ntpconfig/conf.json", [this](YuboxJSONWriter & json) {
+    YuboxJsonDocument<ntpconf_schema_t> json_doc;
+    _buildConfJSON(json_doc, isNTPValid(0));
+    json.document(json_doc);
+  });
 }
 
 void YuboxNTPConfigClass::_routeHandler_yuboxAPI_ntpconfjson_GET(AsyncWebServerRequest *request)
 {
   YUBOX_RUN_AUTH(request);
-  
-  AsyncResponseStream *response = request->beginResponseStream("application/json");
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(3));
 
+  // Se verifica la sincronización antes de consultar la caché, porque el
+  // cambio a hora válida invalida la respuesta guardada.
+  bool ntpsync = isNTPValid();
+
+  uint32_t cachegen;
+  if (YuboxResponseCache.send(request, _cachekey_ntpconfjson, cachegen)) return;
+
+  YuboxJsonDocument<ntpconf_schema_t> json_doc;
+  _buildConfJSON(json_doc, ntpsync);
+
+  YuboxResponseCache.storeAndSend(request, _cachekey_ntpconfjson, cachegen, json_doc);
+}
+
+void YuboxNTPConfigClass::_buildConfJSON(JsonDocument & json_doc, bool ntpsync)
+{
   // Valores informativos, no pueden cambiarse vía web
-  json_doc["ntpsync"] = isNTPValid();
+  json_doc["ntpsync"] = ntpsync;
 
   // Valores a cambiar vía web
   json_doc["ntphost"] = _ntpServerName.c_str();
   json_doc["ntptz"] = _ntpOffset;
-
-  serializeJson(json_doc, *response);
-  request->send(response);
 }
 
 #define NVRAM_PUTSTRING(nvram, k, s) \
@@ -164,6 +190,7 @@ void YuboxNTPConfigClass::_routeHandler_yuboxAPI_ntpconfjson_POST(AsyncWebServer
       _ntpFirst = true;
       _ntpValid = false;
       _loadSavedCredentialsFromNVRAM();
+      YuboxResponseCache.invalidate(_cachekey_ntpconfjson);
       if (WiFi.isConnected()) _configTime();
     }
   }
@@ -177,7 +204,7 @@ void YuboxNTPConfigClass::_routeHandler_yuboxAPI_ntpconfjson_POST(AsyncWebServer
 
   AsyncResponseStream *response = request->beginResponseStream("application/json");
   response->setCode(httpCode);
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(2));
+  YuboxJsonDocument<YuboxJSONSchema_StatusMsg> json_doc;
   json_doc["success"] = !(clientError || serverError);
   json_doc["msg"] = responseMsg.c_str();
 
@@ -209,6 +236,7 @@ bool YuboxNTPConfigClass::isNTPValid(uint32_t ms_timeout)
     gmtime_r(&now, &info);
     if (info.tm_year > (2016 - 1900)) {
       _ntpValid = true;
+      YuboxResponseCache.invalidate(_cachekey_ntpconfjson);
       break;
     }
     if (ms_timeout > 0) delay(10);
@@ -30,6 +30,7 @@ private:
 
   void _routeHandler_yuboxAPI_ntpconfjson_GET(AsyncWebServerRequest *);
   void _routeHandler_yuboxAPI_ntpconfjson_POST(AsyncWebServerRequest *);
+  void _buildConfJSON(JsonDocument &, bool ntpsync);
 
   bool _isValidHostname(String & h);
 
@@ -1,9 +1,15 @@
 #include "YuboxOTAClass.h"
+#include "YuboxRouterClass.h"
+#include "YuboxJSONWriter.h"
+#include "YuboxStatusClass.h"
+#include "YuboxMetricsClass.h"
+#include "YuboxWiFiClass.h"
 
 #define ARDUINOJSON_USE_LONG_LONG 1
 
 #include "AsyncJson.h"
 #include "ArduinoJson.h"
+#include "YuboxJSONSchema.h"
 
 #include <functional>
 
@@ -12,8 +18,6 @@ extern "C" {
   #include "TinyUntar/untar.h" // https://github.com/dsoprea/TinyUntar
 }
 
-#include "esp_task_wdt.h"
-
 #include "YuboxOTA_Flasher_ESP32.h"
 
 typedef struct YuboxOTAVetoList
@@ -36,8 +40,13 @@ typedef struct YuboxOTA_Flasher_Factory_rec{
   String _route_rollback;
   YuboxOTA_Flasher_Factory_func_cb _factory;
 
+  // Resultado de canRollBack(), válido hasta la siguiente actualización o restauración
+  bool _rollbackKnown;
+  bool _canRollBack;
+
   YuboxOTA_Flasher_Factory_rec(String t, String d, String upload, String rb, YuboxOTA_Flasher_Factory_func_cb f)
-    : _tag(t), _desc(d), _route_tgzupload(upload), _route_rollback(rb), _factory(f) {}
+    : _tag(t), _desc(d), _route_tgzupload(upload), _route_rollback(rb), _factory(f),
+      _rollbackKnown(false), _canRollBack(false) {}
 } YuboxOTA_Flasher_Factory_rec_t;
 
 static std::vector<YuboxOTA_Flasher_Factory_rec_t> flasherFactoryList;
@@ -51,6 +60,12 @@ static std::vector<YuboxOTA_Flasher_Factory_rec_t> flasherFactoryList;
  */
 #define GZIP_FILL_WATERMARK 1500
 
+// Intervalo por omisión entre eventos de progreso de carga, en milisegundos
+#define YUBOX_OTA_PROGRESS_INTERVAL 250
+
+// Peso de la muestra más reciente en la media móvil de tasa de carga
+#define YUBOX_OTA_PROGRESS_RATE_ALPHA 0.3f
+
 int _tar_cb_feedFromBuffer(unsigned char *, size_t);
 int _tar_cb_gotEntryHeader(header_translated_t *, int, void *);
 int _tar_cb_gotEntryData(header_translated_t *, int, void *, unsigned char *, int);
@@ -59,9 +74,12 @@ int _tar_cb_gotEntryEnd(header_translated_t *, int, void *);
 YuboxOTAClass::YuboxOTAClass(void)
 {
   _flasherImpl = NULL;
+  _uploadRequest = NULL;
+  _wifiRoamInhibited = false;
 
   _uploadRejected = false;
   _shouldReboot = false;
+  _commitStarted = false;
   _gz_srcdata = NULL;
   _gz_dstdata = NULL;
   _gz_dict = NULL;
@@ -71,6 +89,19 @@ YuboxOTAClass::YuboxOTAClass(void)
   _tarCB.end_cb = ::_tar_cb_gotEntryEnd;
   tinyUntarReadCallback = ::_tar_cb_feedFromBuffer;
   _pEvents = NULL;
+  _tgzupload_totalBytes = 0;
+
+  vPortCPUInitializeMutex(&_progress_mux);
+  _progress_interval = YUBOX_OTA_PROGRESS_INTERVAL;
+  _progress_dirty = false;
+  _progress_due = false;
+  _progress_filename[0] = '\0';
+  _progress_isfirmware = false;
+  _progress_filesize = 0;
+  _progress_offset = 0;
+  _progress_lastSampleMsec = 0;
+  _progress_lastSampleBytes = 0;
+  _progress_rate = 0.0f;
 
   _timer_restartYUBOX = xTimerCreate(
     "YuboxOTAClass_restartYUBOX",
@@ -78,19 +109,49 @@ YuboxOTAClass::YuboxOTAClass(void)
     pdFALSE,
     0,
     &YuboxOTAClass::_cbHandler_restartYUBOX);
+  _timer_progressEvent = xTimerCreate(
+    "YuboxOTAClass_progressEvent",
+    pdMS_TO_TICKS(_progress_interval),
+    pdTRUE,
+    (void*)this,
+    &YuboxOTAClass::_cbHandler_progressEvent);
+
+  YuboxOTA_Flasher_ESP32::setPostTaskCallback(&YuboxOTAClass::_cbHandler_postTask);
 }
 
 void YuboxOTAClass::begin(AsyncWebServer & srv)
 {
-  srv.on("/yubox-api/yuboxOTA/firmwarelist.json", HTTP_GET,
+  YuboxRouter.begin(srv);
+  YuboxRouter.on("/yubox-api/yuboxOTA/firmwarelist.json", HTTP_GET,
     std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_firmwarelistjson_GET, this, std::placeholders::_1));
-  srv.on("/yubox-api/yuboxOTA/reboot", HTTP_POST,
+  YuboxRouter.on("/yubox-api/yuboxOTA/reboot", HTTP_POST,
     std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_reboot_POST, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/yuboxOTA/{tag}/tgzupload", HTTP_POST,
+    std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_POST, this, std::placeholders::_1),
+    std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_handleUpload, this, std::placeholders::_1,
+      std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6));
+  YuboxRouter.onCaptures("/yubox-api/yuboxOTA/{tag}/rollback", HTTP_GET,
+    std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_GET, this, std::placeholders::_1, std::placeholders::_2));
+  YuboxRouter.onCaptures("/yubox-api/yuboxOTA/{tag}/rollback", HTTP_POST,
+    std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_POST, this, std::placeholders::_1, std::placeholders::_2));
   addFirmwareFlasher(srv, "esp32", "YUBOX ESP32 Firmware", std::bind(&YuboxOTAClass::_getESP32FlasherImpl, this));
-
-  _pEvents = new AsyncEventSource("/yubox-api/yuboxOTA/events");
+  bool canRollBack;
+  for (auto i = 0; i < flasherFactoryList.size(); i++) _canRollBackIdx(i, canRollBack);
+
+  YuboxStatus.begin(srv);
+  YuboxStatus.addProvider("yuboxOTA/firmwarelist.json", [](YuboxJSONWriter & json) {
+    json.beginArray();
+    for (auto i = 0; i < flasherFactoryList.size(); i++) _writeFirmwareRecordJSON(json, i);
+    json.endArray();
+  });
+  YuboxStatus.addProvider("yuboxOTA/rollback", std::bind(&YuboxOTAClass::_writeRollbackStatusJSON, this, std::placeholders::_1));
+
+  // Un cliente lento recibe sólo el progreso más reciente
+  _pEvents = new YuboxEventSource("/yubox-api/yuboxOTA/events", YUBOX_EVENTSOURCE_COALESCE);
   YuboxWebAuth.addManagedHandler(_pEvents);
-  srv.addHandler(_pEvents);
+  srv.addHandler(YuboxMetrics.wrap(_pEvents, _pEvents->url(), true));
+  YuboxWebSocketMux.begin(srv);
+  YuboxWebSocketMux.bridge(*_pEvents, "yuboxOTA/events");
 }
 
 void YuboxOTAClass::addFirmwareFlasher(AsyncWebServer & srv, const char * tag, const char * desc, YuboxOTA_Flasher_Factory_func_cb factory_cb)
@@ -102,27 +163,29 @@ void YuboxOTAClass::addFirmwareFlasher(AsyncWebServer & srv, const char * tag, c
   route_rollback += tag;
   route_rollback += "/rollback";
 
+  // Las rutas /yubox-api/yuboxOTA/{tag}/... ya fueron registradas en begin(),
+  // y el flasheador se localiza por su etiqueta al atender la petición.
   flasherFactoryList.emplace_back(tag, desc, route_tgzupload, route_rollback, factory_cb);
-
-  srv.on(route_tgzupload.c_str(), HTTP_POST,
-    std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_POST, this, std::placeholders::_1),
-    std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_handleUpload, this, std::placeholders::_1,
-      std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6));
-  srv.on(route_rollback.c_str(), HTTP_GET,
-    std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_GET, this, std::placeholders::_1));
-  srv.on(route_rollback.c_str(), HTTP_POST,
-    std::bind(&YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_POST, this, std::placeholders::_1));
 }
 
-int YuboxOTAClass::_idxFlasherFromURL(String url)
+int YuboxOTAClass::_idxFlasherFromTag(const char * tag)
 {
+  if (tag == NULL) return -1;
   for (auto i = 0; i < flasherFactoryList.size(); i++) {
-    if (url == flasherFactoryList[i]._route_tgzupload) return i;
-    if (url == flasherFactoryList[i]._route_rollback) return i;
+    if (flasherFactoryList[i]._tag == tag) return i;
   }
   return -1;
 }
 
+int YuboxOTAClass::_idxFlasherFromURL(const String & url)
+{
+  static const YuboxURLTemplate tpl_tgzupload("/yubox-api/yuboxOTA/{tag}/tgzupload");
+  YuboxURLCaptures captures;
+
+  if (!tpl_tgzupload.match(url.c_str(), captures)) return -1;
+  return _idxFlasherFromTag(captures.get("tag"));
+}
+
 YuboxOTA_Flasher * YuboxOTAClass::_buildFlasherFromIdx(int idx)
 {
   if (idx < 0 || idx >= flasherFactoryList.size()) return NULL;
@@ -135,12 +198,33 @@ YuboxOTA_Flasher * YuboxOTAClass::_buildFlasherFromIdx(int idx)
   return f;
 }
 
-YuboxOTA_Flasher * YuboxOTAClass::_buildFlasherFromURL(String url)
+YuboxOTA_Flasher * YuboxOTAClass::_buildFlasherFromTag(const char * tag)
 {
-  int idx = _idxFlasherFromURL(url);
+  int idx = _idxFlasherFromTag(tag);
   return (idx >= 0) ? _buildFlasherFromIdx(idx) : NULL;
 }
 
+bool YuboxOTAClass::_canRollBackIdx(size_t i, bool & canRollBack)
+{
+  // Construir un flasheador sólo para consultar canRollBack() es costoso, y el
+  // resultado no cambia hasta la siguiente actualización o restauración.
+  YuboxOTA_Flasher_Factory_rec_t & rec = flasherFactoryList[i];
+  if (!rec._rollbackKnown) {
+    YuboxOTA_Flasher * fi = _buildFlasherFromIdx(i);
+    if (fi == NULL) return false;
+    rec._canRollBack = fi->canRollBack();
+    rec._rollbackKnown = true;
+    delete fi;
+  }
+  canRollBack = rec._canRollBack;
+  return true;
+}
+
+void YuboxOTAClass::_invalidateRollbackCache(void)
+{
+  for (auto i = 0; i < flasherFactoryList.size(); i++) flasherFactoryList[i]._rollbackKnown = false;
+}
+
 yuboxota_event_id_t YuboxOTAClass::onOTAUpdateVeto(YuboxOTA_Veto_cb cbVeto)
 {
   if (!cbVeto) return 0;
@@ -185,24 +269,38 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_firmwarelistjson_GET(AsyncWe
 {
     YUBOX_RUN_AUTH(request);
 
-    // Construir tabla de flasheadores disponibles
-    String json_tableOutput = "[";
-    DynamicJsonDocument json_tablerow(JSON_OBJECT_SIZE(4));
-    for (auto it = flasherFactoryList.begin(); it != flasherFactoryList.end(); it++) {
-      if (json_tableOutput.length() > 1) json_tableOutput += ",";
-
-      json_tablerow["tag"] = it->_tag.c_str();
-      json_tablerow["desc"] = it->_desc.c_str();
-      json_tablerow["tgzupload"] = it->_route_tgzupload.c_str();
-      json_tablerow["rollback"] = it->_route_rollback.c_str();
+    // Tabla de flasheadores disponibles, generada a medida que hay espacio
+    request->send(YuboxJSONWriter::beginArrayResponse(request, [](YuboxJSONWriter & json, size_t i) {
+      if (i >= flasherFactoryList.size()) return false;
+      _writeFirmwareRecordJSON(json, i);
+      return true;
+    }));
+}
 
-      serializeJson(json_tablerow, json_tableOutput);
-    }
-    json_tableOutput += "]";
+void YuboxOTAClass::_writeFirmwareRecordJSON(YuboxJSONWriter & json, size_t i)
+{
+  const YuboxOTA_Flasher_Factory_rec_t & rec = flasherFactoryList[i];
+  json.beginObject();
+  json.field("tag", rec._tag);
+  json.field("desc", rec._desc);
+  json.field("tgzupload", rec._route_tgzupload);
+  json.field("rollback", rec._route_rollback);
+  json.endObject();
+}
 
-    AsyncResponseStream *response = request->beginResponseStream("application/json");
-    response->print(json_tableOutput);
-    request->send(response);
+void YuboxOTAClass::_writeRollbackStatusJSON(YuboxJSONWriter & json)
+{
+  // Estado de restauración de cada flasheador, indexado por su tag
+  json.beginObject();
+  bool canRollBack;
+  for (auto i = 0; i < flasherFactoryList.size(); i++) {
+    if (!_canRollBackIdx(i, canRollBack)) continue;
+    json.key(flasherFactoryList[i]._tag.c_str());
+    json.beginObject();
+    json.field("canrollback", canRollBack);
+    json.endObject();
+  }
+  json.endObject();
 }
 
 void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_handleUpload(AsyncWebServerRequest * request,
@@ -216,6 +314,15 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_handleUpload(Async
     return;
   }
   if (index == 0) {
+    // Sin upload en curso, no cuenta el estado de uno anterior que se cortó
+    // antes de llegar al manejador POST
+    if (_flasherImpl == NULL) {
+      _uploadRejected = false;
+      _tgzupload_clientError = false;
+      _tgzupload_serverError = false;
+      _tgzupload_responseMsg = "";
+    }
+
     /* La macro YUBOX_RUN_AUTH no es adecuada porque requestAuthentication() no puede llamarse
        aquí - vienen más fragmentos del upload. Se debe rechazar el upload si la autenticación
        ha fallado.
@@ -224,6 +331,7 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_handleUpload(Async
       // Credenciales incorrectas
       _uploadRejected = true;
     } else {
+      _tgzupload_totalBytes = request->contentLength();
       if (_flasherImpl != NULL) {
         _tgzupload_responseMsg = "El flasheo concurrente de firmwares no está soportado.";
         _tgzupload_clientError = true;
@@ -241,6 +349,12 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_handleUpload(Async
             _tgzupload_responseMsg = "Fallo al instanciar flasheador";
             _tgzupload_serverError = true;
             _uploadRejected = true;
+          } else {
+            // Si el cliente se desconecta a mitad del upload no llegan ni el
+            // fragmento final ni el manejador POST. El enrutador reemplaza
+            // este aviso al atender el POST, cuando el upload ya terminó.
+            _uploadRequest = request;
+            request->onDisconnect([this, request]() { _tgzupload_clientDisconnect(request); });
           }
         }
       }
@@ -303,8 +417,12 @@ void YuboxOTAClass::_handle_tgzOTAchunk(size_t index, uint8_t *data, size_t len,
 
   // Inicializar búferes al encontrar el primer segmento
   if (index == 0) {
+    // Un cambio de AP cortaría la conexión de la carga
+    _inhibitWiFiRoaming(true);
+
     _tgzupload_rawBytesReceived = 0;
     _shouldReboot = false;
+    _commitStarted = false;
 
     /* El valor de GZIP_BUFF_SIZE es suficiente para al menos dos fragmentos de datos entrantes.
      * Se descomprime únicamente TAR_BLOCK_SIZE a la vez para simplificar el código y para que
@@ -337,6 +455,8 @@ void YuboxOTAClass::_handle_tgzOTAchunk(size_t index, uint8_t *data, size_t len,
       _tgzupload_serverError = true;
       _tgzupload_responseMsg = _flasherImpl->getLastErrorMessage();
       _uploadRejected = true;
+    } else {
+      _startProgressReport(_tgzupload_totalBytes);
     }
   }
 
@@ -496,6 +616,7 @@ void YuboxOTAClass::_handle_tgzOTAchunk(size_t index, uint8_t *data, size_t len,
         _uploadRejected = true;
       } else {
         _shouldReboot = _flasherImpl->shouldReboot();
+        _commitStarted = YuboxOTA_Flasher_ESP32::isCommitInProgress();
       }
     }
   } else if (final) {
@@ -509,18 +630,52 @@ void YuboxOTAClass::_handle_tgzOTAchunk(size_t index, uint8_t *data, size_t len,
     _uploadRejected = true;
   }
 
-  if (_uploadRejected || final) {
-    tar_abort("tar cleanup", 0);
-    if (_gz_dict != NULL) { delete _gz_dict; _gz_dict = NULL; }
-    if (_gz_srcdata != NULL) { delete _gz_srcdata; _gz_srcdata = NULL; }
-    if (_gz_dstdata != NULL) { delete _gz_dstdata; _gz_dstdata = NULL; }
-    memset(&_uzLib_decomp, 0, sizeof(struct uzlib_uncomp));
+  // Reporte de progreso pendiente desde el último tic de _timer_progressEvent
+  if (_progress_due && !_uploadRejected && !final) {
+    _progress_due = false;
+    _emitUploadEvent_Progress();
   }
 
+  if (_uploadRejected || final) _releaseUploadBuffers();
+
   if (final && _flasherImpl != NULL) {
     delete _flasherImpl;
     _flasherImpl = NULL;
+    _uploadRequest = NULL;
+    _invalidateRollbackCache();
+  }
+}
+
+void YuboxOTAClass::_releaseUploadBuffers(void)
+{
+  _stopProgressReport();
+  _inhibitWiFiRoaming(false);
+  tar_abort("tar cleanup", 0);
+  if (_gz_dict != NULL) { delete _gz_dict; _gz_dict = NULL; }
+  if (_gz_srcdata != NULL) { delete _gz_srcdata; _gz_srcdata = NULL; }
+  if (_gz_dstdata != NULL) { delete _gz_dstdata; _gz_dstdata = NULL; }
+  memset(&_uzLib_decomp, 0, sizeof(struct uzlib_uncomp));
+}
+
+void YuboxOTAClass::_tgzupload_clientDisconnect(AsyncWebServerRequest * request)
+{
+  // Un upload concurrente rechazado no debe descartar el que está en curso
+  if (request != _uploadRequest) return;
+  _uploadRequest = NULL;
+
+  log_w("YUBOX OTA: cliente desconectado a mitad de upload, se descarta");
+  if (_flasherImpl != NULL) {
+    _flasherImpl->truncateUpdate();
+    delete _flasherImpl;
+    _flasherImpl = NULL;
+    _invalidateRollbackCache();
   }
+  _releaseUploadBuffers();
+
+  _uploadRejected = false;
+  _tgzupload_clientError = false;
+  _tgzupload_serverError = false;
+  _tgzupload_responseMsg = "";
 }
 
 void YuboxOTAClass::cleanupFailedUpdateFiles(void)
@@ -654,57 +809,201 @@ int _tar_cb_gotEntryEnd(header_translated_t * hdr, int entry_index, void * conte
   return ota->_tar_cb_gotEntryEnd(hdr, entry_index);
 }
 
+// Copia de nombre de archivo para incrustar en cadena JSON. Los caracteres
+// que requerirían secuencia de escape se reemplazan por '_'.
+static void _copyJSONSafeFilename(char * dst, size_t dstlen, const char * src)
+{
+  size_t i;
+  for (i = 0; i + 1 < dstlen && src[i] != '\0'; i++) {
+    dst[i] = (src[i] == '"' || src[i] == '\\' || (unsigned char)src[i] < 0x20) ? '_' : src[i];
+  }
+  dst[i] = '\0';
+}
+
+void YuboxOTAClass::_startProgressReport(unsigned long totalBytes)
+{
+  portENTER_CRITICAL(&_progress_mux);
+  _progress_dirty = false;
+  _progress_filename[0] = '\0';
+  _progress_isfirmware = false;
+  _progress_filesize = 0;
+  _progress_offset = 0;
+  portEXIT_CRITICAL(&_progress_mux);
+
+  _tgzupload_totalBytes = totalBytes;
+  _progress_lastSampleMsec = millis();
+  _progress_lastSampleBytes = 0;
+  _progress_rate = 0.0f;
+  _progress_due = false;
+
+  // xTimerChangePeriod() también arranca el timer si estaba detenido
+  xTimerChangePeriod(_timer_progressEvent, pdMS_TO_TICKS(_progress_interval), 0);
+}
+
+void YuboxOTAClass::_stopProgressReport(void)
+{
+  xTimerStop(_timer_progressEvent, 0);
+  _progress_due = false;
+
+  portENTER_CRITICAL(&_progress_mux);
+  _progress_dirty = false;
+  portEXIT_CRITICAL(&_progress_mux);
+}
+
+void YuboxOTAClass::_inhibitWiFiRoaming(bool inhibit)
+{
+  if (_wifiRoamInhibited == inhibit) return;
+  _wifiRoamInhibited = inhibit;
+  YuboxWiFi.inhibitRoaming(inhibit);
+}
+
+void YuboxOTAClass::setProgressInterval(uint32_t msec)
+{
+  if (msec < 50) msec = 50;
+  _progress_interval = msec;
+  if (xTimerIsTimerActive(_timer_progressEvent)) {
+    xTimerChangePeriod(_timer_progressEvent, pdMS_TO_TICKS(_progress_interval), 0);
+  }
+}
+
+void YuboxOTAClass::_cbHandler_progressEvent(TimerHandle_t timer)
+{
+  // La tarea de timers tiene poca pila. Aquí sólo se marca que corresponde
+  // reportar, y el evento se arma y envía en _handle_tgzOTAchunk(), en el
+  // contexto de async_tcp que recibe la carga.
+  YuboxOTAClass * self = (YuboxOTAClass *)pvTimerGetTimerID(timer);
+  self->_progress_due = true;
+}
+
 void YuboxOTAClass::_emitUploadEvent_FileStart(const char * filename, bool isfirmware, unsigned long size)
 {
+  // El evento de inicio reemplaza cualquier progreso pendiente del archivo anterior
+  portENTER_CRITICAL(&_progress_mux);
+  strncpy(_progress_filename, filename, sizeof(_progress_filename) - 1);
+  _progress_filename[sizeof(_progress_filename) - 1] = '\0';
+  _progress_isfirmware = isfirmware;
+  _progress_filesize = size;
+  _progress_offset = 0;
+  _progress_dirty = false;
+  portEXIT_CRITICAL(&_progress_mux);
+
   if (_pEvents == NULL) return;
   if (_pEvents->count() <= 0) return;
 
-  _tgzupload_lastEventSent = millis();
-  String s;
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(5));
-  json_doc["event"] = "uploadFileStart";
-  json_doc["filename"] = filename;
-  json_doc["firmware"] = isfirmware;
-  json_doc["total"] = size;
-  json_doc["currupload"] = _tgzupload_rawBytesReceived;
-  serializeJson(json_doc, s);
-  _pEvents->send(s.c_str(), "uploadFileStart");
+  char fn[101];
+  char s[192];
+  _copyJSONSafeFilename(fn, sizeof(fn), filename);
+  snprintf(s, sizeof(s),
+    "{\"event\":\"uploadFileStart\",\"filename\":\"%s\",\"firmware\":%s,\"total\":%lu,\"currupload\":%lu}",
+    fn, isfirmware ? "true" : "false", size, _tgzupload_rawBytesReceived);
+  _pEvents->send(s, "uploadFileStart");
 }
 
 void YuboxOTAClass::_emitUploadEvent_FileProgress(const char * filename, bool isfirmware, unsigned long size, unsigned long offset)
 {
+  // Este callback se invoca en cada bloque escrito. Aquí únicamente se anota
+  // el estado, y el envío ocurre en _emitUploadEvent_Progress().
+  portENTER_CRITICAL(&_progress_mux);
+  if (strncmp(_progress_filename, filename, sizeof(_progress_filename) - 1) != 0) {
+    strncpy(_progress_filename, filename, sizeof(_progress_filename) - 1);
+    _progress_filename[sizeof(_progress_filename) - 1] = '\0';
+  }
+  _progress_isfirmware = isfirmware;
+  _progress_filesize = size;
+  _progress_offset = offset;
+  _progress_dirty = true;
+  portEXIT_CRITICAL(&_progress_mux);
+}
+
+void YuboxOTAClass::_emitUploadEvent_Progress(void)
+{
+  unsigned long now = millis();
+  unsigned long rawBytes = _tgzupload_rawBytesReceived;
+  unsigned long expandedBytes = _gz_actualExpandedSize;
+
+  // La tasa se estima en cada tic atendido, incluso si no se envía evento
+  unsigned long dt = now - _progress_lastSampleMsec;
+  if (dt > 0) {
+    float sample = 1000.0f * (float)(rawBytes - _progress_lastSampleBytes) / (float)dt;
+    _progress_rate = (_progress_lastSampleBytes == 0)
+      ? sample
+      : YUBOX_OTA_PROGRESS_RATE_ALPHA * sample + (1.0f - YUBOX_OTA_PROGRESS_RATE_ALPHA) * _progress_rate;
+    _progress_lastSampleMsec = now;
+    _progress_lastSampleBytes = rawBytes;
+  }
+
   if (_pEvents == NULL) return;
   if (_pEvents->count() <= 0) return;
-  if (millis() - _tgzupload_lastEventSent < 200) return;
 
-  _tgzupload_lastEventSent = millis();
-  String s;
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(6));
-  json_doc["event"] = "uploadFileProgress";
-  json_doc["filename"] = filename;
-  json_doc["firmware"] = isfirmware;
-  json_doc["current"] = offset;
-  json_doc["total"] = size;
-  json_doc["currupload"] = _tgzupload_rawBytesReceived;
-  serializeJson(json_doc, s);
-  _pEvents->send(s.c_str(), "uploadFileProgress");
+  // Un cliente que todavía no despacha el progreso anterior recibe este en
+  // su lugar, por la política de coalescencia de _pEvents.
+
+  char fn[101];
+  bool isfirmware;
+  unsigned long size, offset;
+  portENTER_CRITICAL(&_progress_mux);
+  if (!_progress_dirty) {
+    portEXIT_CRITICAL(&_progress_mux);
+    return;
+  }
+  _progress_dirty = false;
+  memcpy(fn, _progress_filename, sizeof(fn));
+  isfirmware = _progress_isfirmware;
+  size = _progress_filesize;
+  offset = _progress_offset;
+  portEXIT_CRITICAL(&_progress_mux);
+
+  char safefn[101];
+  _copyJSONSafeFilename(safefn, sizeof(safefn), fn);
+
+  long eta = -1;
+  if (_tgzupload_totalBytes > rawBytes && _progress_rate >= 1.0f) {
+    eta = (long)((float)(_tgzupload_totalBytes - rawBytes) / _progress_rate);
+  }
+  float ratio = (rawBytes > 0) ? (float)expandedBytes / (float)rawBytes : 0.0f;
+
+  snprintf(_progress_buf, sizeof(_progress_buf),
+    "{\"event\":\"uploadFileProgress\",\"filename\":\"%s\",\"firmware\":%s,\"current\":%lu,\"total\":%lu,"
+    "\"currupload\":%lu,\"uploadtotal\":%lu,\"rate\":%lu,\"ratio\":%.2f,\"eta\":%ld}",
+    safefn, isfirmware ? "true" : "false", offset, size,
+    rawBytes, _tgzupload_totalBytes, (unsigned long)_progress_rate, ratio, eta);
+  _pEvents->send(_progress_buf, "uploadFileProgress");
 }
 
 void YuboxOTAClass::_emitUploadEvent_FileEnd(const char * filename, bool isfirmware, unsigned long size)
 {
+  portENTER_CRITICAL(&_progress_mux);
+  _progress_dirty = false;
+  portEXIT_CRITICAL(&_progress_mux);
+
   if (_pEvents == NULL) return;
   if (_pEvents->count() <= 0) return;
 
-  _tgzupload_lastEventSent = millis();
-  String s;
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(5));
-  json_doc["event"] = "uploadFileEnd";
-  json_doc["filename"] = filename;
-  json_doc["firmware"] = isfirmware;
-  json_doc["total"] = size;
-  json_doc["currupload"] = _tgzupload_rawBytesReceived;
-  serializeJson(json_doc, s);
-  _pEvents->send(s.c_str(), "uploadFileEnd");
+  char fn[101];
+  char s[192];
+  _copyJSONSafeFilename(fn, sizeof(fn), filename);
+  snprintf(s, sizeof(s),
+    "{\"event\":\"uploadFileEnd\",\"filename\":\"%s\",\"firmware\":%s,\"total\":%lu,\"currupload\":%lu}",
+    fn, isfirmware ? "true" : "false", size, _tgzupload_rawBytesReceived);
+  _pEvents->send(s, "uploadFileEnd");
+}
+
+void YuboxOTAClass::_cbHandler_postTask(const char * task, unsigned int current, unsigned int total)
+{
+  // Puede llamarse desde la tarea de instalación en segundo plano
+  YuboxOTA._emitUploadEvent_PostTask(task, current, total);
+}
+
+void YuboxOTAClass::_emitUploadEvent_PostTask(const char * task, unsigned int current, unsigned int total)
+{
+  if (_pEvents == NULL) return;
+  if (_pEvents->count() <= 0) return;
+
+  char s[128];
+  snprintf(s, sizeof(s),
+    "{\"event\":\"uploadPostTask\",\"task\":\"%s\",\"current\":%u,\"total\":%u}",
+    task, current, total);
+  _pEvents->send(s, "uploadPostTask");
 }
 
 void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_POST(AsyncWebServerRequest * request)
@@ -740,6 +1039,8 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_POST(AsyncWebServe
     delete _flasherImpl;
     _flasherImpl = NULL;
   }
+  _uploadRequest = NULL;
+  _inhibitWiFiRoaming(false);
 
   _uploadRejected = false;
   _tgzupload_clientError = false;
@@ -752,30 +1053,31 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_tgzupload_POST(AsyncWebServe
 
   AsyncResponseStream *response = request->beginResponseStream("application/json");
   response->setCode(httpCode);
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(3));
+  YuboxJsonDocument< YuboxJSONSchema< YuboxJSONObject<4> > > json_doc;
   json_doc["success"] = !(clientError || serverError);
   json_doc["msg"] = responseMsg.c_str();
   json_doc["reboot"] = (_shouldReboot && !clientError && !serverError);
+  // Indica que la instalación de archivos sigue en segundo plano, y que su
+  // final se anunciará con el evento uploadPostTask de tarea datafiles-end.
+  json_doc["commit"] = (_commitStarted && !clientError && !serverError);
 
   serializeJson(json_doc, *response);
   request->send(response);
 }
 
-void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_GET(AsyncWebServerRequest * request)
+void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_GET(AsyncWebServerRequest * request, const YuboxURLCaptures & captures)
 {
   YUBOX_RUN_AUTH(request);
 
-  YuboxOTA_Flasher * fi = _buildFlasherFromURL(request->url());
-  if (fi == NULL) {
+  int idx = _idxFlasherFromTag(captures.get("tag"));
+  bool canRollBack;
+  if (idx < 0 || !_canRollBackIdx(idx, canRollBack)) {
     request->send(404, "application/json", "{\"success\":false,\"msg\":\"El flasheador indicado no existe o no ha sido implementado\"}");
     return;
   }
 
-  bool canRollBack = fi->canRollBack();
-  delete fi;
-
   AsyncResponseStream *response = request->beginResponseStream("application/json");
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(1));
+  YuboxJsonDocument< YuboxJSONSchema< YuboxJSONObject<1> > > json_doc;
   response->setCode(200);
   json_doc["canrollback"] = canRollBack;
 
@@ -783,12 +1085,12 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_GET(AsyncWebServerR
   request->send(response);
 }
 
-void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_POST(AsyncWebServerRequest * request)
+void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_POST(AsyncWebServerRequest * request, const YuboxURLCaptures & captures)
 {
   YUBOX_RUN_AUTH(request);
 
   AsyncResponseStream *response = request->beginResponseStream("application/json");
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(2));
+  YuboxJsonDocument<YuboxJSONSchema_StatusMsg> json_doc;
 
   // Revisar lista de vetos
   String vetoMsg = _checkOTA_Veto(false); // Rollback cuenta como flasheo
@@ -799,7 +1101,7 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_POST(AsyncWebServer
 
     response->setCode(500);
   } else {
-    YuboxOTA_Flasher * fi = _buildFlasherFromURL(request->url());
+    YuboxOTA_Flasher * fi = _buildFlasherFromTag(captures.get("tag"));
 
     if (fi == NULL) {
       json_doc["success"] = false;
@@ -826,7 +1128,10 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_rollback_POST(AsyncWebServer
       }
     }
 
-    if (fi != NULL) delete fi;
+    if (fi != NULL) {
+      delete fi;
+      _invalidateRollbackCache();
+    }
   }
 
   serializeJson(json_doc, *response);
@@ -838,7 +1143,7 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_reboot_POST(AsyncWebServerRe
   YUBOX_RUN_AUTH(request);
 
   AsyncResponseStream *response = request->beginResponseStream("application/json");
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(2));
+  YuboxJsonDocument<YuboxJSONSchema_StatusMsg> json_doc;
 
   // Revisar lista de vetos
   String vetoMsg = _checkOTA_Veto(true);
@@ -859,8 +1164,15 @@ void YuboxOTAClass::_routeHandler_yuboxAPI_yuboxOTA_reboot_POST(AsyncWebServerRe
   request->send(response);
 }
 
-void YuboxOTAClass::_cbHandler_restartYUBOX(TimerHandle_t)
+void YuboxOTAClass::_cbHandler_restartYUBOX(TimerHandle_t timer)
 {
+  if (YuboxOTA_Flasher_ESP32::isCommitInProgress()) {
+    // Reiniciar ahora dejaría la instalación a medias. Aunque sería reanudada
+    // al arranque, se prefiere esperar a que termine.
+    log_i("YUBOX OTA: instalación de archivos en curso, se pospone reinicio...");
+    xTimerStart(timer, 0);
+    return;
+  }
   log_w("YUBOX OTA: reiniciando luego de cambio de firmware...");
   ESP.restart();
 }
@@ -3,6 +3,10 @@
 
 #include <ESPAsyncWebServer.h>
 #include "YuboxWebAuthClass.h"
+#include "YuboxURLTemplate.h"
+#include "YuboxJSONWriter.h"
+#include "YuboxEventSource.h"
+#include "YuboxWebSocketMuxClass.h"
 
 #include "uzlib/uzlib.h"
 extern "C" {
@@ -31,6 +35,9 @@ private:
   // Bandera de reinicio requerido para aplicar cambios
   bool _shouldReboot;
 
+  // Bandera de instalación de archivos en segundo plano iniciada por la carga
+  bool _commitStarted;
+
   // Cuenta de datos subidos del archivo para reportar en eventos
   unsigned long _tgzupload_rawBytesReceived;
 
@@ -53,24 +60,58 @@ private:
   bool _tgzupload_serverError;
   String _tgzupload_responseMsg;
 
-  // Operación de actualización en sí
+  // Operación de actualización en sí, y la petición que la está subiendo
   YuboxOTA_Flasher * _flasherImpl;
+  AsyncWebServerRequest * _uploadRequest;
   TimerHandle_t _timer_restartYUBOX;
 
-  AsyncEventSource * _pEvents;
-  unsigned long _tgzupload_lastEventSent;
+  YuboxEventSource * _pEvents;
+
+  // Total de bytes del upload según Content-Length, o 0 si no se conoce
+  unsigned long _tgzupload_totalBytes;
+
+  // Bandera de roaming WiFi inhibido durante la carga
+  bool _wifiRoamInhibited;
+
+  // Estado de progreso de la carga. Los callbacks de progreso del flasheador
+  // únicamente actualizan este estado. _timer_progressEvent sólo marca
+  // _progress_due, y el evento SSE se construye y envía al procesar el
+  // siguiente bloque recibido, de forma que el reporte no retrase la carga.
+  portMUX_TYPE _progress_mux;
+  TimerHandle_t _timer_progressEvent;
+  uint32_t _progress_interval;
+  bool _progress_dirty;
+  volatile bool _progress_due;
+  char _progress_filename[101];
+  bool _progress_isfirmware;
+  unsigned long _progress_filesize;
+  unsigned long _progress_offset;
+
+  // Estimación de tasa de carga, suavizada con media móvil exponencial
+  unsigned long _progress_lastSampleMsec;
+  unsigned long _progress_lastSampleBytes;
+  float _progress_rate;
+
+  // Búfer preasignado para construir el evento de progreso
+  char _progress_buf[320];
 
   void _setupHTTPRoutes(AsyncWebServer &);
 
   void _routeHandler_yuboxAPI_yuboxOTA_firmwarelistjson_GET(AsyncWebServerRequest *);
+  static void _writeFirmwareRecordJSON(YuboxJSONWriter &, size_t);
+  void _writeRollbackStatusJSON(YuboxJSONWriter &);
+  bool _canRollBackIdx(size_t, bool &);
+  void _invalidateRollbackCache(void);
   void _routeHandler_yuboxAPI_yuboxOTA_tgzupload_POST(AsyncWebServerRequest *);
   void _routeHandler_yuboxAPI_yuboxOTA_tgzupload_handleUpload(AsyncWebServerRequest *,
     String filename, size_t index, uint8_t *data, size_t len, bool final);
-  void _routeHandler_yuboxAPI_yuboxOTA_rollback_GET(AsyncWebServerRequest *);
-  void _routeHandler_yuboxAPI_yuboxOTA_rollback_POST(AsyncWebServerRequest *);
+  void _routeHandler_yuboxAPI_yuboxOTA_rollback_GET(AsyncWebServerRequest *, const YuboxURLCaptures &);
+  void _routeHandler_yuboxAPI_yuboxOTA_rollback_POST(AsyncWebServerRequest *, const YuboxURLCaptures &);
   void _routeHandler_yuboxAPI_yuboxOTA_reboot_POST(AsyncWebServerRequest *);
 
   void _handle_tgzOTAchunk(size_t index, uint8_t *data, size_t len, bool final);
+  void _releaseUploadBuffers(void);
+  void _tgzupload_clientDisconnect(AsyncWebServerRequest *);
 
   // Verificación de veto sobre operación de flasheo o reinicio
   String _checkOTA_Veto(bool isReboot);
@@ -84,12 +125,18 @@ private:
   void _emitUploadEvent_FileStart(const char * filename, bool isfirmware, unsigned long size);
   void _emitUploadEvent_FileProgress(const char * filename, bool isfirmware, unsigned long size, unsigned long offset);
   void _emitUploadEvent_FileEnd(const char * filename, bool isfirmware, unsigned long size);
+  void _emitUploadEvent_Progress(void);
+  void _emitUploadEvent_PostTask(const char * task, unsigned int current, unsigned int total);
+  void _startProgressReport(unsigned long totalBytes);
+  void _stopProgressReport(void);
+  void _inhibitWiFiRoaming(bool);
 
   YuboxOTA_Flasher * _getESP32FlasherImpl(void);
 
-  int _idxFlasherFromURL(String);
+  int _idxFlasherFromTag(const char *);
+  int _idxFlasherFromURL(const String &);
   YuboxOTA_Flasher * _buildFlasherFromIdx(int);
-  YuboxOTA_Flasher * _buildFlasherFromURL(String);
+  YuboxOTA_Flasher * _buildFlasherFromTag(const char *);
 
 public:
   YuboxOTAClass(void);
@@ -112,12 +159,20 @@ public:
 
   void addFirmwareFlasher(AsyncWebServer & srv, const char *, const char *, YuboxOTA_Flasher_Factory_func_cb);
 
+  // Intervalo mínimo en milisegundos entre eventos de progreso de carga. Un
+  // evento pendiente que no pudo enviarse porque los clientes todavía tienen
+  // eventos sin despachar se reemplaza por el siguiente estado de progreso.
+  void setProgressInterval(uint32_t msec);
+  uint32_t getProgressInterval(void) { return _progress_interval; }
+
   friend int _tar_cb_feedFromBuffer(unsigned char *, size_t);
   friend int _tar_cb_gotEntryHeader(header_translated_t *, int, void *);
   friend int _tar_cb_gotEntryData(header_translated_t *, int, void *, unsigned char *, int);
   friend int _tar_cb_gotEntryEnd(header_translated_t *, int, void *);
 
   static void _cbHandler_restartYUBOX(TimerHandle_t);
+  static void _cbHandler_progressEvent(TimerHandle_t);
+  static void _cbHandler_postTask(const char *, unsigned int, unsigned int);
 };
 
 extern YuboxOTAClass YuboxOTA;
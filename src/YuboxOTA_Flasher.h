@@ -17,6 +17,11 @@ typedef std::function<void (const char *, bool, unsigned long) > YuboxOTA_Flashe
 typedef std::function<void (const char *, bool, unsigned long, unsigned long) > YuboxOTA_Flasher_FileProgress_func_cb;
 typedef std::function<void (const char *, bool, unsigned long) > YuboxOTA_Flasher_FileEnd_func_cb;
 
+// Reporte de avance de tareas posteriores a la carga (commit de firmware,
+// instalación de archivos de datos). Se indica nombre de tarea, y cuenta de
+// pasos completados y totales de la tarea, o 0 y 0 si no aplica.
+typedef void (*YuboxOTA_Flasher_PostTask_cb)(const char *, unsigned int, unsigned int);
+
 class YuboxOTA_Flasher
 {
 protected:
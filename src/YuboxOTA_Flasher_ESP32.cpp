@@ -4,11 +4,23 @@
 #include "SPIFFS.h"
 
 #include "YuboxOTA_Flasher_ESP32.h"
-
-#include "esp_task_wdt.h"
+#include "YuboxAssetManifest.h"
 
 #define YUBOX_BUFSIZ SPI_FLASH_SEC_SIZE
 
+// Pausa entre pasos de la instalación de archivos de datos, en milisegundos
+#define YUBOX_OTA_COMMIT_STEP_DELAY 10
+
+#define YUBOX_OTA_COMMIT_TASK_STACK 4096
+
+const char * YuboxOTA_Flasher_ESP32::_ns_nvram_yuboxframework_ota = "YUBOX/OTA";
+YuboxOTA_Flasher_PostTask_cb YuboxOTA_Flasher_ESP32::_posttask_cb = NULL;
+volatile bool YuboxOTA_Flasher_ESP32::_commit_running = false;
+YuboxOTA_commitPhase YuboxOTA_Flasher_ESP32::_commit_phase = YBX_OTA_COMMIT_IDLE;
+bool YuboxOTA_Flasher_ESP32::_commit_loaded = false;
+std::vector<String> YuboxOTA_Flasher_ESP32::_commit_filelist;
+unsigned int YuboxOTA_Flasher_ESP32::_commit_idx = 0;
+
 YuboxOTA_Flasher_ESP32::YuboxOTA_Flasher_ESP32(void)
  : YuboxOTA_Flasher()
 {
@@ -29,7 +41,7 @@ YuboxOTA_Flasher_ESP32::YuboxOTA_Flasher_ESP32(void)
 YuboxOTA_Flasher_ESP32::~YuboxOTA_Flasher_ESP32()
 {
   FREE_FILEBUF;
-  cleanupFailedUpdateFiles();
+  _cleanupNewFiles();
 }
 
 bool YuboxOTA_Flasher_ESP32::isUpdateRejected(void)
@@ -45,6 +57,11 @@ String YuboxOTA_Flasher_ESP32::getLastErrorMessage(void)
 bool YuboxOTA_Flasher_ESP32::startUpdate(void)
 {
     FREE_FILEBUF;
+    if (_commit_running) {
+      _responseMsg = "La instalación de archivos de la actualización anterior todavía está en curso.";
+      _uploadRejected = true;
+      return false;
+    }
     _filebuf = (uint8_t *)malloc(YUBOX_BUFSIZ);
     if (_filebuf == NULL) {
       _responseMsg= "No se puede asignar bufer para escribir archivos!";
@@ -257,10 +274,6 @@ bool YuboxOTA_Flasher_ESP32::finishUpdate(void)
 {
     FREE_FILEBUF;
 
-    log_d("YUBOX OTA: DESACTIVANDO WATCHDOG EN CORE-0");
-    disableCore0WDT();
-    esp_task_wdt_delete(NULL);
-
     if (!_tgzupload_hasManifest) {
       // No existe manifest.txt, esto no era un targz de firmware
       //_tgzupload_clientError = true;
@@ -269,65 +282,36 @@ bool YuboxOTA_Flasher_ESP32::finishUpdate(void)
     }
 
     if (!_uploadRejected && _tgzupload_canFlash) {
-      vTaskDelay(1);
-
-      // Finalizar operación de flash de firmware, si es necesaria
-      log_d("YUBOX OTA: firmware-commit-start");
+      // Finalizar operación de flash de firmware, si es necesaria. Esto escribe
+      // únicamente el último bloque pendiente y cambia la partición de arranque,
+      // así que se hace antes de responder para poder reportar el fallo.
+      _emitPostTask("firmware-commit-start", 0, 0);
       if (!Update.end()) {
         _responseMsg = "OTA Code update: fallo al finalizar - ";
         _responseMsg += _updater_errstr(Update.getError());
         _uploadRejected = true;
         log_e("YUBOX OTA: firmware-commit-failed: %s", _responseMsg.c_str());
+        _emitPostTask("firmware-commit-failed", 0, 0);
       } else if (!Update.isFinished()) {
         _responseMsg = "OTA Code update: actualización no ha podido finalizarse - ";
         _responseMsg += _updater_errstr(Update.getError());
         _uploadRejected = true;
         log_e("YUBOX OTA: firmware-commit-failed: %s", _responseMsg.c_str());
+        _emitPostTask("firmware-commit-failed", 0, 0);
       } else {
-        log_d("YUBOX OTA: firmware-commit-end");
+        _emitPostTask("firmware-commit-end", 0, 0);
       }
-      log_d(" ...done");
-
-      vTaskDelay(1);
     }
 
     if (!_uploadRejected) {
-      std::vector<String> old_filelist;
-
-      vTaskDelay(1);
-
-      // Cargar lista de archivos viejos a preservar
-      log_d("YUBOX OTA: datafiles-load-oldmanifest");
-      _loadManifest(old_filelist);
-      log_d(" ...done");
-      vTaskDelay(1);
-
-      // Se BORRA cualquier archivo que empiece con el prefijo "b," reservado para rollback
-      log_d("YUBOX OTA: datafiles-delete-oldbackup");
-      _deleteFilesWithPrefix("b,");
-      log_d(" ...done");
-      vTaskDelay(1);
-
-      // Se RENOMBRA todos los archivos en old_filelist con prefijo "b,"
-      log_d("YUBOX OTA: datafiles-rename-oldfiles");
-      _changeFileListPrefix(old_filelist, "", "b,");
-      log_d(" ...done");
-      vTaskDelay(1);
-      old_filelist.clear();
-
-      // Se RENOMBRA todos los archivos en _tgzupload_filelist quitando prefijo "n,"
-      log_d("YUBOX OTA: datafiles-rename-newfiles");
-      _changeFileListPrefix(_tgzupload_filelist, "n,", "");
-      log_d(" ...done");
-      vTaskDelay(1);
+      // La instalación de archivos de datos se ejecuta en segundo plano, un
+      // archivo a la vez, para que el servidor web siga atendiendo y el
+      // watchdog permanezca activo.
       _tgzupload_filelist.clear();
-      log_d("YUBOX OTA: datafiles-end ...done");
-      vTaskDelay(1);
+      _startCommit(YBX_OTA_COMMIT_DELETE_OLDBACKUP);
     }
 
     if (_uploadRejected) _firmwareAbort();
-    log_d("YUBOX OTA: REACTIVANDO WATCHDOG EN CORE-0");
-    enableCore0WDT();
 
     return !_uploadRejected;
 }
@@ -350,6 +334,11 @@ bool YuboxOTA_Flasher_ESP32::canRollBack(void)
 
 bool YuboxOTA_Flasher_ESP32::doRollBack(void)
 {
+    if (_commit_running) {
+        _responseMsg = "La instalación de archivos de la actualización anterior todavía está en curso.";
+        return false;
+    }
+
     if (!Update.rollBack()) {
         _responseMsg = "No hay firmware a restaurar, o no fue restaurado correctamente.";
         return false;
@@ -376,6 +365,7 @@ bool YuboxOTA_Flasher_ESP32::doRollBack(void)
     curr_filelist.clear();
     prev_filelist.clear();
 
+    YuboxAssetManifest::changed();
     return true;
 }
 
@@ -420,15 +410,174 @@ void YuboxOTA_Flasher_ESP32::_firmwareAbort(void)
     Update.abort();
   }
 
-  cleanupFailedUpdateFiles();
+  _cleanupNewFiles();
 }
 
-void YuboxOTA_Flasher_ESP32::cleanupFailedUpdateFiles(void)
+void YuboxOTA_Flasher_ESP32::_cleanupNewFiles(void)
 {
+  // Los archivos "n," pertenecen a la instalación en curso, si la hay
+  if (_commit_running) return;
+
   // Se BORRA cualquier archivo que empiece con el prefijo "n,"
   _deleteFilesWithPrefix("n,");
 }
 
+void YuboxOTA_Flasher_ESP32::cleanupFailedUpdateFiles(void)
+{
+  if (_commit_running) return;
+
+  YuboxOTA_commitPhase phase = _loadCommitPhase();
+  if (phase != YBX_OTA_COMMIT_IDLE) {
+    // La actualización anterior fue aceptada pero el equipo se reinició antes
+    // de terminar de instalar los archivos de datos. Los archivos "n," deben
+    // preservarse y la instalación continúa desde la fase guardada.
+    log_w("YUBOX OTA: se reanuda instalación de archivos interrumpida en fase %d", phase);
+    _startCommit(phase);
+    return;
+  }
+
+  _cleanupNewFiles();
+}
+
+YuboxOTA_commitPhase YuboxOTA_Flasher_ESP32::_loadCommitPhase(void)
+{
+  Preferences nvram;
+
+  nvram.begin(_ns_nvram_yuboxframework_ota, true);
+  uint8_t phase = nvram.getUChar("commitphase", YBX_OTA_COMMIT_IDLE);
+  if (phase > YBX_OTA_COMMIT_RENAME_NEWFILES) {
+    log_w("YUBOX OTA: fase de instalación desconocida %u, se ignora", phase);
+    phase = YBX_OTA_COMMIT_IDLE;
+  }
+  return (YuboxOTA_commitPhase)phase;
+}
+
+void YuboxOTA_Flasher_ESP32::_saveCommitPhase(YuboxOTA_commitPhase phase)
+{
+  Preferences nvram;
+
+  nvram.begin(_ns_nvram_yuboxframework_ota, false);
+  if (phase == YBX_OTA_COMMIT_IDLE) {
+    nvram.remove("commitphase");
+  } else {
+    nvram.putUChar("commitphase", (uint8_t)phase);
+  }
+}
+
+void YuboxOTA_Flasher_ESP32::_setCommitPhase(YuboxOTA_commitPhase phase)
+{
+  // La fase se guarda ANTES de empezar a trabajar en ella. Cada fase puede
+  // repetirse desde el principio luego de un reinicio, porque su lista de
+  // archivos se reconstruye a partir de lo que queda en SPIFFS.
+  _saveCommitPhase(phase);
+  _commit_phase = phase;
+  _commit_loaded = false;
+  _commit_filelist.clear();
+  _commit_idx = 0;
+}
+
+void YuboxOTA_Flasher_ESP32::_startCommit(YuboxOTA_commitPhase phase)
+{
+  _setCommitPhase(phase);
+  _commit_running = true;
+
+  if (pdPASS != xTaskCreate(
+    &YuboxOTA_Flasher_ESP32::_commitTask,
+    "YuboxOTA_commit",
+    YUBOX_OTA_COMMIT_TASK_STACK,
+    NULL,
+    tskIDLE_PRIORITY + 1,
+    NULL)) {
+    // No debería pasar. Se instala en primer plano, cediendo el CPU entre pasos.
+    log_e("YUBOX OTA: no se puede crear tarea de instalación, se ejecuta en primer plano");
+    while (_runCommitStep()) vTaskDelay(1);
+    _commit_running = false;
+  }
+}
+
+void YuboxOTA_Flasher_ESP32::_commitTask(void *)
+{
+  while (_runCommitStep()) vTaskDelay(pdMS_TO_TICKS(YUBOX_OTA_COMMIT_STEP_DELAY));
+  _commit_running = false;
+  vTaskDelete(NULL);
+}
+
+void YuboxOTA_Flasher_ESP32::_emitPostTask(const char * task, unsigned int current, unsigned int total)
+{
+  log_d("YUBOX OTA: %s %u/%u", task, current, total);
+  if (_posttask_cb != NULL) _posttask_cb(task, current, total);
+}
+
+bool YuboxOTA_Flasher_ESP32::_runCommitStep(void)
+{
+  // Cada llamada realiza a lo sumo una operación de archivo, y devuelve
+  // verdadero mientras queden pasos por ejecutar.
+  switch (_commit_phase) {
+  case YBX_OTA_COMMIT_DELETE_OLDBACKUP:
+    // Se BORRA cualquier archivo que empiece con el prefijo "b," reservado para rollback
+    if (!_commit_loaded) {
+      _listFilesWithPrefix(_commit_filelist, "b,", false);
+      _commit_loaded = true;
+      _emitPostTask("datafiles-delete-oldbackup", 0, _commit_filelist.size());
+    } else if (_commit_idx < _commit_filelist.size()) {
+      const String & fn = _commit_filelist[_commit_idx++];
+      log_v("BORRANDO %s ...", fn.c_str());
+      if (!SPIFFS.remove(fn)) {
+        log_w("no se pudo borrar %s !", fn.c_str());
+      }
+      _emitPostTask("datafiles-delete-oldbackup", _commit_idx, _commit_filelist.size());
+    } else {
+      _setCommitPhase(YBX_OTA_COMMIT_RENAME_OLDFILES);
+    }
+    return true;
+
+  case YBX_OTA_COMMIT_RENAME_OLDFILES:
+    // Se RENOMBRA todos los archivos del manifest actual con prefijo "b,"
+    if (!_commit_loaded) {
+      _emitPostTask("datafiles-load-oldmanifest", 0, 0);
+      _loadManifest(_commit_filelist);
+
+      // El manifest.txt se renombra al final. Así, si esta fase se interrumpe,
+      // al reanudarla todavía puede leerse la lista de archivos que faltan.
+      for (auto it = _commit_filelist.begin(); it != _commit_filelist.end(); it++) {
+        if (*it == "manifest.txt") {
+          _commit_filelist.erase(it);
+          _commit_filelist.push_back("manifest.txt");
+          break;
+        }
+      }
+      _commit_loaded = true;
+      _emitPostTask("datafiles-rename-oldfiles", 0, _commit_filelist.size());
+    } else if (_commit_idx < _commit_filelist.size()) {
+      _changeFilePrefix(_commit_filelist[_commit_idx++], "", "b,");
+      _emitPostTask("datafiles-rename-oldfiles", _commit_idx, _commit_filelist.size());
+    } else {
+      _setCommitPhase(YBX_OTA_COMMIT_RENAME_NEWFILES);
+    }
+    return true;
+
+  case YBX_OTA_COMMIT_RENAME_NEWFILES:
+    // Se RENOMBRA todos los archivos nuevos quitando prefijo "n,"
+    if (!_commit_loaded) {
+      _listFilesWithPrefix(_commit_filelist, "n,", true);
+      _commit_loaded = true;
+      _emitPostTask("datafiles-rename-newfiles", 0, _commit_filelist.size());
+    } else if (_commit_idx < _commit_filelist.size()) {
+      _changeFilePrefix(_commit_filelist[_commit_idx++], "n,", "");
+      _emitPostTask("datafiles-rename-newfiles", _commit_idx, _commit_filelist.size());
+    } else {
+      _setCommitPhase(YBX_OTA_COMMIT_IDLE);
+      YuboxAssetManifest::changed();
+      _emitPostTask("datafiles-end", 0, 0);
+      return false;
+    }
+    return true;
+
+  default:
+    return false;
+  }
+}
+
 void YuboxOTA_Flasher_ESP32::_loadManifest(std::vector<String> & flist)
 {
   if (SPIFFS.exists("/manifest.txt")) {
@@ -441,6 +590,10 @@ void YuboxOTA_Flasher_ESP32::_loadManifest(std::vector<String> & flist)
       bool selfref = false;
       while (h.available()) {
         String s = h.readStringUntil('\n');
+        // Cada línea puede llevar el hash de contenido luego de un tabulador
+        int tabpos = s.indexOf('\t');
+        if (tabpos >= 0) s.remove(tabpos);
+        if (s.isEmpty()) continue;
         if (s == "manifest.txt") selfref = true;
         String sn = "/"; sn += s;
         if (!SPIFFS.exists(sn)) {
@@ -511,14 +664,22 @@ void YuboxOTA_Flasher_ESP32::_deleteFilesWithPrefix(const char * p)
 void YuboxOTA_Flasher_ESP32::_changeFileListPrefix(std::vector<String> & flist, const char * op, const char * np)
 {
   std::vector<String>::iterator it;
-  String s, sn;
 
   for (it = flist.begin(); it != flist.end(); it++) {
-    s = "/"; s += op; s += *it;      // Ruta original del archivo
-    sn = "/"; sn += np; sn += *it;  // Ruta nueva del archivo
-    log_v("RENOMBRANDO %s --> %s ...", s.c_str(), sn.c_str());
-    if (!SPIFFS.rename(s, sn)) {
-      log_w("no se pudo renombrar %s --> %s ...", s.c_str(), sn.c_str());
-    }
+    _changeFilePrefix(*it, op, np);
+  }
+}
+
+bool YuboxOTA_Flasher_ESP32::_changeFilePrefix(const String & fn, const char * op, const char * np)
+{
+  String s, sn;
+
+  s = "/"; s += op; s += fn;      // Ruta original del archivo
+  sn = "/"; sn += np; sn += fn;  // Ruta nueva del archivo
+  log_v("RENOMBRANDO %s --> %s ...", s.c_str(), sn.c_str());
+  if (!SPIFFS.rename(s, sn)) {
+    log_w("no se pudo renombrar %s --> %s ...", s.c_str(), sn.c_str());
+    return false;
   }
+  return true;
 }
@@ -4,8 +4,20 @@
 #include "YuboxOTA_Flasher.h"
 
 #include "FS.h"
+#include <Preferences.h>
 #include <vector>
 
+// Fases de la instalación de archivos de datos luego de una carga exitosa. El
+// valor de la fase se guarda en NVRAM para poder reanudar la instalación si el
+// equipo se reinicia a la mitad de ella. No debe cambiarse la numeración.
+typedef enum
+{
+  YBX_OTA_COMMIT_IDLE             = 0,  // No hay instalación en curso
+  YBX_OTA_COMMIT_DELETE_OLDBACKUP = 1,  // Borrando archivos "b," de respaldo anterior
+  YBX_OTA_COMMIT_RENAME_OLDFILES  = 2,  // Renombrando archivos del manifest actual a "b,"
+  YBX_OTA_COMMIT_RENAME_NEWFILES  = 3   // Renombrando archivos "n," a su nombre final
+} YuboxOTA_commitPhase;
+
 class YuboxOTA_Flasher_ESP32 : public YuboxOTA_Flasher
 {
 private:
@@ -25,12 +37,32 @@ private:
 
     const char * _updater_errstr(uint8_t);
 
-    void _listFilesWithPrefix(std::vector<String> &, const char *, bool);
-    void _deleteFilesWithPrefix(const char *);
-    void _changeFileListPrefix(std::vector<String> &, const char *, const char *);
-    void _loadManifest(std::vector<String> &);
+    static void _listFilesWithPrefix(std::vector<String> &, const char *, bool);
+    static void _deleteFilesWithPrefix(const char *);
+    static void _changeFileListPrefix(std::vector<String> &, const char *, const char *);
+    static bool _changeFilePrefix(const String &, const char *, const char *);
+    static void _loadManifest(std::vector<String> &);
 
     void _firmwareAbort(void);
+    void _cleanupNewFiles(void);
+
+    // Estado de la instalación de archivos de datos en segundo plano. La
+    // instalación sobrevive a la instancia del flasheador que la inició.
+    static const char * _ns_nvram_yuboxframework_ota;
+    static YuboxOTA_Flasher_PostTask_cb _posttask_cb;
+    static volatile bool _commit_running;
+    static YuboxOTA_commitPhase _commit_phase;
+    static bool _commit_loaded;
+    static std::vector<String> _commit_filelist;
+    static unsigned int _commit_idx;
+
+    static YuboxOTA_commitPhase _loadCommitPhase(void);
+    static void _saveCommitPhase(YuboxOTA_commitPhase);
+    static void _setCommitPhase(YuboxOTA_commitPhase);
+    static void _startCommit(YuboxOTA_commitPhase);
+    static bool _runCommitStep(void);
+    static void _emitPostTask(const char *, unsigned int, unsigned int);
+    static void _commitTask(void *);
 
     String _reportFilesystemSpace(void);
     bool _flushFileBuffer(const char *, unsigned long long);
@@ -70,7 +102,17 @@ public:
 
     bool doRollBack(void);
 
+    // Para invocar al arranque. Si hay una instalación de archivos de datos
+    // interrumpida por un reinicio, se la reanuda en segundo plano. De lo
+    // contrario se borran los archivos de una subida fallida.
     void cleanupFailedUpdateFiles(void);
+
+    // Verificar si la instalación de archivos de datos sigue en curso. Mientras
+    // lo esté, se rechazan nuevas subidas y restauraciones.
+    static bool isCommitInProgress(void) { return _commit_running; }
+
+    // Registrar la función a llamar para reportar avance de tareas posteriores a la carga
+    static void setPostTaskCallback(YuboxOTA_Flasher_PostTask_cb cb) { _posttask_cb = cb; }
 };
 
 #endif
\ No newline at end of file
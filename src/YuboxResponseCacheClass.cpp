@@ -0,0 +1,197 @@
+#include <Arduino.h>
+
+#include "YuboxResponseCacheClass.h"
+#include "YuboxGzipClass.h"
+
+YuboxResponseCacheClass::YuboxResponseCacheClass(void)
+{
+  vPortCPUInitializeMutex(&_mux);
+  _totalBytes = 0;
+  _useCounter = 0;
+  _generation = 0;
+  for (auto i = 0; i < YUBOX_RESPONSE_CACHE_ENTRIES; i++) {
+    _entries[i].key = NULL;
+    _entries[i].len = 0;
+  }
+}
+
+int YuboxResponseCacheClass::_find(const char * key)
+{
+  for (auto i = 0; i < YUBOX_RESPONSE_CACHE_ENTRIES; i++) {
+    if (_entries[i].body && strcmp(_entries[i].key, key) == 0) return i;
+  }
+  return -1;
+}
+
+int YuboxResponseCacheClass::_lru(void)
+{
+  int lru = -1;
+  for (auto i = 0; i < YUBOX_RESPONSE_CACHE_ENTRIES; i++) {
+    if (!_entries[i].body) continue;
+    if (lru < 0 || (int32_t)(_entries[i].lastUse - _entries[lru].lastUse) < 0) lru = i;
+  }
+  return lru;
+}
+
+void YuboxResponseCacheClass::_swapOut(int idx, entry_t & dst)
+{
+  // La entrada queda en dst, que el llamador destruye fuera de la sección
+  // crítica. El espacio queda libre con el cuerpo vacío que tenía dst.
+  _totalBytes -= _entries[idx].len;
+  _entries[idx].body.swap(dst.body);
+  dst.len = _entries[idx].len;
+  _entries[idx].len = 0;
+}
+
+void YuboxResponseCacheClass::_sendBody(AsyncWebServerRequest * request, const char * ctype,
+  std::shared_ptr<char> body, size_t len, const char * etag)
+{
+  // El cuerpo se comparte con la caché, y se conserva mientras dure el envío
+  // aunque la entrada sea invalidada mientras tanto.
+  AsyncWebServerResponse * response = YuboxGzip.beginResponse(request, ctype, len,
+    [body, len](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+      if (index >= len) return 0;
+      size_t n = len - index;
+      if (n > maxLen) n = maxLen;
+      memcpy(buf, body.get() + index, n);
+      return n;
+    });
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+bool YuboxResponseCacheClass::send(AsyncWebServerRequest * request, const char * key, uint32_t & gen)
+{
+  const char * ctype = NULL;
+  std::shared_ptr<char> body;
+  size_t len = 0;
+  char etag[11];
+
+  portENTER_CRITICAL(&_mux);
+  int idx = _find(key);
+  if (idx >= 0) {
+    entry_t & e = _entries[idx];
+    e.lastUse = ++_useCounter;
+    ctype = e.contentType;
+    body = e.body;
+    len = e.len;
+    memcpy(etag, e.etag, sizeof(etag));
+  }
+  gen = _generation;
+  portEXIT_CRITICAL(&_mux);
+
+  if (idx < 0) return false;
+
+  if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag) {
+    AsyncWebServerResponse * response = request->beginResponse(304);
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+    return true;
+  }
+
+  _sendBody(request, ctype, body, len, etag);
+  return true;
+}
+
+void YuboxResponseCacheClass::storeAndSend(AsyncWebServerRequest * request, const char * key, uint32_t gen,
+  const char * contentType, const char * body, size_t len)
+{
+  std::shared_ptr<char> copy((char *)malloc(len + 1), free);
+  if (!copy) {
+    // Sin memoria para la caché, se envía directamente
+    request->send(200, contentType, body);
+    return;
+  }
+  memcpy(copy.get(), body, len);
+  copy.get()[len] = '\0';
+
+  // ETag fuerte a partir de FNV-1a del contenido
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)body[i];
+    h *= 16777619UL;
+  }
+  char etag[11];
+  snprintf(etag, sizeof(etag), "\"%08x\"", h);
+
+  if (len <= YUBOX_RESPONSE_CACHE_MAXBYTES) {
+    // La copia a guardar se prepara fuera de la sección crítica. Las entradas
+    // desplazadas se recogen en dropped, y sus cuerpos se liberan al salir de
+    // esta función, ya fuera de la sección crítica.
+    std::shared_ptr<char> stored = copy;
+    entry_t dropped[YUBOX_RESPONSE_CACHE_ENTRIES];
+    size_t ndropped = 0;
+
+    portENTER_CRITICAL(&_mux);
+    if (gen == _generation) {
+      int idx = _find(key);
+      if (idx >= 0) _swapOut(idx, dropped[ndropped++]);
+
+      // Se descartan las entradas menos usadas recientemente hasta hacer espacio
+      int slot = -1;
+      for (auto i = 0; i < YUBOX_RESPONSE_CACHE_ENTRIES && slot < 0; i++) {
+        if (!_entries[i].body) slot = i;
+      }
+      while (ndropped < YUBOX_RESPONSE_CACHE_ENTRIES && (slot < 0 || _totalBytes + len > YUBOX_RESPONSE_CACHE_MAXBYTES)) {
+        int lru = _lru();
+        if (lru < 0) break;
+        _swapOut(lru, dropped[ndropped++]);
+        if (slot < 0) slot = lru;
+      }
+
+      entry_t & e = _entries[slot];
+      e.key = key;
+      e.contentType = contentType;
+      e.body.swap(stored);
+      e.len = len;
+      memcpy(e.etag, etag, sizeof(etag));
+      e.lastUse = ++_useCounter;
+      _totalBytes += len;
+    }
+    portEXIT_CRITICAL(&_mux);
+  }
+
+  _sendBody(request, contentType, copy, len, etag);
+}
+
+void YuboxResponseCacheClass::storeAndSend(AsyncWebServerRequest * request, const char * key, uint32_t gen, const JsonDocument & doc)
+{
+  size_t len = measureJson(doc);
+  char * buf = (char *)malloc(len + 1);
+  if (buf == NULL) {
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
+    return;
+  }
+  serializeJson(doc, buf, len + 1);
+  storeAndSend(request, key, gen, "application/json", buf, len);
+  free(buf);
+}
+
+void YuboxResponseCacheClass::invalidate(const char * key)
+{
+  entry_t dropped;
+
+  portENTER_CRITICAL(&_mux);
+  _generation++;
+  int idx = _find(key);
+  if (idx >= 0) _swapOut(idx, dropped);
+  portEXIT_CRITICAL(&_mux);
+}
+
+void YuboxResponseCacheClass::invalidateAll(void)
+{
+  entry_t dropped[YUBOX_RESPONSE_CACHE_ENTRIES];
+
+  portENTER_CRITICAL(&_mux);
+  _generation++;
+  for (auto i = 0; i < YUBOX_RESPONSE_CACHE_ENTRIES; i++) {
+    if (_entries[i].body) _swapOut(i, dropped[i]);
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+YuboxResponseCacheClass YuboxResponseCache;
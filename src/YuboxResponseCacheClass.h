@@ -0,0 +1,75 @@
+#ifndef _YUBOX_RESPONSE_CACHE_CLASS_H_
+#define _YUBOX_RESPONSE_CACHE_CLASS_H_
+
+#include <ESPAsyncWebServer.h>
+
+#define ARDUINOJSON_USE_LONG_LONG 1
+
+#include "ArduinoJson.h"
+
+#include <memory>
+
+// Límites de la caché: número de entradas y total de bytes de cuerpos
+#define YUBOX_RESPONSE_CACHE_ENTRIES    8
+#define YUBOX_RESPONSE_CACHE_MAXBYTES   8192
+
+// Caché de respuestas GET para rutas cuyo contenido cambia sólo ante eventos
+// conocidos. Cada entrada guarda el cuerpo serializado y un ETag calculado
+// sobre su contenido. El manejador GET intenta responder desde la caché, y en
+// caso contrario construye el cuerpo y lo guarda. Los manejadores POST, PUT y
+// DELETE, y los eventos que alteran el estado reportado, invalidan la entrada.
+//
+// Uso típico en el manejador GET:
+//  uint32_t cachegen;
+//  if (YuboxResponseCache.send(request, "clave", cachegen)) return;
+//  ...construir json_doc...
+//  YuboxResponseCache.storeAndSend(request, "clave", cachegen, json_doc);
+class YuboxResponseCacheClass
+{
+private:
+  // Una entrada libre tiene body vacío. Las entradas sólo se intercambian con
+  // swap() bajo la sección crítica, de forma que ningún cuerpo se libera ni
+  // se pide memoria dentro de ella.
+  typedef struct
+  {
+    const char * key;           // Debe ser cadena estática
+    const char * contentType;   // Debe ser cadena estática
+    std::shared_ptr<char> body;
+    size_t len;
+    char etag[11];
+    uint32_t lastUse;
+  } entry_t;
+
+  portMUX_TYPE _mux;
+  entry_t _entries[YUBOX_RESPONSE_CACHE_ENTRIES];
+  size_t _totalBytes;
+  uint32_t _useCounter;
+  uint32_t _generation;
+
+  int _find(const char * key);
+  int _lru(void);
+  void _swapOut(int idx, entry_t & dst);
+  static void _sendBody(AsyncWebServerRequest *, const char * ctype, std::shared_ptr<char> body, size_t len, const char * etag);
+
+public:
+  YuboxResponseCacheClass(void);
+
+  // Responder desde la caché, con 304 si el cliente ya tiene la versión
+  // vigente. Devuelve falso si no hay entrada; en ese caso gen recibe la
+  // generación actual, que debe pasarse a storeAndSend().
+  bool send(AsyncWebServerRequest * request, const char * key, uint32_t & gen);
+
+  // Guardar el cuerpo y enviarlo. El cuerpo sólo se guarda si no hubo
+  // invalidaciones desde la llamada a send() que entregó gen. La clave y el
+  // tipo de contenido deben ser cadenas estáticas.
+  void storeAndSend(AsyncWebServerRequest * request, const char * key, uint32_t gen,
+    const char * contentType, const char * body, size_t len);
+  void storeAndSend(AsyncWebServerRequest * request, const char * key, uint32_t gen, const JsonDocument & doc);
+
+  void invalidate(const char * key);
+  void invalidateAll(void);
+};
+
+extern YuboxResponseCacheClass YuboxResponseCache;
+
+#endif
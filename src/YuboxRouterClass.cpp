@@ -0,0 +1,239 @@
+#include <Arduino.h>
+
+#include "YuboxRouterClass.h"
+#include "YuboxWebAuthClass.h"
+#include "YuboxMetricsClass.h"
+#include "YuboxGzipClass.h"
+
+YuboxRouterClass::YuboxRouterClass(void)
+{
+  _srv = NULL;
+  _root.param = NULL;
+  _numRoutes = 0;
+}
+
+void YuboxRouterClass::begin(AsyncWebServer & srv)
+{
+  if (_srv == &srv) return;
+  if (_srv != NULL) {
+    log_w("YuboxRouter ya fue instalado en otro servidor, se ignora");
+    return;
+  }
+  _srv = &srv;
+  _srv->addHandler(this);
+}
+
+void YuboxRouterClass::on(const char * uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+{
+  on(uri, method, onRequest, NULL, NULL);
+}
+
+void YuboxRouterClass::on(const char * uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload)
+{
+  on(uri, method, onRequest, onUpload, NULL);
+}
+
+void YuboxRouterClass::on(const char * uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody)
+{
+  route_t * r = _addRoute(uri, method);
+  if (r == NULL) return;
+  r->onRequest = onRequest;
+  r->onUpload = onUpload;
+  r->onBody = onBody;
+}
+
+void YuboxRouterClass::onCaptures(const char * uri, WebRequestMethodComposite method, YuboxRouteHandlerFunction onRequest)
+{
+  route_t * r = _addRoute(uri, method);
+  if (r == NULL) return;
+  r->onRequestCaptures = onRequest;
+}
+
+int YuboxRouterClass::_compareSegment(const String & segment, const char * p, size_t len)
+{
+  size_t n = (segment.length() < len) ? segment.length() : len;
+  int c = memcmp(segment.c_str(), p, n);
+  if (c == 0) c = (segment.length() < len) ? -1 : ((segment.length() > len) ? 1 : 0);
+  return c;
+}
+
+YuboxRouterClass::node_t * YuboxRouterClass::_getOrCreateChild(node_t * node, const char * p, size_t len)
+{
+  // Segmento de parámetro: {nombre}
+  if (len >= 2 && p[0] == '{' && p[len - 1] == '}') {
+    String name;
+    for (auto j = 1; j < len - 1; j++) name += p[j];
+
+    if (node->param == NULL) {
+      node->param = new node_t;
+      node->param->param = NULL;
+      node->paramName = name;
+    } else if (node->paramName != name) {
+      log_w("segmento {%s} reutiliza posición de {%s}, se conserva nombre original", name.c_str(), node->paramName.c_str());
+    }
+    return node->param;
+  }
+
+  // Segmento literal, se inserta en orden para permitir búsqueda binaria
+  auto it = node->children.begin();
+  for (; it != node->children.end(); it++) {
+    int c = _compareSegment((*it)->segment, p, len);
+    if (c == 0) return *it;
+    if (c > 0) break;
+  }
+  node_t * child = new node_t;
+  child->param = NULL;
+  for (auto j = 0; j < len; j++) child->segment += p[j];
+  node->children.insert(it, child);
+  return child;
+}
+
+YuboxRouterClass::route_t * YuboxRouterClass::_addRoute(const char * uri, WebRequestMethodComposite method)
+{
+  const size_t prefixlen = strlen(YUBOX_ROUTER_PREFIX);
+
+  if (strncmp(uri, YUBOX_ROUTER_PREFIX, prefixlen) != 0) {
+    log_e("ruta %s no inicia con %s, no se registra", uri, YUBOX_ROUTER_PREFIX);
+    return NULL;
+  }
+
+  unsigned int ncaptures = 0;
+  node_t * node = &_root;
+  const char * p = uri + prefixlen;
+  while (*p != '\0') {
+    const char * e = strchr(p, '/');
+    size_t len = (e != NULL) ? (e - p) : strlen(p);
+
+    if (len > 0) {
+      if (*p == '{') ncaptures++;
+      node = _getOrCreateChild(node, p, len);
+    }
+    p += len;
+    if (*p == '/') p++;
+  }
+  if (ncaptures > YUBOX_URL_MAX_CAPTURES) {
+    log_e("ruta %s excede máximo de %d capturas, no se registra", uri, YUBOX_URL_MAX_CAPTURES);
+    return NULL;
+  }
+
+  for (auto i = 0; i < node->routes.size(); i++) {
+    if (node->routes[i].method & method) {
+      log_w("ruta %s ya tenía manejador para método 0x%02x, se reemplaza", uri, method);
+      node->routes[i].method = method;
+      node->routes[i].onRequest = NULL;
+      node->routes[i].onRequestCaptures = NULL;
+      node->routes[i].onUpload = NULL;
+      node->routes[i].onBody = NULL;
+      return &(node->routes[i]);
+    }
+  }
+
+  route_t r;
+  r.method = method;
+  r.metric = YuboxMetrics.registerRoute(uri, method);
+  node->routes.push_back(r);
+  _numRoutes++;
+  return &(node->routes.back());
+}
+
+const YuboxRouterClass::route_t * YuboxRouterClass::_matchNode(const node_t * node, const char * p,
+  WebRequestMethodComposite method, YuboxURLCaptures & caps) const
+{
+  // Se ignoran barras repetidas o finales, igual que en el registro
+  while (*p == '/') p++;
+
+  if (*p == '\0') {
+    for (auto i = 0; i < node->routes.size(); i++) {
+      if (node->routes[i].method & method) return &(node->routes[i]);
+    }
+    return NULL;
+  }
+
+  const char * e = strchr(p, '/');
+  size_t len = (e != NULL) ? (e - p) : strlen(p);
+  const route_t * r;
+
+  // Primero se prueba el segmento literal...
+  int lo = 0;
+  int hi = (int)node->children.size() - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) >> 1;
+    int c = _compareSegment(node->children[mid]->segment, p, len);
+    if (c == 0) {
+      r = _matchNode(node->children[mid], p + len, method, caps);
+      if (r != NULL) return r;
+      break;
+    }
+    if (c < 0) lo = mid + 1; else hi = mid - 1;
+  }
+
+  // ...y si no hay ruta por esa rama, el segmento {param}
+  if (node->param != NULL && caps.add(node->paramName.c_str(), p, len)) {
+    r = _matchNode(node->param, p + len, method, caps);
+    if (r != NULL) return r;
+    caps.pop();
+  }
+
+  return NULL;
+}
+
+const YuboxRouterClass::route_t * YuboxRouterClass::_matchRequest(AsyncWebServerRequest * request, YuboxURLCaptures & caps) const
+{
+  const size_t prefixlen = strlen(YUBOX_ROUTER_PREFIX);
+  const char * url = request->url().c_str();
+
+  if (strncmp(url, YUBOX_ROUTER_PREFIX, prefixlen) != 0) return NULL;
+  return _matchNode(&_root, url + prefixlen, request->method(), caps);
+}
+
+bool YuboxRouterClass::canHandle(AsyncWebServerRequest * request)
+{
+  YuboxURLCaptures caps;
+  if (_matchRequest(request, caps) == NULL) return false;
+
+  // Requerido por YuboxResponseCache para responder 304, y por YuboxFS para
+  // descargas parciales
+  if (request->method() == HTTP_GET) {
+    request->addInterestingHeader("If-None-Match");
+    request->addInterestingHeader("Range");
+  }
+  YuboxWebAuth.addInterestingHeaders(request);
+  YuboxGzip.addInterestingHeaders(request);
+  return true;
+}
+
+void YuboxRouterClass::handleRequest(AsyncWebServerRequest * request)
+{
+  if ((_username != "" && _password != "") && !YuboxWebAuth.authenticate(request))
+    return request->requestAuthentication();
+
+  YuboxURLCaptures caps;
+  const route_t * r = _matchRequest(request, caps);
+
+  YuboxMetricsSample ms;
+  YuboxMetrics.beginRequest(ms, request, (r != NULL) ? r->metric : -1);
+  if (r != NULL && r->onRequestCaptures) {
+    r->onRequestCaptures(request, caps);
+  } else if (r != NULL && r->onRequest) {
+    r->onRequest(request);
+  } else {
+    request->send(500);
+  }
+  YuboxMetrics.endRequest(ms, request);
+}
+
+void YuboxRouterClass::handleUpload(AsyncWebServerRequest * request, const String& filename, size_t index, uint8_t *data, size_t len, bool final)
+{
+  YuboxURLCaptures caps;
+  const route_t * r = _matchRequest(request, caps);
+  if (r != NULL && r->onUpload) r->onUpload(request, filename, index, data, len, final);
+}
+
+void YuboxRouterClass::handleBody(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+  YuboxURLCaptures caps;
+  const route_t * r = _matchRequest(request, caps);
+  if (r != NULL && r->onBody) r->onBody(request, data, len, index, total);
+}
+
+YuboxRouterClass YuboxRouter;
@@ -0,0 +1,82 @@
+#ifndef _YUBOX_ROUTER_CLASS_H_
+#define _YUBOX_ROUTER_CLASS_H_
+
+#include <ESPAsyncWebServer.h>
+
+#include <functional>
+#include <vector>
+
+#include "YuboxURLTemplate.h"
+
+// Prefijo de todas las rutas administradas por YuboxRouter
+#define YUBOX_ROUTER_PREFIX         "/yubox-api/"
+
+typedef std::function<void(AsyncWebServerRequest *request, const YuboxURLCaptures & captures)> YuboxRouteHandlerFunction;
+
+// Manejador único para todas las rutas bajo /yubox-api/. Las rutas se guardan
+// en un árbol de prefijos por segmento de ruta, con los hijos literales de
+// cada nodo ordenados para búsqueda binaria, y a lo sumo un hijo {param} por
+// nodo. El costo de localizar la ruta de una petición depende del número de
+// segmentos del URL, y no del número de módulos o flasheadores registrados.
+class YuboxRouterClass : public AsyncWebHandler
+{
+private:
+  typedef struct
+  {
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction onRequest;
+    YuboxRouteHandlerFunction onRequestCaptures;
+    ArUploadHandlerFunction onUpload;
+    ArBodyHandlerFunction onBody;
+    int16_t metric;                          // Fila en YuboxMetrics, o -1
+  } route_t;
+
+  typedef struct node_s
+  {
+    String segment;
+    std::vector<struct node_s *> children;  // Ordenados por segmento
+    struct node_s * param;                   // Hijo para segmento {param}
+    String paramName;
+    std::vector<route_t> routes;
+  } node_t;
+
+  AsyncWebServer * _srv;
+  node_t _root;
+  uint32_t _numRoutes;
+
+  node_t * _getOrCreateChild(node_t *, const char *, size_t);
+  route_t * _addRoute(const char * uri, WebRequestMethodComposite method);
+  const route_t * _matchNode(const node_t *, const char *, WebRequestMethodComposite, YuboxURLCaptures &) const;
+  const route_t * _matchRequest(AsyncWebServerRequest *, YuboxURLCaptures &) const;
+
+  static int _compareSegment(const String &, const char *, size_t);
+
+public:
+  YuboxRouterClass(void);
+
+  // Instalar el manejador en el servidor. Puede llamarse varias veces, y cada
+  // módulo de YUBOX lo hace antes de registrar sus rutas.
+  void begin(AsyncWebServer & srv);
+
+  // Registro de rutas, con la misma forma que AsyncWebServer::on(). La ruta
+  // debe iniciar con YUBOX_ROUTER_PREFIX.
+  void on(const char * uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+  void on(const char * uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload);
+  void on(const char * uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody);
+
+  // Registro de ruta con segmentos {param} cuyo manejador recibe los valores
+  // capturados. Por ejemplo: /yubox-api/wificonfig/networks/{ssid}
+  void onCaptures(const char * uri, WebRequestMethodComposite method, YuboxRouteHandlerFunction onRequest);
+
+  uint32_t count(void) const { return _numRoutes; }
+
+  virtual bool canHandle(AsyncWebServerRequest *request) override final;
+  virtual void handleRequest(AsyncWebServerRequest *request) override final;
+  virtual void handleUpload(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) override final;
+  virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override final;
+  virtual bool isRequestHandlerTrivial(void) override final { return false; }
+};
+
+extern YuboxRouterClass YuboxRouter;
+
+#endif
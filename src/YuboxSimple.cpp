@@ -1,7 +1,13 @@
 #include <Arduino.h>
 #include "YuboxSimple.h"
+#include "YuboxAssetBundleHandler.h"
+#include "YuboxStaticAssetHandler.h"
+#include "YuboxMetricsClass.h"
+#include "YuboxFSClass.h"
 
 AsyncWebServer yubox_HTTPServer(80);
+static YuboxAssetBundleHandler yubox_assetBundle;
+static YuboxStaticAssetHandler yubox_staticAssets(SPIFFS);
 
 static void yubox_json_notFound(AsyncWebServerRequest *request)
 {
@@ -25,18 +31,39 @@ void yuboxSimpleSetup(void)
   YuboxWebAuth.begin(yubox_HTTPServer);
   YuboxNTPConf.begin(yubox_HTTPServer);
   YuboxOTA.begin(yubox_HTTPServer);
+  YuboxMetrics.begin(yubox_HTTPServer);
+  YuboxFS.begin(yubox_HTTPServer);
 
-  AsyncWebHandler &h = yubox_HTTPServer.serveStatic("/", SPIFFS, "/");
-  YuboxWebAuth.addManagedHandler(&h);
+  // Si existe un bundle de archivos vigente en flash, se sirve desde allí. Los
+  // archivos del manifest en SPIFFS se sirven con validadores de caché, y el
+  // manejador SPIFFS genérico se instala de todas formas para el resto.
+  if (yubox_assetBundle.begin()) yuboxAddManagedHandler(&yubox_assetBundle, "bundle");
+  yubox_staticAssets.begin();
+  yuboxAddManagedHandler(&yubox_staticAssets, "assets");
+
+  // Equivale a serveStatic("/", SPIFFS, "/"), pero sólo se agrega al servidor
+  // la versión medida y autenticada con sesión. removeHandler() destruye el
+  // manejador, por lo que no puede usarse para reemplazar el que agrega
+  // serveStatic().
+  yuboxAddManagedHandler(YuboxWebAuth.wrap(new AsyncStaticWebHandler("/", SPIFFS, "/", NULL)), "static");
   yubox_HTTPServer.onNotFound(yubox_json_notFound);
 
   YuboxWiFi.beginServerOnWiFiReady(&yubox_HTTPServer);
 }
 
-void yuboxAddManagedHandler(AsyncWebHandler* handler)
+void yuboxAddManagedHandler(AsyncWebHandler* handler, const char * label)
 {
+  static unsigned int numHandlers = 0;
+  char autolabel[16];
+
+  if (label == NULL) {
+    snprintf(autolabel, sizeof(autolabel), "handler/%u", numHandlers);
+    label = autolabel;
+  }
+  numHandlers++;
+
   YuboxWebAuth.addManagedHandler(handler);
-  yubox_HTTPServer.addHandler(handler);
+  yubox_HTTPServer.addHandler(YuboxMetrics.wrap(handler, label));
 }
 
 void yuboxSimpleLoopTask(void)
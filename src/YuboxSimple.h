@@ -16,7 +16,9 @@
 
 void yuboxSimpleSetup(void);
 void yuboxSimpleLoopTask(void);
-void yuboxAddManagedHandler(AsyncWebHandler* handler);
+// Agregar un manejador con autenticación y métricas. Sin etiqueta, sus
+// métricas aparecen como handler/<n> en orden de registro.
+void yuboxAddManagedHandler(AsyncWebHandler* handler, const char * label = NULL);
 
 extern AsyncWebServer yubox_HTTPServer;
 
@@ -0,0 +1,116 @@
+#include <Arduino.h>
+
+#include "YuboxStaticAssetHandler.h"
+#include "YuboxWebAuthClass.h"
+#include "YuboxGzipClass.h"
+
+YuboxStaticAssetHandler::YuboxStaticAssetHandler(FS & fs)
+ : AsyncWebHandler(), _fs(fs), _defaultFile("index.htm"), _generation(0)
+{
+}
+
+bool YuboxStaticAssetHandler::begin(void)
+{
+  _generation = YuboxAssetManifest::generation();
+  return _loadManifest();
+}
+
+bool YuboxStaticAssetHandler::_loadManifest(void)
+{
+  if (!_manifest.load(_fs)) {
+    log_w("no se puede leer /manifest.txt, no se sirven archivos con caché");
+    return false;
+  }
+  _manifest.resolveStoredNames(_fs);
+  return true;
+}
+
+void YuboxStaticAssetHandler::_checkGeneration(void)
+{
+  uint32_t gen = YuboxAssetManifest::generation();
+  if (gen == _generation) return;
+
+  // Una instalación de archivos de datos sin reinicio reemplazó el manifest.
+  // Se vuelve a leer para que las URLs con huella del HTML servido
+  // correspondan a los archivos vigentes.
+  _generation = gen;
+  _loadManifest();
+}
+
+bool YuboxStaticAssetHandler::_requestPath(AsyncWebServerRequest * request, char * path, size_t pathlen)
+{
+  const String & url = request->url();
+
+  // Se quita la barra inicial, y se agrega el archivo por omisión a directorios
+  const char * p = url.c_str();
+  if (*p == '/') p++;
+  size_t len = strlen(p);
+  if (len == 0 || p[len - 1] == '/') {
+    if (len + _defaultFile.length() >= pathlen) return false;
+    memcpy(path, p, len);
+    strcpy(path + len, _defaultFile.c_str());
+  } else {
+    if (len >= pathlen) return false;
+    strcpy(path, p);
+  }
+  return true;
+}
+
+bool YuboxStaticAssetHandler::canHandle(AsyncWebServerRequest * request)
+{
+  char path[96];
+
+  if (request->method() != HTTP_GET) return false;
+  _checkGeneration();
+  if (!_requestPath(request, path, sizeof(path))) return false;
+  if (_manifest.lookup(path) == NULL) return false;
+
+  // Sin esto las cabeceras se descartan antes de llegar a handleRequest()
+  request->addInterestingHeader("If-None-Match");
+  request->addInterestingHeader("Accept-Encoding");
+  YuboxWebAuth.addInterestingHeaders(request);
+  return true;
+}
+
+void YuboxStaticAssetHandler::handleRequest(AsyncWebServerRequest * request)
+{
+  if ((_username != "" && _password != "") && !YuboxWebAuth.authenticate(request))
+    return request->requestAuthentication();
+
+  char path[96];
+  if (!_requestPath(request, path, sizeof(path))) {
+    request->send(404);
+    return;
+  }
+
+  const char * hash = NULL;
+  const char * name = _manifest.lookup(path, &hash, YuboxGzipClass::acceptsEncoding(request, "br"));
+  if (name == NULL) {
+    request->send(404);
+    return;
+  }
+
+  // El nombre ya es el del archivo almacenado, ver resolveStoredNames()
+  String fullname = "/"; fullname += name;
+  const char * encoding = NULL;
+  if (fullname.endsWith(".br")) {
+    encoding = "br";
+  } else if (fullname.endsWith(".gz")) {
+    encoding = "gzip";
+  }
+  if (YuboxAssetManifest::handleNotModified(request, hash, encoding)) return;
+
+  File f = _fs.open(fullname, FILE_READ);
+  if (!f) {
+    request->send(404);
+    return;
+  }
+
+  // AsyncFileResponse agrega Content-Encoding si el archivo abierto es .gz y
+  // deduce el tipo de contenido a partir de la ruta pedida. Para .br la
+  // cabecera se agrega aquí.
+  AsyncWebServerResponse * response = request->beginResponse(f, String("/") + path);
+  if (fullname.endsWith(".br")) response->addHeader("Content-Encoding", "br");
+  YuboxAssetManifest::addCacheHeaders(request, response, hash, encoding);
+  request->send(response);
+}
@@ -0,0 +1,38 @@
+#ifndef _YUBOX_STATIC_ASSET_HANDLER_H_
+#define _YUBOX_STATIC_ASSET_HANDLER_H_
+
+#include <ESPAsyncWebServer.h>
+#include "FS.h"
+
+#include "YuboxAssetManifest.h"
+
+// Manejador de los archivos listados en manifest.txt. La decisión de atender
+// una ruta se toma con la tabla del manifest en memoria, sin tocar el sistema
+// de archivos. Las respuestas llevan ETag según el hash de contenido, y las
+// URLs con huella (?v=hash) se marcan como inmutables. Los archivos que no
+// constan en el manifest deben servirse con serveStatic() a continuación.
+// El manifest se vuelve a leer cuando cambia YuboxAssetManifest::generation().
+class YuboxStaticAssetHandler : public AsyncWebHandler
+{
+private:
+  FS & _fs;
+  String _defaultFile;
+  YuboxAssetManifest _manifest;
+  uint32_t _generation;
+
+  bool _loadManifest(void);
+  void _checkGeneration(void);
+  bool _requestPath(AsyncWebServerRequest *, char *, size_t);
+
+public:
+  YuboxStaticAssetHandler(FS & fs);
+
+  bool begin(void);
+
+  YuboxStaticAssetHandler & setDefaultFile(const char * filename) { _defaultFile = filename; return *this; }
+
+  virtual bool canHandle(AsyncWebServerRequest *request) override final;
+  virtual void handleRequest(AsyncWebServerRequest *request) override final;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include <Arduino.h>
+
+#include "YuboxStatusClass.h"
+#include "YuboxWebAuthClass.h"
+#include "YuboxRouterClass.h"
+#include "YuboxGzipClass.h"
+
+#include <memory>
+
+// Holgura para cambios de estado entre la medición y la escritura
+#define YUBOX_STATUS_SLACK    64
+
+YuboxStatusClass::YuboxStatusClass(void)
+{
+  _routesInstalled = false;
+}
+
+void YuboxStatusClass::begin(AsyncWebServer & srv)
+{
+  if (_routesInstalled) return;
+
+  YuboxRouter.begin(srv);
+  YuboxRouter.on("/yubox-api/status", HTTP_GET, std::bind(&YuboxStatusClass::_routeHandler_yuboxAPI_status_GET, this, std::placeholders::_1));
+  _routesInstalled = true;
+}
+
+void YuboxStatusClass::addProvider(const char * key, YuboxStatusProvider provider)
+{
+  for (auto i = 0; i < _providers.size(); i++) {
+    if (_providers[i].key == key) {
+      _providers[i].provider = provider;
+      return;
+    }
+  }
+
+  provider_t p;
+  p.key = key;
+  p.provider = provider;
+  _providers.push_back(p);
+}
+
+bool YuboxStatusClass::removeProvider(const char * key)
+{
+  for (auto i = 0; i < _providers.size(); i++) {
+    if (_providers[i].key == key) {
+      _providers.erase(_providers.begin() + i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void YuboxStatusClass::_writeStatus(YuboxJSONWriter & json)
+{
+  json.beginObject();
+  for (auto i = 0; i < _providers.size(); i++) {
+    json.key(_providers[i].key.c_str());
+    _providers[i].provider(json);
+  }
+  json.endObject();
+}
+
+void YuboxStatusClass::_routeHandler_yuboxAPI_status_GET(AsyncWebServerRequest * request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  // Se mide el reporte, y se reintenta si el estado creció entre la medición
+  // y la escritura más allá de la holgura. La holgura se duplica en cada
+  // reintento.
+  YuboxJSONWriter measure(NULL, 0);
+  _writeStatus(measure);
+  size_t bufsize = measure.length() + YUBOX_STATUS_SLACK;
+
+  std::shared_ptr<char> json_str;
+  size_t len = 0;
+  bool nomem = false;
+  for (auto attempt = 0; attempt < 3; attempt++) {
+    json_str.reset((char *)malloc(bufsize), free);
+    if (!json_str) {
+      nomem = true;
+      break;
+    }
+
+    YuboxJSONWriter json(json_str.get(), bufsize);
+    _writeStatus(json);
+    if (!json.overflow()) {
+      len = json.length();
+      break;
+    }
+    bufsize = json.length() + (YUBOX_STATUS_SLACK << (attempt + 1));
+    json_str.reset();
+  }
+
+  if (nomem) {
+    log_e("no hay memoria para reporte de estado de %u bytes", bufsize);
+    request->send(500, "application/json", "{\"success\":false,\"msg\":\"No hay memoria para reporte de estado\"}");
+    return;
+  }
+  if (!json_str) {
+    // El estado siguió creciendo entre medición y escritura. No es falta de
+    // memoria, sino una condición pasajera, y el cliente puede reintentar.
+    log_w("reporte de estado cambió de tamaño en cada intento, último %u bytes", bufsize);
+    AsyncWebServerResponse * response = request->beginResponse(503, "application/json",
+      "{\"success\":false,\"msg\":\"Estado cambi\\u00f3 mientras se generaba el reporte, reintente\"}");
+    response->addHeader("Retry-After", "1");
+    request->send(response);
+    return;
+  }
+
+  AsyncWebServerResponse * response = YuboxGzip.beginResponse(request, "application/json", len,
+    [json_str, len](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+      if (index >= len) return 0;
+      size_t n = len - index;
+      if (n > maxLen) n = maxLen;
+      memcpy(buf, json_str.get() + index, n);
+      return n;
+    });
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+YuboxStatusClass YuboxStatus;
@@ -0,0 +1,49 @@
+#ifndef _YUBOX_STATUS_CLASS_H_
+#define _YUBOX_STATUS_CLASS_H_
+
+#include <ESPAsyncWebServer.h>
+
+#include "YuboxJSONWriter.h"
+
+#include <functional>
+#include <vector>
+
+// Un proveedor de estado escribe exactamente un valor JSON con el estado de
+// su módulo. Debe ser rápido y no bloquear, porque se ejecuta para cada
+// consulta de /yubox-api/status junto con todos los demás proveedores.
+typedef std::function<void(YuboxJSONWriter &)> YuboxStatusProvider;
+
+// Estado agregado de todos los módulos registrados en una sola respuesta, para
+// que la interfaz web pueda poblar todos sus tabs con una sola petición. La
+// respuesta es un objeto JSON cuyas claves son las rutas, relativas a
+// /yubox-api/, de las que cada valor es equivalente.
+class YuboxStatusClass
+{
+private:
+  typedef struct
+  {
+    String key;
+    YuboxStatusProvider provider;
+  } provider_t;
+
+  std::vector<provider_t> _providers;
+  bool _routesInstalled;
+
+  void _writeStatus(YuboxJSONWriter &);
+  void _routeHandler_yuboxAPI_status_GET(AsyncWebServerRequest *);
+
+public:
+  YuboxStatusClass(void);
+
+  // Instalar la ruta /yubox-api/status. Puede llamarse más de una vez.
+  void begin(AsyncWebServer & srv);
+
+  // Registrar el proveedor para la clave indicada, reemplazando al anterior
+  // si ya existe uno con la misma clave.
+  void addProvider(const char * key, YuboxStatusProvider provider);
+  bool removeProvider(const char * key);
+};
+
+extern YuboxStatusClass YuboxStatus;
+
+#endif
@@ -0,0 +1,246 @@
+#include <Arduino.h>
+#include <AsyncMqttClient.h>
+
+#include "YuboxTelemetry.h"
+#include "YuboxWebSocketMuxClass.h"
+
+// Espacio reservado para el texto de cada valor en la versión JSON, suficiente
+// para un double en %.15g o un entero de 64 bits con signo.
+#define YUBOX_TELEMETRY_JSON_VALUE_MAX  24
+
+static const char _b64chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void _encodeBase64(const uint8_t * src, size_t len, char * dst)
+{
+  size_t i;
+  for (i = 0; i + 2 < len; i += 3) {
+    *dst++ = _b64chars[src[i] >> 2];
+    *dst++ = _b64chars[((src[i] & 0x03) << 4) | (src[i + 1] >> 4)];
+    *dst++ = _b64chars[((src[i + 1] & 0x0F) << 2) | (src[i + 2] >> 6)];
+    *dst++ = _b64chars[src[i + 2] & 0x3F];
+  }
+  if (i < len) {
+    *dst++ = _b64chars[src[i] >> 2];
+    if (i + 1 < len) {
+      *dst++ = _b64chars[((src[i] & 0x03) << 4) | (src[i + 1] >> 4)];
+      *dst++ = _b64chars[(src[i + 1] & 0x0F) << 2];
+    } else {
+      *dst++ = _b64chars[(src[i] & 0x03) << 4];
+      *dst++ = '=';
+    }
+    *dst++ = '=';
+  }
+  *dst = '\0';
+}
+
+static uint64_t _readBE(const uint8_t * p, size_t n)
+{
+  uint64_t v = 0;
+  for (auto i = 0; i < n; i++) v = (v << 8) | p[i];
+  return v;
+}
+
+YuboxTelemetryBase::~YuboxTelemetryBase()
+{
+  if (_cbor != NULL) free(_cbor);
+  if (_json != NULL) free(_json);
+  if (_b64 != NULL) free(_b64);
+}
+
+void YuboxTelemetryBase::_buildTemplate(const char * const * names, const size_t * sizes, size_t count)
+{
+  _names = names;
+  _count = count;
+
+  // Cabecera de mapa, y cada clave como cadena de texto seguida de su valor
+  size_t len = (count < 24) ? 1 : 2;
+  size_t jsonlen = 2;
+  for (auto i = 0; i < count; i++) {
+    size_t keylen = strlen(names[i]);
+    len += ((keylen < 24) ? 1 : 2) + keylen + sizes[i];
+    jsonlen += keylen + 4 + YUBOX_TELEMETRY_JSON_VALUE_MAX;
+  }
+
+  _cbor = (uint8_t *)malloc(len);
+  _json = (char *)malloc(jsonlen);
+  _b64 = (char *)malloc(4 * ((len + 2) / 3) + 1);
+  if (_cbor == NULL || _json == NULL || _b64 == NULL) {
+    log_e("no hay memoria para muestra de telemetría de %u bytes", len);
+    if (_cbor != NULL) { free(_cbor); _cbor = NULL; }
+    return;
+  }
+  _len = len;
+  _jsonSize = jsonlen;
+
+  uint8_t * p = _cbor;
+  if (count < 24) {
+    *p++ = 0xA0 | count;
+  } else {
+    *p++ = 0xB8;
+    *p++ = count;
+  }
+  for (auto i = 0; i < count; i++) {
+    size_t keylen = strlen(names[i]);
+    if (keylen < 24) {
+      *p++ = 0x60 | keylen;
+    } else {
+      *p++ = 0x78;
+      *p++ = keylen;
+    }
+    memcpy(p, names[i], keylen);
+    p += keylen;
+    _offsets[i] = p - _cbor;
+
+    // Valor nulo hasta la primera muestra
+    memset(p, 0, sizes[i]);
+    *p = 0xF6;
+    p += sizes[i];
+  }
+}
+
+void YuboxTelemetryBase::attach(YuboxEventSource & es, YuboxTelemetryFormat format)
+{
+  sink_t s;
+  s.type = SINK_EVENTSOURCE;
+  s.format = format;
+  s.es = &es;
+  s.mqtt = NULL;
+  s.qos = 0;
+  s.retain = false;
+  _sinks.push_back(s);
+}
+
+void YuboxTelemetryBase::attachWebSocket(const char * topic, YuboxTelemetryFormat format)
+{
+  sink_t s;
+  s.type = SINK_WEBSOCKET;
+  s.format = format;
+  s.es = NULL;
+  s.mqtt = NULL;
+  s.topic = topic;
+  s.qos = 0;
+  s.retain = false;
+  _sinks.push_back(s);
+
+  YuboxWebSocketMux.addTopic(topic);
+}
+
+void YuboxTelemetryBase::attachMQTT(AsyncMqttClient & client, const char * topic, uint8_t qos, bool retain,
+  YuboxTelemetryFormat format)
+{
+  sink_t s;
+  s.type = SINK_MQTT;
+  s.format = format;
+  s.es = NULL;
+  s.mqtt = &client;
+  s.topic = topic;
+  s.qos = qos;
+  s.retain = retain;
+  _sinks.push_back(s);
+}
+
+bool YuboxTelemetryBase::_sinkActive(const sink_t & s)
+{
+  switch (s.type) {
+  case SINK_EVENTSOURCE:
+    return s.es->count() > 0;
+  case SINK_WEBSOCKET:
+    return YuboxWebSocketMux.subscribers(s.topic.c_str()) > 0;
+  case SINK_MQTT:
+    return s.mqtt->connected();
+  }
+  return false;
+}
+
+bool YuboxTelemetryBase::active(void)
+{
+  for (auto i = 0; i < _sinks.size(); i++) {
+    if (_sinkActive(_sinks[i])) return true;
+  }
+  return false;
+}
+
+bool YuboxTelemetryBase::_writeJSON(YuboxJSONWriter & json)
+{
+  // La muestra se lee de vuelta del CBOR, que sólo contiene los tipos de ancho
+  // fijo que escriben los campos de YuboxTelemetry.
+  json.beginObject();
+  for (auto i = 0; i < _count; i++) {
+    const uint8_t * p = _cbor + _offsets[i];
+    uint32_t n32;
+    uint64_t n64;
+    float f;
+    double d;
+
+    json.key(_names[i]);
+    switch (p[0]) {
+    case 0xF4: json.value(false); break;
+    case 0xF5: json.value(true); break;
+    case 0xFA:
+      n32 = _readBE(p + 1, 4);
+      memcpy(&f, &n32, sizeof(f));
+      json.value(f);
+      break;
+    case 0xFB:
+      n64 = _readBE(p + 1, 8);
+      memcpy(&d, &n64, sizeof(d));
+      json.value(d);
+      break;
+    case 0x1A: json.value((unsigned long long)_readBE(p + 1, 4)); break;
+    case 0x3A: json.value(-1LL - (long long)_readBE(p + 1, 4)); break;
+    case 0x1B: json.value((unsigned long long)_readBE(p + 1, 8)); break;
+    case 0x3B: json.value(-1LL - (long long)_readBE(p + 1, 8)); break;
+    default: json.valueNull(); break;
+    }
+  }
+  json.endObject();
+  return !json.overflow();
+}
+
+void YuboxTelemetryBase::_publish(void)
+{
+  const char * event = (_event.length() > 0) ? _event.c_str() : NULL;
+  bool haveJSON = false;
+  bool haveB64 = false;
+  size_t jsonlen = 0;
+
+  for (auto i = 0; i < _sinks.size(); i++) {
+    sink_t & s = _sinks[i];
+    if (!_sinkActive(s)) continue;
+
+    // Las representaciones de texto se generan una sola vez por muestra
+    if (s.format == YUBOX_TELEMETRY_JSON && !haveJSON) {
+      YuboxJSONWriter json(_json, _jsonSize);
+      if (!_writeJSON(json)) {
+        log_e("muestra de telemetría excede %u bytes en JSON", _jsonSize);
+        continue;
+      }
+      jsonlen = json.length();
+      haveJSON = true;
+    }
+    if (s.format == YUBOX_TELEMETRY_CBOR && s.type == SINK_EVENTSOURCE && !haveB64) {
+      _encodeBase64(_cbor, _len, _b64);
+      haveB64 = true;
+    }
+
+    switch (s.type) {
+    case SINK_EVENTSOURCE:
+      s.es->send((s.format == YUBOX_TELEMETRY_JSON) ? _json : _b64, event);
+      break;
+    case SINK_WEBSOCKET:
+      if (s.format == YUBOX_TELEMETRY_JSON) {
+        YuboxWebSocketMux.publish(s.topic.c_str(), event, _json, jsonlen);
+      } else {
+        YuboxWebSocketMux.publish(s.topic.c_str(), event, (const char *)_cbor, _len, true);
+      }
+      break;
+    case SINK_MQTT:
+      if (s.format == YUBOX_TELEMETRY_JSON) {
+        s.mqtt->publish(s.topic.c_str(), s.qos, s.retain, _json, jsonlen);
+      } else {
+        s.mqtt->publish(s.topic.c_str(), s.qos, s.retain, (const char *)_cbor, _len);
+      }
+      break;
+    }
+  }
+}
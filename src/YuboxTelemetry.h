@@ -0,0 +1,246 @@
+#ifndef _YUBOX_TELEMETRY_H_
+#define _YUBOX_TELEMETRY_H_
+
+#include <Arduino.h>
+
+#include "YuboxEventSource.h"
+#include "YuboxJSONWriter.h"
+
+#include <vector>
+
+class AsyncMqttClient;
+
+/*
+ * Tipos de campo de un esquema de telemetría. Cada valor se codifica en CBOR
+ * (RFC 8949) con ancho fijo, por lo que el tamaño de una muestra se conoce en
+ * tiempo de compilación y codificar una muestra es sólo copiar bytes a
+ * posiciones ya calculadas.
+ */
+struct YuboxTelemetryBool
+{
+  typedef bool type;
+  static constexpr size_t size = 1;
+  static void encode(uint8_t * p, bool v) { p[0] = v ? 0xF5 : 0xF4; }
+};
+
+struct YuboxTelemetryFloat
+{
+  typedef float type;
+  static constexpr size_t size = 5;
+  static void encode(uint8_t * p, float v)
+  {
+    uint32_t n;
+    memcpy(&n, &v, sizeof(n));
+    p[0] = 0xFA;
+    p[1] = n >> 24; p[2] = n >> 16; p[3] = n >> 8; p[4] = n;
+  }
+};
+
+struct YuboxTelemetryDouble
+{
+  typedef double type;
+  static constexpr size_t size = 9;
+  static void encode(uint8_t * p, double v)
+  {
+    uint64_t n;
+    memcpy(&n, &v, sizeof(n));
+    p[0] = 0xFB;
+    for (auto i = 0; i < 8; i++) p[1 + i] = n >> (56 - 8 * i);
+  }
+};
+
+struct YuboxTelemetryInt32
+{
+  typedef int32_t type;
+  static constexpr size_t size = 5;
+  static void encode(uint8_t * p, int32_t v)
+  {
+    // Los negativos se codifican como -1 - n en el tipo mayor 1
+    uint32_t n = (v < 0) ? (uint32_t)(-1 - v) : (uint32_t)v;
+    p[0] = (v < 0) ? 0x3A : 0x1A;
+    p[1] = n >> 24; p[2] = n >> 16; p[3] = n >> 8; p[4] = n;
+  }
+};
+
+struct YuboxTelemetryUInt32
+{
+  typedef uint32_t type;
+  static constexpr size_t size = 5;
+  static void encode(uint8_t * p, uint32_t n)
+  {
+    p[0] = 0x1A;
+    p[1] = n >> 24; p[2] = n >> 16; p[3] = n >> 8; p[4] = n;
+  }
+};
+
+struct YuboxTelemetryInt64
+{
+  typedef int64_t type;
+  static constexpr size_t size = 9;
+  static void encode(uint8_t * p, int64_t v)
+  {
+    uint64_t n = (v < 0) ? (uint64_t)(-1 - v) : (uint64_t)v;
+    p[0] = (v < 0) ? 0x3B : 0x1B;
+    for (auto i = 0; i < 8; i++) p[1 + i] = n >> (56 - 8 * i);
+  }
+};
+
+struct YuboxTelemetryUInt64
+{
+  typedef uint64_t type;
+  static constexpr size_t size = 9;
+  static void encode(uint8_t * p, uint64_t n)
+  {
+    p[0] = 0x1B;
+    for (auto i = 0; i < 8; i++) p[1 + i] = n >> (56 - 8 * i);
+  }
+};
+
+// Esquema de una muestra como lista de tipos de campo, por ejemplo:
+//  typedef YuboxTelemetrySchema< YuboxTelemetryUInt64, YuboxTelemetryFloat, YuboxTelemetryFloat > lectura_schema_t;
+template <typename... Fields> struct YuboxTelemetrySchema;
+template <> struct YuboxTelemetrySchema<>
+{
+  static constexpr size_t count = 0;
+  static constexpr size_t size = 0;
+};
+template <typename First, typename... Rest> struct YuboxTelemetrySchema<First, Rest...>
+{
+  static constexpr size_t count = 1 + YuboxTelemetrySchema<Rest...>::count;
+  static constexpr size_t size = First::size + YuboxTelemetrySchema<Rest...>::size;
+};
+
+// Formato de la muestra para un destino
+typedef enum
+{
+  // CBOR, como binario en WebSocket y MQTT, y en base64 en SSE
+  YUBOX_TELEMETRY_CBOR,
+
+  // Objeto JSON equivalente, para consumidores que no decodifican CBOR
+  YUBOX_TELEMETRY_JSON
+} YuboxTelemetryFormat;
+
+/*
+ * Parte común de YuboxTelemetry, independiente del esquema. Mantiene la
+ * muestra codificada y la reparte a todos los destinos. La representación
+ * JSON y la base64 se generan a lo sumo una vez por muestra, y sólo si algún
+ * destino con suscriptores las necesita.
+ */
+class YuboxTelemetryBase
+{
+private:
+  typedef enum { SINK_EVENTSOURCE, SINK_WEBSOCKET, SINK_MQTT } sinktype_t;
+
+  typedef struct
+  {
+    sinktype_t type;
+    YuboxTelemetryFormat format;
+    YuboxEventSource * es;
+    AsyncMqttClient * mqtt;
+    String topic;
+    uint8_t qos;
+    bool retain;
+  } sink_t;
+
+  std::vector<sink_t> _sinks;
+  String _event;
+  size_t _count;
+  char * _json;
+  size_t _jsonSize;
+  char * _b64;
+
+  bool _sinkActive(const sink_t &);
+  bool _writeJSON(YuboxJSONWriter &);
+
+protected:
+  const char * const * _names;
+  uint8_t * _cbor;
+  size_t _len;
+  size_t * _offsets;
+
+  YuboxTelemetryBase(void)
+    : _count(0), _json(NULL), _jsonSize(0), _b64(NULL), _names(NULL), _cbor(NULL), _len(0), _offsets(NULL) {}
+  ~YuboxTelemetryBase();
+
+  // Construir la plantilla CBOR con las claves, y calcular la posición de
+  // cada valor a partir de los tamaños indicados.
+  void _buildTemplate(const char * const * names, const size_t * sizes, size_t count);
+
+  void _publish(void);
+
+public:
+  // Nombre del evento en SSE y WebSocket. Por omisión los eventos no tienen
+  // nombre, y se reciben en el navegador como 'message'.
+  void setEvent(const char * event) { _event = (event != NULL) ? event : ""; }
+
+  // Destinos de cada muestra. Una fuente SSE usada aquí no debe replicarse
+  // además con YuboxWebSocketMux.bridge(), o los suscriptores del canal
+  // WebSocket recibirían cada muestra dos veces.
+  void attach(YuboxEventSource & es, YuboxTelemetryFormat format = YUBOX_TELEMETRY_CBOR);
+  void attachWebSocket(const char * topic, YuboxTelemetryFormat format = YUBOX_TELEMETRY_CBOR);
+  void attachMQTT(AsyncMqttClient & client, const char * topic, uint8_t qos = 0, bool retain = false,
+    YuboxTelemetryFormat format = YUBOX_TELEMETRY_CBOR);
+
+  // Verdadero si algún destino tiene a quién entregar una muestra
+  bool active(void);
+
+  // Última muestra codificada
+  const uint8_t * data(void) const { return _cbor; }
+  size_t length(void) const { return _len; }
+};
+
+/*
+ * Telemetría con esquema fijo en tiempo de compilación. Cada muestra se
+ * codifica una sola vez como mapa CBOR con las claves indicadas, y el mismo
+ * búfer se reparte a clientes SSE, WebSocket y MQTT. Del lado del navegador,
+ * yuboxTelemetryDecode() devuelve el mismo objeto que la versión JSON.
+ *
+ * publish() no es reentrante, y debe llamarse siempre desde la misma tarea.
+ */
+template <typename Schema> class YuboxTelemetry;
+
+template <typename... Fields>
+class YuboxTelemetry< YuboxTelemetrySchema<Fields...> > : public YuboxTelemetryBase
+{
+private:
+  typedef YuboxTelemetrySchema<Fields...> schema_t;
+
+  size_t _offsetStorage[schema_t::count];
+
+  template <typename First, typename... Rest>
+  void _encode(size_t i, typename First::type v, typename Rest::type... rest)
+  {
+    First::encode(_cbor + _offsets[i], v);
+    _encode<Rest...>(i + 1, rest...);
+  }
+
+  // Fin de la recursión, sin campos restantes
+  template <typename... None>
+  void _encode(size_t) {}
+
+public:
+  static_assert(schema_t::count > 0, "Esquema de telemetría vacío");
+
+  // Las claves se indican en el orden del esquema, y el arreglo debe ser
+  // estático porque se conserva sólo el puntero.
+  template <size_t N>
+  YuboxTelemetry(const char * const (&names)[N])
+  {
+    static_assert(N == schema_t::count, "Número de claves no coincide con esquema de telemetría");
+    static const size_t sizes[] = { Fields::size... };
+    _offsets = _offsetStorage;
+    _buildTemplate(names, sizes, N);
+  }
+
+  // Codificar y repartir una muestra. Devuelve falso si no había destinos
+  // con suscriptores, en cuyo caso la muestra ni siquiera se codifica.
+  bool publish(typename Fields::type... values)
+  {
+    if (_cbor == NULL || !active()) return false;
+    _encode<Fields...>(0, values...);
+    _publish();
+    return true;
+  }
+};
+
+#endif
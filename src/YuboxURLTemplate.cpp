@@ -0,0 +1,99 @@
+#include <Arduino.h>
+
+#include "YuboxURLTemplate.h"
+
+int YuboxURLCaptures::_indexOf(const char * name) const
+{
+  for (auto i = 0; i < _count; i++) {
+    if (strcmp(_names[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+bool YuboxURLCaptures::add(const char * name, const char * raw, size_t len)
+{
+  if (_count >= YUBOX_URL_MAX_CAPTURES) return false;
+  if (_used + len + 1 > YUBOX_URL_CAPTURE_BUFSIZE) return false;
+
+  // ESPAsyncWebServer ya decodificó las secuencias %XX de request->url(). El
+  // segmento se copia tal cual, porque decodificarlo otra vez alteraría
+  // valores que contienen '%'.
+  memcpy(_buf + _used, raw, len);
+  _buf[_used + len] = '\0';
+
+  _names[_count] = name;
+  _offsets[_count] = _used;
+  _count++;
+  _used += len + 1;
+  return true;
+}
+
+void YuboxURLCaptures::pop(void)
+{
+  if (_count <= 0) return;
+  _count--;
+  _used = _offsets[_count];
+}
+
+const char * YuboxURLCaptures::get(const char * name) const
+{
+  int i = _indexOf(name);
+  return (i >= 0) ? (_buf + _offsets[i]) : NULL;
+}
+
+YuboxURLTemplate::YuboxURLTemplate(const char * tpl)
+{
+  const char * p = tpl;
+  while (*p != '\0') {
+    const char * e = strchr(p, '/');
+    size_t len = (e != NULL) ? (e - p) : strlen(p);
+
+    if (len > 0) {
+      segment_t seg;
+      seg.capture = (len >= 2 && p[0] == '{' && p[len - 1] == '}');
+      const char * s = seg.capture ? (p + 1) : p;
+      size_t n = seg.capture ? (len - 2) : len;
+      seg.text.reserve(n);
+      for (auto j = 0; j < n; j++) seg.text += s[j];
+      _segments.push_back(seg);
+    }
+    p += len;
+    if (*p == '/') p++;
+  }
+
+  if (captureCount() > YUBOX_URL_MAX_CAPTURES) {
+    log_e("plantilla %s excede máximo de %d capturas", tpl, YUBOX_URL_MAX_CAPTURES);
+  }
+}
+
+uint8_t YuboxURLTemplate::captureCount(void) const
+{
+  uint8_t n = 0;
+  for (auto i = 0; i < _segments.size(); i++) if (_segments[i].capture) n++;
+  return n;
+}
+
+bool YuboxURLTemplate::match(const char * url, YuboxURLCaptures & captures) const
+{
+  const char * p = url;
+
+  captures.clear();
+  for (auto i = 0; i < _segments.size(); i++) {
+    while (*p == '/') p++;
+
+    const char * e = strchr(p, '/');
+    size_t len = (e != NULL) ? (e - p) : strlen(p);
+    if (len == 0) return false;
+
+    const segment_t & seg = _segments[i];
+    if (seg.capture) {
+      if (!captures.add(seg.text.c_str(), p, len)) return false;
+    } else {
+      if (seg.text.length() != len || memcmp(seg.text.c_str(), p, len) != 0) return false;
+    }
+    p += len;
+  }
+  while (*p == '/') p++;
+
+  return (*p == '\0');
+}
@@ -0,0 +1,78 @@
+#ifndef _YUBOX_URL_TEMPLATE_H_
+#define _YUBOX_URL_TEMPLATE_H_
+
+#include <Arduino.h>
+
+#include <vector>
+
+// Máximo de segmentos {param} que se capturan de un solo URL
+#define YUBOX_URL_MAX_CAPTURES      4
+
+// Espacio total para los valores capturados, incluyendo el '\0' final de cada
+// uno.
+#define YUBOX_URL_CAPTURE_BUFSIZE   128
+
+// Valores capturados de los segmentos {param} de un URL. Los valores se
+// guardan tal como los entrega request->url(), que ESPAsyncWebServer ya
+// decodificó de %XX. Por lo mismo un %2F en el valor llega como '/' y separa
+// segmentos. Se guardan en un búfer propio de tamaño fijo, por lo que el
+// objeto puede declararse en la pila del manejador de cada petición sin pedir
+// memoria dinámica, y sin compartir estado entre peticiones concurrentes.
+class YuboxURLCaptures
+{
+private:
+  uint8_t _count;
+  uint16_t _used;
+  const char * _names[YUBOX_URL_MAX_CAPTURES];
+  uint16_t _offsets[YUBOX_URL_MAX_CAPTURES];
+  char _buf[YUBOX_URL_CAPTURE_BUFSIZE];
+
+  int _indexOf(const char * name) const;
+
+public:
+  YuboxURLCaptures(void) : _count(0), _used(0) {}
+
+  void clear(void) { _count = 0; _used = 0; }
+
+  // Agregar una captura a partir de un segmento del URL. El nombre debe seguir
+  // siendo válido mientras se use este objeto. Devuelve falso si no hay espacio.
+  bool add(const char * name, const char * raw, size_t len);
+
+  // Quitar la última captura agregada
+  void pop(void);
+
+  uint8_t count(void) const { return _count; }
+  const char * name(uint8_t i) const { return (i < _count) ? _names[i] : NULL; }
+  const char * value(uint8_t i) const { return (i < _count) ? (_buf + _offsets[i]) : NULL; }
+
+  bool has(const char * name) const { return (_indexOf(name) >= 0); }
+
+  // Valor decodificado de la captura indicada, o NULL si no existe
+  const char * get(const char * name) const;
+};
+
+// Plantilla de URL precompilada, de la forma /prefijo/{a}/recurso/{b}. Cada
+// {param} captura un segmento completo del URL. La plantilla se divide en
+// segmentos una sola vez al construirse, y match() no pide memoria dinámica.
+class YuboxURLTemplate
+{
+private:
+  typedef struct
+  {
+    String text;        // Texto literal, o nombre del parámetro
+    bool capture;
+  } segment_t;
+
+  std::vector<segment_t> _segments;
+
+public:
+  YuboxURLTemplate(const char * tpl);
+
+  uint8_t captureCount(void) const;
+
+  // Verificar si el URL (sin parámetros GET) corresponde a la plantilla, y en
+  // ese caso llenar las capturas. Las barras repetidas o finales se ignoran.
+  bool match(const char * url, YuboxURLCaptures & captures) const;
+};
+
+#endif
@@ -1,20 +1,31 @@
 #include "YuboxWebAuthClass.h"
+#include "YuboxRouterClass.h"
+#include "YuboxResponseCacheClass.h"
+#include "YuboxStatusClass.h"
 #include <Preferences.h>
 
 #define ARDUINOJSON_USE_LONG_LONG 1
 
 #include "AsyncJson.h"
 #include "ArduinoJson.h"
+#include "YuboxJSONSchema.h"
+
+#include "mbedtls/md.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 
 #include <functional>
 
 const char * YuboxWebAuthClass::_ns_nvram_yuboxframework_webauth = "YUBOX/Auth";
+static const char * _cachekey_authconfig = "/yubox-api/authconfig";
 
 YuboxWebAuthClass::YuboxWebAuthClass(void)
 {
   _enabledAuth = false;
+  _enabledSession = true;
   _username = "admin";
   _password = "yubox";
+  memset(_sessionKey, 0, sizeof(_sessionKey));
 }
 
 void YuboxWebAuthClass::setEnabled(bool n)
@@ -25,6 +36,7 @@ void YuboxWebAuthClass::setEnabled(bool n)
 
 void YuboxWebAuthClass::begin(AsyncWebServer & srv)
 {
+  _rotateSessionKey();
   _loadSavedAuthsFromNVRAM();
   _updateCredentialsForHandlers();
   _setupHTTPRoutes(srv);
@@ -56,6 +68,127 @@ bool YuboxWebAuthClass::savePassword(String pwd)
   nvram.putString("usr/1/pwd", _password);
 
   _updateCredentialsForHandlers();
+  _rotateSessionKey();
+  YuboxResponseCache.invalidate(_cachekey_authconfig);
+  return true;
+}
+
+void YuboxWebAuthClass::_rotateSessionKey(void)
+{
+  esp_fill_random(_sessionKey, sizeof(_sessionKey));
+}
+
+// Segundos desde el arranque. No se usa la hora NTP porque puede no estar
+// disponible, y la clave de sesión no sobrevive a un reinicio de todas formas.
+static uint32_t _sessionClock(void)
+{
+  return (uint32_t)(esp_timer_get_time() / 1000000LL);
+}
+
+void YuboxWebAuthClass::_computeSessionMAC(uint32_t expiry, uint32_t remoteIP, uint8_t * mac)
+{
+  uint8_t msg[8];
+  uint8_t digest[32];
+
+  msg[0] = expiry >> 24; msg[1] = expiry >> 16; msg[2] = expiry >> 8; msg[3] = expiry;
+  memcpy(msg + 4, &remoteIP, 4);
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+    _sessionKey, sizeof(_sessionKey), msg, sizeof(msg), digest);
+
+  // Se conservan 128 bits del HMAC-SHA256
+  memcpy(mac, digest, 16);
+}
+
+// Manejador que autentica con YuboxWebAuth.authenticate() antes de delegar
+// en otro. El manejador interno no tiene credenciales propias.
+class YuboxWebAuthHandler : public AsyncWebHandler
+{
+private:
+  AsyncWebHandler * _inner;
+
+public:
+  YuboxWebAuthHandler(AsyncWebHandler * inner) : _inner(inner) {}
+
+  virtual bool canHandle(AsyncWebServerRequest * request) override final
+  {
+    if (!(_inner->filter(request) && _inner->canHandle(request))) return false;
+    YuboxWebAuth.addInterestingHeaders(request);
+    return true;
+  }
+
+  virtual void handleRequest(AsyncWebServerRequest * request) override final
+  {
+    // En un WebSocket, esto ocurre antes de responder al upgrade
+    if (!YuboxWebAuth.authenticate(request)) return request->requestAuthentication();
+    _inner->handleRequest(request);
+  }
+
+  virtual void handleUpload(AsyncWebServerRequest * request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) override final
+  {
+    if (!YuboxWebAuth.authenticate(request)) return;
+    _inner->handleUpload(request, filename, index, data, len, final);
+  }
+
+  virtual void handleBody(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total) override final
+  {
+    if (!YuboxWebAuth.authenticate(request)) return;
+    _inner->handleBody(request, data, len, index, total);
+  }
+
+  virtual bool isRequestHandlerTrivial(void) override final { return _inner->isRequestHandlerTrivial(); }
+};
+
+static int _hexNibble(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool YuboxWebAuthClass::_checkSessionCookie(AsyncWebServerRequest * request, uint32_t * pExpiry)
+{
+  AsyncWebHeader * h = request->getHeader("Cookie");
+  if (h == NULL) return false;
+
+  // El nombre sólo cuenta al inicio de la cabecera o luego de "; ", para no
+  // aceptar el valor de otra cookie como XYUBOXSESSION
+  const char * cookies = h->value().c_str();
+  const char * v = NULL;
+  for (const char * p = cookies; (p = strstr(p, YUBOX_WEBAUTH_SESSION_COOKIE "=")) != NULL; p++) {
+    const char * q = p;
+    while (q > cookies && q[-1] == ' ') q--;
+    if (q == cookies || q[-1] == ';') {
+      v = p;
+      break;
+    }
+  }
+  if (v == NULL) return false;
+  v += strlen(YUBOX_WEBAUTH_SESSION_COOKIE "=");
+
+  // Valor de la cookie: expiración en 8 dígitos hex seguida de MAC en 32
+
+  uint8_t raw[4 + 16];
+  for (auto i = 0; i < sizeof(raw); i++) {
+    int hi = _hexNibble(v[2 * i]);
+    if (hi < 0) return false;
+    int lo = _hexNibble(v[2 * i + 1]);
+    if (lo < 0) return false;
+    raw[i] = (hi << 4) | lo;
+  }
+
+  uint32_t expiry = ((uint32_t)raw[0] << 24) | ((uint32_t)raw[1] << 16) | ((uint32_t)raw[2] << 8) | raw[3];
+  if ((int32_t)(expiry - _sessionClock()) <= 0) return false;
+
+  uint8_t mac[16];
+  _computeSessionMAC(expiry, (uint32_t)request->client()->remoteIP(), mac);
+
+  // Comparación en tiempo constante
+  uint8_t diff = 0;
+  for (auto i = 0; i < sizeof(mac); i++) diff |= mac[i] ^ raw[4 + i];
+  if (diff != 0) return false;
+
+  if (pExpiry != NULL) *pExpiry = expiry;
   return true;
 }
 
@@ -105,30 +238,54 @@ bool YuboxWebAuthClass::removeManagedHandler(AsyncWebHandler* handler)
   return true;
 }
 
+AsyncWebHandler * YuboxWebAuthClass::wrap(AsyncWebHandler * handler)
+{
+  handler->setAuthentication("", "");
+  return new YuboxWebAuthHandler(handler);
+}
+
 bool YuboxWebAuthClass::authenticate(AsyncWebServerRequest * request)
 {
   if (!_enabledAuth) return true;
+  if (_enabledSession && _checkSessionCookie(request)) return true;
   return request->authenticate(_username.c_str(), _password.c_str());
 }
 
+void YuboxWebAuthClass::addInterestingHeaders(AsyncWebServerRequest * request)
+{
+  if (_enabledAuth && _enabledSession) request->addInterestingHeader("Cookie");
+}
+
 void YuboxWebAuthClass::_setupHTTPRoutes(AsyncWebServer & srv)
 {
-  srv.on("/yubox-api/authconfig", HTTP_GET, std::bind(&YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_GET, this, std::placeholders::_1));
-  srv.on("/yubox-api/authconfig", HTTP_POST, std::bind(&YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_POST, this, std::placeholders::_1));
+  YuboxRouter.begin(srv);
+  YuboxRouter.on("/yubox-api/authconfig", HTTP_GET, std::bind(&YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/authconfig", HTTP_POST, std::bind(&YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_POST, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/authconfig/session", HTTP_GET, std::bind(&YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_session_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/authconfig/session", HTTP_DELETE, std::bind(&YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_session_DELETE, this, std::placeholders::_1));
+
+  YuboxStatus.begin(srv);
+  YuboxStatus.addProvider("authconfig", [this](YuboxJSONWriter & json) {
+    json.beginObject();
+    json.field("username", _username);
+    json.field("password", _password);
+    json.endObject();
+  });
 }
 
 void YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_GET(AsyncWebServerRequest *request)
 {
   YUBOX_RUN_AUTH(request);
 
-  AsyncResponseStream *response = request->beginResponseStream("application/json");
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(2));
+  uint32_t cachegen;
+  if (YuboxResponseCache.send(request, _cachekey_authconfig, cachegen)) return;
+
+  YuboxJsonDocument< YuboxJSONSchema< YuboxJSONObject<2> > > json_doc;
 
   json_doc["username"] = _username.c_str();
   json_doc["password"] = _password.c_str();
 
-  serializeJson(json_doc, *response);
-  request->send(response);
+  YuboxResponseCache.storeAndSend(request, _cachekey_authconfig, cachegen, json_doc);
 }
 
 void YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_POST(AsyncWebServerRequest *request)
@@ -187,7 +344,7 @@ void YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_POST(AsyncWebServerReq
 
   AsyncResponseStream *response = request->beginResponseStream("application/json");
   response->setCode(httpCode);
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(2));
+  YuboxJsonDocument<YuboxJSONSchema_StatusMsg> json_doc;
   json_doc["success"] = !(clientError || serverError);
   json_doc["msg"] = responseMsg.c_str();
 
@@ -195,4 +352,62 @@ void YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_POST(AsyncWebServerReq
   request->send(response);
 }
 
+void YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_session_GET(AsyncWebServerRequest *request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  YuboxJsonDocument< YuboxJSONSchema< YuboxJSONObject<3> > > json_doc;
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->addHeader("Cache-Control", "no-store");
+
+  uint32_t expiry;
+  if (_enabledAuth && _enabledSession && _checkSessionCookie(request, &expiry)
+    && !request->authenticate(_username.c_str(), _password.c_str())) {
+    // Autenticado sólo por la cookie: no se renueva la expiración, o una
+    // pestaña abierta sin actividad mantendría la sesión indefinidamente
+    json_doc["success"] = true;
+    json_doc["msg"] = "Sesión vigente";
+    json_doc["ttl"] = expiry - _sessionClock();
+  } else if (_enabledAuth && _enabledSession) {
+    // Con credenciales Basic o Digest se emite una sesión nueva
+    expiry = _sessionClock() + YUBOX_WEBAUTH_SESSION_TTL;
+    uint8_t mac[16];
+    _computeSessionMAC(expiry, (uint32_t)request->client()->remoteIP(), mac);
+
+    char cookie[sizeof(YUBOX_WEBAUTH_SESSION_COOKIE) + 1 + 8 + 32 + 64];
+    int n = snprintf(cookie, sizeof(cookie), YUBOX_WEBAUTH_SESSION_COOKIE "=%08x", expiry);
+    for (auto i = 0; i < sizeof(mac); i++) n += snprintf(cookie + n, sizeof(cookie) - n, "%02x", mac[i]);
+    snprintf(cookie + n, sizeof(cookie) - n, "; Max-Age=%u; Path=/; HttpOnly; SameSite=Strict", YUBOX_WEBAUTH_SESSION_TTL);
+    response->addHeader("Set-Cookie", cookie);
+
+    json_doc["success"] = true;
+    json_doc["msg"] = "Sesión iniciada";
+    json_doc["ttl"] = YUBOX_WEBAUTH_SESSION_TTL;
+  } else {
+    json_doc["success"] = true;
+    json_doc["msg"] = "Sesiones no habilitadas";
+    json_doc["ttl"] = 0;
+  }
+
+  serializeJson(json_doc, *response);
+  request->send(response);
+}
+
+void YuboxWebAuthClass::_routeHandler_yuboxAPI_authconfig_session_DELETE(AsyncWebServerRequest *request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  // La cookie deja de enviarse, pero sigue siendo válida hasta su expiración
+  // o hasta el siguiente cambio de clave de sesión.
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->addHeader("Cache-Control", "no-store");
+  response->addHeader("Set-Cookie", YUBOX_WEBAUTH_SESSION_COOKIE "=; Max-Age=0; Path=/; HttpOnly; SameSite=Strict");
+
+  YuboxJsonDocument<YuboxJSONSchema_StatusMsg> json_doc;
+  json_doc["success"] = true;
+  json_doc["msg"] = "Sesión terminada";
+  serializeJson(json_doc, *response);
+  request->send(response);
+}
+
 YuboxWebAuthClass YuboxWebAuth;
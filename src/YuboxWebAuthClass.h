@@ -6,6 +6,12 @@
 
 #include <vector>
 
+// Duración en segundos de la sesión emitida tras un ingreso exitoso
+#define YUBOX_WEBAUTH_SESSION_TTL     (8 * 3600)
+
+// Nombre de la cookie de sesión
+#define YUBOX_WEBAUTH_SESSION_COOKIE  "YUBOXSESSION"
+
 class YuboxWebAuthClass
 {
 private:
@@ -14,6 +20,12 @@ private:
   // Manejo de autenticación habilitada para este proyecto
   bool _enabledAuth;
 
+  // Emisión y aceptación de cookies de sesión. La clave se genera al azar en
+  // cada arranque y en cada cambio de contraseña, lo que invalida todas las
+  // sesiones emitidas hasta ese momento.
+  bool _enabledSession;
+  uint8_t _sessionKey[32];
+
   // Lista de manejadores de rutas que deben setearse usuario/clave
   std::vector<AsyncWebHandler*> _handlers;
 
@@ -24,26 +36,47 @@ private:
 
   void _loadSavedAuthsFromNVRAM(void);
 
+  void _rotateSessionKey(void);
+  void _computeSessionMAC(uint32_t expiry, uint32_t remoteIP, uint8_t * mac);
+  bool _checkSessionCookie(AsyncWebServerRequest *, uint32_t * pExpiry = NULL);
+
   void _setupHTTPRoutes(AsyncWebServer &);
   void _updateCredentialsForHandlers(void);
 
   void _routeHandler_yuboxAPI_authconfig_GET(AsyncWebServerRequest *);
   void _routeHandler_yuboxAPI_authconfig_POST(AsyncWebServerRequest *);
+  void _routeHandler_yuboxAPI_authconfig_session_GET(AsyncWebServerRequest *);
+  void _routeHandler_yuboxAPI_authconfig_session_DELETE(AsyncWebServerRequest *);
   
 public:
   YuboxWebAuthClass(void);
   bool isEnabled(void) { return _enabledAuth; }
   void setEnabled(bool);
+  bool isSessionEnabled(void) { return _enabledSession; }
+  void setSessionEnabled(bool n) { _enabledSession = n; }
   void begin(AsyncWebServer & srv);
 
   AsyncWebHandler& addManagedHandler(AsyncWebHandler* handler);
   bool removeManagedHandler(AsyncWebHandler* handler);
 
+  // Envolver un manejador de ESPAsyncWebServer (AsyncWebSocket,
+  // AsyncStaticWebHandler, AsyncEventSource) para que autentique con
+  // authenticate(), que acepta la cookie de sesión. Con addManagedHandler()
+  // estos manejadores sólo aceptan Basic o Digest. Devuelve el manejador que
+  // debe agregarse al servidor en su lugar.
+  AsyncWebHandler * wrap(AsyncWebHandler * handler);
+
   String getUsername(void) { return _username; }
   String getPassword(void) { return _password; }
   bool savePassword(String);
 
+  // Verdadero si la petición trae una cookie de sesión válida para su IP, o
+  // en su defecto credenciales Basic o Digest válidas.
   bool authenticate(AsyncWebServerRequest *);
+
+  // Conservar las cabeceras que authenticate() necesita. Debe llamarse desde
+  // canHandle() de todo manejador que autentique con authenticate().
+  void addInterestingHeaders(AsyncWebServerRequest *);
 };
 
 extern YuboxWebAuthClass YuboxWebAuth;
@@ -0,0 +1,324 @@
+#include <Arduino.h>
+
+#include "YuboxWebSocketMuxClass.h"
+#include "YuboxWebAuthClass.h"
+#include "YuboxMetricsClass.h"
+
+YuboxWebSocketMuxClass::YuboxWebSocketMuxClass(void)
+{
+  _ws = NULL;
+  _numBuffers = 0;
+  vPortCPUInitializeMutex(&_mux);
+
+  // Se reserva de antemano para que ningún push_back realoje dentro de la
+  // sección crítica.
+  _topics.reserve(YUBOX_WSMUX_MAX_TOPICS);
+  _subs.reserve(YUBOX_WSMUX_MAX_CLIENTS);
+}
+
+void YuboxWebSocketMuxClass::begin(AsyncWebServer & srv)
+{
+  if (_ws != NULL) return;
+
+  _ws = new AsyncWebSocket("/yubox-api/ws");
+  _ws->onEvent(std::bind(&YuboxWebSocketMuxClass::_cbHandler_wsEvent, this,
+    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
+    std::placeholders::_4, std::placeholders::_5, std::placeholders::_6));
+  srv.addHandler(YuboxMetrics.wrap(YuboxWebAuth.wrap(_ws), _ws->url(), true));
+}
+
+int YuboxWebSocketMuxClass::_findTopic(const char * topic, size_t len)
+{
+  for (auto i = 0; i < _topics.size(); i++) {
+    if (_topics[i].name.length() == len && memcmp(_topics[i].name.c_str(), topic, len) == 0) return i;
+  }
+  return -1;
+}
+
+bool YuboxWebSocketMuxClass::addTopic(const char * topic, std::function<void(void)> onSubscribe)
+{
+  // La entrada se arma fuera de la sección crítica, porque copiar el nombre y
+  // la función puede pedir memoria. Dentro sólo se mueve al vector, que ya
+  // tiene su capacidad reservada.
+  size_t len = strlen(topic);
+  topic_t t;
+  t.name = topic;
+  t.onSubscribe = onSubscribe;
+
+  bool exists = false;
+  int idx = -1;
+  portENTER_CRITICAL(&_mux);
+  idx = _findTopic(topic, len);
+  if (idx >= 0) {
+    exists = true;
+  } else if (_topics.size() < YUBOX_WSMUX_MAX_TOPICS) {
+    idx = _topics.size();
+    _topics.push_back(std::move(t));
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  if (exists) log_d("tópico %s ya estaba registrado", topic);
+  if (idx < 0) log_w("se alcanzó máximo de %d tópicos, se ignora %s", YUBOX_WSMUX_MAX_TOPICS, topic);
+  return (idx >= 0);
+}
+
+size_t YuboxWebSocketMuxClass::subscribers(const char * topic)
+{
+  size_t n = 0;
+
+  portENTER_CRITICAL(&_mux);
+  int idx = _findTopic(topic, strlen(topic));
+  if (idx >= 0) {
+    uint32_t bit = 1UL << idx;
+    for (auto i = 0; i < _subs.size(); i++) {
+      if (_subs[i].mask & bit) n++;
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  return n;
+}
+
+void YuboxWebSocketMuxClass::publish(const char * topic, const char * event, const char * data, size_t len, bool binary)
+{
+  if (_ws == NULL) return;
+
+  // Sólo se recogen los IDs bajo la sección crítica. Los clientes se buscan
+  // después, porque la biblioteca de WebSocket toma su propio candado.
+  uint32_t ids[YUBOX_WSMUX_MAX_CLIENTS];
+  size_t n = 0;
+
+  portENTER_CRITICAL(&_mux);
+  int idx = _findTopic(topic, strlen(topic));
+  if (idx >= 0) {
+    uint32_t bit = 1UL << idx;
+    for (auto i = 0; i < _subs.size(); i++) {
+      if (_subs[i].mask & bit) ids[n++] = _subs[i].clientId;
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  if (n <= 0) return;
+
+  size_t topiclen = strlen(topic);
+  size_t eventlen = (event != NULL) ? strlen(event) : 0;
+  char sep = binary ? '\0' : '\n';
+
+  _reapBuffers();
+
+  // La trama no se pide con makeBuffer(), porque la biblioteca sólo libera sus
+  // tramas desde textAll()/binaryAll(). Se lleva la cuenta aquí.
+  AsyncWebSocketMessageBuffer * buffer = new AsyncWebSocketMessageBuffer(topiclen + 1 + eventlen + 1 + len);
+  if (buffer == NULL || buffer->get() == NULL) {
+    log_e("no hay memoria para trama de %u bytes en tópico %s", len, topic);
+    if (buffer != NULL) delete buffer;
+    return;
+  }
+  uint8_t * p = buffer->get();
+  memcpy(p, topic, topiclen); p += topiclen;
+  *p++ = sep;
+  if (eventlen > 0) { memcpy(p, event, eventlen); p += eventlen; }
+  *p++ = sep;
+  memcpy(p, data, len);
+
+  // El candado impide que _reapBuffers() en otra tarea libere la trama antes
+  // de encolarla en todos los clientes.
+  buffer->lock();
+  bool tracked = false;
+  portENTER_CRITICAL(&_mux);
+  if (_numBuffers < YUBOX_WSMUX_MAX_BUFFERS) {
+    _buffers[_numBuffers++] = buffer;
+    tracked = true;
+  }
+  portEXIT_CRITICAL(&_mux);
+  if (!tracked) {
+    log_w("se alcanzó máximo de %d tramas pendientes, se descarta evento de %s", YUBOX_WSMUX_MAX_BUFFERS, topic);
+    delete buffer;
+    return;
+  }
+
+  // La trama se comparte: cada cliente guarda una referencia hasta enviarla.
+  // Un cliente con la cola llena pierde el evento en lugar de acumularlo.
+  for (auto i = 0; i < n; i++) {
+    AsyncWebSocketClient * client = _ws->client(ids[i]);
+    if (client == NULL || client->status() != WS_CONNECTED) continue;
+    if (client->queueIsFull()) {
+      log_w("cliente WebSocket #%u con cola llena, se descarta evento de %s", ids[i], topic);
+      continue;
+    }
+    if (binary) client->binary(buffer); else client->text(buffer);
+  }
+  buffer->unlock();
+
+  // Una trama que ningún cliente aceptó se libera de inmediato
+  _reapBuffers();
+}
+
+void YuboxWebSocketMuxClass::_reapBuffers(void)
+{
+  AsyncWebSocketMessageBuffer * done[YUBOX_WSMUX_MAX_BUFFERS];
+  size_t n = 0;
+
+  // Sólo se separan los punteros bajo la sección crítica. La memoria se
+  // libera después, fuera de ella.
+  portENTER_CRITICAL(&_mux);
+  size_t j = 0;
+  for (auto i = 0; i < _numBuffers; i++) {
+    if (_buffers[i]->canDelete()) done[n++] = _buffers[i]; else _buffers[j++] = _buffers[i];
+  }
+  _numBuffers = j;
+  portEXIT_CRITICAL(&_mux);
+
+  for (auto i = 0; i < n; i++) delete done[i];
+}
+
+void YuboxWebSocketMuxClass::bridge(YuboxEventSource & es, const char * topic)
+{
+  YuboxEventSource * pEs = &es;
+  String t = topic;
+
+  addTopic(topic, [pEs]() { pEs->notifyMirrorConnect(); });
+  es.setMirror(
+    [this, t](const char * message, const char * event) {
+      publish(t.c_str(), event, message, strlen(message));
+    },
+    [this, t]() -> size_t {
+      return subscribers(t.c_str());
+    });
+}
+
+void YuboxWebSocketMuxClass::_removeClient(uint32_t clientId)
+{
+  portENTER_CRITICAL(&_mux);
+  for (auto i = 0; i < _subs.size(); i++) {
+    if (_subs[i].clientId == clientId) {
+      _subs.erase(_subs.begin() + i);
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+void YuboxWebSocketMuxClass::_handleCommand(AsyncWebSocketClient * client, char * cmd)
+{
+  bool subscribe;
+  char * topic;
+  if (strncmp(cmd, "sub ", 4) == 0) {
+    subscribe = true;
+    topic = cmd + 4;
+  } else if (strncmp(cmd, "unsub ", 6) == 0) {
+    subscribe = false;
+    topic = cmd + 6;
+  } else {
+    log_w("cliente WebSocket #%u envió comando desconocido: %s", client->id(), cmd);
+    return;
+  }
+
+  // Sólo se admiten los tópicos registrados por el firmware. De otro modo un
+  // cliente podría agotar los tópicos disponibles con nombres arbitrarios.
+  bool added = false;
+  bool full = false;
+
+  portENTER_CRITICAL(&_mux);
+  int idx = _findTopic(topic, strlen(topic));
+  uint32_t bit = (idx >= 0) ? (1UL << idx) : 0;
+  int pos = -1;
+  for (auto i = 0; i < _subs.size(); i++) {
+    if (_subs[i].clientId == client->id()) {
+      pos = i;
+      break;
+    }
+  }
+  if (subscribe && idx >= 0) {
+    if (pos < 0 && _subs.size() < YUBOX_WSMUX_MAX_CLIENTS) {
+      sub_t s;
+      s.clientId = client->id();
+      s.mask = 0;
+      pos = _subs.size();
+      _subs.push_back(s);
+    }
+    if (pos < 0) {
+      full = true;
+    } else if (!(_subs[pos].mask & bit)) {
+      _subs[pos].mask |= bit;
+      added = true;
+    }
+  } else if (pos >= 0 && bit != 0) {
+    _subs[pos].mask &= ~bit;
+    if (_subs[pos].mask == 0) _subs.erase(_subs.begin() + pos);
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  if (subscribe && idx < 0) {
+    log_w("cliente WebSocket #%u pidió tópico no registrado: %s", client->id(), topic);
+    return;
+  }
+  if (full) {
+    log_w("se alcanzó máximo de %d clientes suscritos, se ignora #%u", YUBOX_WSMUX_MAX_CLIENTS, client->id());
+    return;
+  }
+
+  // El estado inicial se emite fuera de la sección crítica, porque vuelve a
+  // entrar por publish(). Una entrada de tópico no se modifica ni se mueve
+  // luego de agregada, así que su función puede leerse sin el candado.
+  if (added && _topics[idx].onSubscribe) _topics[idx].onSubscribe();
+}
+
+void YuboxWebSocketMuxClass::_cbHandler_wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client,
+  AwsEventType type, void * arg, uint8_t * data, size_t len)
+{
+  AwsFrameInfo * info;
+  char cmd[YUBOX_WSMUX_MAX_COMMAND + 1];
+
+  switch (type) {
+  case WS_EVT_CONNECT:
+    log_d("cliente WebSocket #%u conectado desde %s", client->id(), client->remoteIP().toString().c_str());
+    break;
+  case WS_EVT_DISCONNECT:
+    log_d("cliente WebSocket #%u desconectado", client->id());
+    _removeClient(client->id());
+    _reapBuffers();
+    break;
+  case WS_EVT_DATA:
+    // Los comandos son cortos y siempre caben en una sola trama de texto
+    info = (AwsFrameInfo *)arg;
+    if (!(info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT)) {
+      log_w("cliente WebSocket #%u envió trama fragmentada o binaria, se ignora", client->id());
+      break;
+    }
+    if (len > YUBOX_WSMUX_MAX_COMMAND) {
+      log_w("cliente WebSocket #%u envió comando de %u bytes, se ignora", client->id(), len);
+      break;
+    }
+    memcpy(cmd, data, len);
+    cmd[len] = '\0';
+    _handleCommand(client, cmd);
+    break;
+  default:
+    break;
+  }
+}
+
+YuboxWebSocketMuxClass YuboxWebSocketMux;
+
+YuboxWebSocketTopic::YuboxWebSocketTopic(const char * topic, std::function<void(void)> onSubscribe)
+  : _topic(topic), _onSubscribe(onSubscribe)
+{
+}
+
+void YuboxWebSocketTopic::begin(AsyncWebServer & srv)
+{
+  YuboxWebSocketMux.begin(srv);
+  YuboxWebSocketMux.addTopic(_topic.c_str(), _onSubscribe);
+}
+
+void YuboxWebSocketTopic::send(const char * message, const char * event, uint32_t id, uint32_t reconnect)
+{
+  // El ID y el tiempo de reconexión son propios de SSE y no aplican aquí
+  YuboxWebSocketMux.publish(_topic.c_str(), event, message, strlen(message));
+}
+
+size_t YuboxWebSocketTopic::count(void) const
+{
+  return YuboxWebSocketMux.subscribers(_topic.c_str());
+}
@@ -0,0 +1,121 @@
+#ifndef _YUBOX_WEBSOCKET_MUX_CLASS_H_
+#define _YUBOX_WEBSOCKET_MUX_CLASS_H_
+
+#include <ESPAsyncWebServer.h>
+
+#include "YuboxEventSource.h"
+
+#include <functional>
+#include <vector>
+
+// Máximo de tópicos distintos, uno por bit de la máscara de suscripción
+#define YUBOX_WSMUX_MAX_TOPICS        32
+
+// Máximo de clientes con suscripciones activas
+#define YUBOX_WSMUX_MAX_CLIENTS       8
+
+// Largo máximo de un comando de suscripción enviado por el cliente
+#define YUBOX_WSMUX_MAX_COMMAND       80
+
+// Máximo de tramas compartidas pendientes de envío a algún cliente. Con todas
+// ocupadas, los eventos nuevos se descartan hasta que se envíe alguna.
+#define YUBOX_WSMUX_MAX_BUFFERS       32
+
+/*
+ * Canal WebSocket único en /yubox-api/ws que multiplexa todos los flujos de
+ * eventos del equipo, para que el navegador mantenga un solo socket en lugar
+ * de uno por cada EventSource. Cada flujo se identifica con un tópico, que por
+ * convención es la ruta del flujo SSE equivalente relativa a /yubox-api/, por
+ * ejemplo "wificonfig/netscan".
+ *
+ * El cliente envía tramas de texto con los comandos "sub <tópico>" y
+ * "unsub <tópico>". Sólo puede suscribirse a tópicos ya registrados por el
+ * firmware con addTopic(). Cada evento se envía sólo a los clientes suscritos a su
+ * tópico, como trama de texto "<tópico>\n<evento>\n<datos>", o como trama
+ * binaria "<tópico>\0<evento>\0<datos>" para datos binarios. Un evento sin
+ * nombre se envía con nombre vacío. La trama se construye una sola vez y se
+ * comparte entre todos los clientes suscritos.
+ */
+class YuboxWebSocketMuxClass
+{
+private:
+  typedef struct
+  {
+    String name;
+    std::function<void(void)> onSubscribe;
+  } topic_t;
+
+  typedef struct
+  {
+    uint32_t clientId;
+    uint32_t mask;
+  } sub_t;
+
+  AsyncWebSocket * _ws;
+  portMUX_TYPE _mux;
+  std::vector<topic_t> _topics;
+  std::vector<sub_t> _subs;
+
+  // Tramas propias, no registradas en la biblioteca de WebSocket. Cada una se
+  // libera cuando ya no la referencia la cola de ningún cliente.
+  AsyncWebSocketMessageBuffer * _buffers[YUBOX_WSMUX_MAX_BUFFERS];
+  size_t _numBuffers;
+
+  int _findTopic(const char * topic, size_t len);
+  void _reapBuffers(void);
+  void _handleCommand(AsyncWebSocketClient * client, char * cmd);
+  void _removeClient(uint32_t clientId);
+
+  void _cbHandler_wsEvent(AsyncWebSocket *, AsyncWebSocketClient *, AwsEventType, void *, uint8_t *, size_t);
+
+public:
+  YuboxWebSocketMuxClass(void);
+
+  // Instalar el canal en /yubox-api/ws. Puede llamarse más de una vez.
+  void begin(AsyncWebServer & srv);
+
+  // Registrar un tópico. La función opcional se ejecuta cada vez que un
+  // cliente se suscribe, para enviarle el estado inicial del flujo. Un tópico
+  // ya registrado conserva su función original.
+  bool addTopic(const char * topic, std::function<void(void)> onSubscribe = NULL);
+
+  // Cantidad de clientes suscritos al tópico
+  size_t subscribers(const char * topic);
+
+  // Enviar un evento a todos los clientes suscritos al tópico
+  void publish(const char * topic, const char * event, const char * data, size_t len, bool binary = false);
+  void publish(const char * topic, const char * event, const char * data)
+    { publish(topic, event, data, strlen(data)); }
+
+  // Replicar todos los eventos de la fuente SSE en el tópico indicado. Los
+  // suscriptores del tópico cuentan como clientes de la fuente, y reciben el
+  // evento inicial de su manejador de onConnect.
+  void bridge(YuboxEventSource & es, const char * topic);
+};
+
+extern YuboxWebSocketMuxClass YuboxWebSocketMux;
+
+/*
+ * Adaptador con la misma interfaz de envío de AsyncEventSource, que publica
+ * en un tópico del canal WebSocket. Permite migrar un productor existente
+ * cambiando sólo la declaración del objeto.
+ */
+class YuboxWebSocketTopic
+{
+private:
+  String _topic;
+  std::function<void(void)> _onSubscribe;
+
+public:
+  // El tópico se registra en begin(), porque el objeto puede ser global y
+  // construirse antes que YuboxWebSocketMux.
+  YuboxWebSocketTopic(const char * topic, std::function<void(void)> onSubscribe = NULL);
+  void begin(AsyncWebServer & srv);
+
+  const char * topic(void) const { return _topic.c_str(); }
+  void send(const char * message, const char * event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+  size_t count(void) const;
+  size_t avgPacketsWaiting(void) const { return 0; }
+};
+
+#endif
@@ -7,19 +7,29 @@
 
 #include "AsyncJson.h"
 #include "ArduinoJson.h"
+#include "YuboxJSONSchema.h"
+#include "YuboxResponseCacheClass.h"
+#include "YuboxStatusClass.h"
+#include "YuboxMetricsClass.h"
 
 #include <functional>
 
-#include "Yubox_internal_LastParamRewrite.hpp"
+// Las sugerencias de AP de 802.11k/v sólo están disponibles en versiones del
+// SDK que las soportan y con la opción activada en su configuración.
+#if defined(CONFIG_WPA_11KV_SUPPORT) && CONFIG_WPA_11KV_SUPPORT
+#include "esp_wnm.h"
+#define YUBOX_WIFI_HAS_11KV 1
+#else
+#define YUBOX_WIFI_HAS_11KV 0
+#endif
 
 const char * YuboxWiFiClass::_ns_nvram_yuboxframework_wifi = "YUBOX/WiFi";
+static const char * _cachekey_wificonfig_networks = "/yubox-api/wificonfig/networks";
 void _cb_YuboxWiFiClass_wifiRescan(TimerHandle_t);
+void _cb_YuboxWiFiClass_roamCheck(TimerHandle_t);
 
-// En ciertos escenarios, el re-escaneo de WiFi cada 2 segundos puede interferir
-// con tareas de la aplicación. Para mitigar esto, se escanea cada 30 segundos,
-// a menos que haya al menos un cliente SSE que requiere configurar la red WiFi.
-#define WIFI_RESCAN_FAST  8000
-#define WIFI_RESCAN_SLOW  30000
+// Todos los canales, para _startScan() y _collectScannedNetworks()
+#define WIFI_SCAN_ALL_CHANNELS  0xFFFF
 
 YuboxWiFiClass::YuboxWiFiClass(void)
 {
@@ -33,7 +43,68 @@ YuboxWiFiClass::YuboxWiFiClass(void)
   _wifiReadyEventReceived = false;
   _pEvents = NULL;
   _disconnectBeforeRescan = false;
-  _interval_wifiRescan = WIFI_RESCAN_SLOW;
+  _fastConnectPending = false;
+  _ts_startWiFi = 0;
+  _bootToIPMsec = 0;
+  _bootToIPFast = false;
+
+  // En ciertos escenarios, el re-escaneo frecuente de WiFi puede interferir
+  // con tareas de la aplicación. Por esto se escanea con frecuencia sólo si hay
+  // al menos un cliente SSE que requiere configurar la red WiFi.
+  _scanPolicy.uiInterval = 8000;
+  _scanPolicy.minInterval = 5000;
+  _scanPolicy.maxInterval = 120000;
+  _scanPolicy.dwellTime = 120;
+  _scanPolicy.refreshDwellTime = 40;
+  _scanPolicy.refreshPassive = false;
+  _scanPolicy.fullScanEvery = 4;
+  _scanPolicy.budgetPercent = 25;
+  _scanBackoff = _scanPolicy.minInterval;
+  _scanCycle = 0;
+  _scanRunning = false;
+  _scanChannelsPending = 0;
+  _scanChannelMask = WIFI_SCAN_ALL_CHANNELS;
+  _scanPassive = false;
+  _scanDwellTime = _scanPolicy.dwellTime;
+  _ts_scanStart = 0;
+  _ts_scanEnd = 0;
+  _scanDuration = 0;
+  _scanSSID[0] = '\0';
+
+  _roamPolicy.enabled = false;
+  _roamPolicy.checkInterval = 5000;
+  _roamPolicy.rssiThreshold = -75;
+  _roamPolicy.lowSamples = 3;
+  _roamPolicy.rssiHysteresis = 8;
+  _roamPolicy.minRoamInterval = 60000;
+  _roamInhibit = 0;
+  _roamLowCount = 0;
+  _roamScanPending = false;
+  _roamPending = false;
+  _roamBTMQueried = false;
+  memset(_roamCurrBssid, 0, sizeof(_roamCurrBssid));
+  memset(_roamFrom, 0, sizeof(_roamFrom));
+  memset(_roamTo, 0, sizeof(_roamTo));
+  _roamFromRssi = 0;
+  _roamToRssi = 0;
+  _roamLastBTM = false;
+  _ts_roamScan = 0;
+  _ts_roamStart = 0;
+  _ts_lastRoam = 0;
+  _roamScans = 0;
+  _roamAttempts = 0;
+  _roamCount = 0;
+  _roamCountBTM = 0;
+  _roamFailures = 0;
+  _timer_roamCheck = xTimerCreate(
+    "YuboxWiFiClass_roamCheck",
+    pdMS_TO_TICKS(_roamPolicy.checkInterval),
+    pdTRUE,
+    (void*)this,
+    &_cb_YuboxWiFiClass_roamCheck);
+
+  _rescanForUI = false;
+  _interval_wifiRescan = _scanPolicy.maxInterval;
   _timer_wifiRescan = xTimerCreate(
     "YuboxWiFiClass_wifiRescan",
     pdMS_TO_TICKS(_interval_wifiRescan),
@@ -43,6 +114,8 @@ YuboxWiFiClass::YuboxWiFiClass(void)
 
   WiFi.persistent(false);
 
+  _numScannedNetworks = 0;
+  _scanSeq = 0;
   _scannedNetworks_timestamp = 0;
   setMDNSHostname(tpl);
   setAPName(tpl);
@@ -120,6 +193,12 @@ void YuboxWiFiClass::releaseControlOfWiFi(bool wifioff)
     xTimerStop(_timer_wifiRescan, 0);
   }
   _disconnectBeforeRescan = false;
+  if (xTimerIsTimerActive(_timer_roamCheck)) {
+    xTimerStop(_timer_roamCheck, 0);
+  }
+  _roamScanPending = false;
+  _roamPending = false;
+  if (_fastConnectPending) _abortFastConnect();
   log_i("Desconectando del WiFi (AP)...");
   WiFi.softAPdisconnect(wifioff);
 
@@ -129,37 +208,62 @@ void YuboxWiFiClass::releaseControlOfWiFi(bool wifioff)
 void YuboxWiFiClass::_startCondRescanTimer(bool disconn)
 {
   bool needFastScan = (_pEvents != NULL && _pEvents->count() > 0);
-  if (disconn) _disconnectBeforeRescan = true;
+  bool tmrActive = xTimerIsTimerActive(_timer_wifiRescan);
+  if (disconn) {
+    // Cambio de red pedido por el usuario, se reinicia el retroceso
+    _disconnectBeforeRescan = true;
+    _scanBackoff = _scanPolicy.minInterval;
+  }
   log_v("se requiere escaneo WiFi %s", needFastScan ? "RAPIDO" : "LENTO");
-  if (xTimerIsTimerActive(_timer_wifiRescan)) {
-    log_v("timer escaneo WiFi ACTIVO");
-    if (_interval_wifiRescan == (needFastScan ? WIFI_RESCAN_FAST : WIFI_RESCAN_SLOW)) {
-      log_v("(no se hace nada, escaneo actual es %s)", needFastScan ? "RAPIDO" : "LENTO");
-    } else {
-      log_v("detenido timer de escaneo WiFi");
-      xTimerStop(_timer_wifiRescan, 0);
 
-      log_v("se cambia e inicia escaneo de WiFi %s", needFastScan ? "RAPIDO" : "LENTO");
-      _interval_wifiRescan = needFastScan ? WIFI_RESCAN_FAST : WIFI_RESCAN_SLOW;
-      xTimerChangePeriod(
-        _timer_wifiRescan,
-        pdMS_TO_TICKS(_interval_wifiRescan),
-        portMAX_DELAY);
-    }
+  uint32_t interval;
+  if (needFastScan) {
+    interval = _scanPolicy.uiInterval;
+  } else if (tmrActive && !_rescanForUI) {
+    log_v("(no se hace nada, ya hay escaneo LENTO programado)");
+    return;
   } else {
-    log_v("timer escaneo WiFi INACTIVO");
-    if (_interval_wifiRescan == (needFastScan ? WIFI_RESCAN_FAST : WIFI_RESCAN_SLOW)) {
-      log_v("(se inicia directamente timer scan compatible)");
-      xTimerStart(_timer_wifiRescan, 0);
-    } else {
-      log_v("se cambia e inicia escaneo de WiFi %s", needFastScan ? "RAPIDO" : "LENTO");
-      _interval_wifiRescan = needFastScan ? WIFI_RESCAN_FAST : WIFI_RESCAN_SLOW;
-      xTimerChangePeriod(
-        _timer_wifiRescan,
-        pdMS_TO_TICKS(_interval_wifiRescan),
-        portMAX_DELAY);
-    }
+    // Retroceso exponencial mientras no se encuentre una red a la cual conectarse
+    interval = _scanBackoff;
+    _scanBackoff *= 2;
+    if (_scanBackoff > _scanPolicy.maxInterval) _scanBackoff = _scanPolicy.maxInterval;
   }
+
+  // Respetar el presupuesto de tiempo de radio según la duración del último escaneo
+  uint32_t minGap = _scanBudgetGap();
+  if (interval < minGap) interval = minGap;
+
+  if (tmrActive && _interval_wifiRescan == interval && _rescanForUI == needFastScan) {
+    log_v("(no se hace nada, escaneo actual es %s)", needFastScan ? "RAPIDO" : "LENTO");
+    return;
+  }
+
+  log_v("se programa escaneo de WiFi %s en %u ms", needFastScan ? "RAPIDO" : "LENTO", interval);
+  _interval_wifiRescan = interval;
+  _rescanForUI = needFastScan;
+  xTimerChangePeriod(
+    _timer_wifiRescan,
+    pdMS_TO_TICKS(_interval_wifiRescan),
+    portMAX_DELAY);
+}
+
+uint32_t YuboxWiFiClass::_scanBudgetGap(void)
+{
+  // Pausa mínima luego de un escaneo para no superar el porcentaje de tiempo
+  // de radio dedicado a escanear
+  if (_scanPolicy.budgetPercent == 0 || _scanPolicy.budgetPercent >= 100) return 0;
+  return _scanDuration * (100 - _scanPolicy.budgetPercent) / _scanPolicy.budgetPercent;
+}
+
+void YuboxWiFiClass::setScanPolicy(const YuboxWiFi_scanPolicy & policy)
+{
+  _scanPolicy = policy;
+  if (_scanPolicy.minInterval == 0) _scanPolicy.minInterval = 1000;
+  if (_scanPolicy.uiInterval == 0) _scanPolicy.uiInterval = _scanPolicy.minInterval;
+  if (_scanPolicy.maxInterval < _scanPolicy.minInterval) _scanPolicy.maxInterval = _scanPolicy.minInterval;
+  if (_scanPolicy.fullScanEvery == 0) _scanPolicy.fullScanEvery = 1;
+  if (_scanPolicy.budgetPercent > 100) _scanPolicy.budgetPercent = 100;
+  _scanBackoff = _scanPolicy.minInterval;
 }
 
 void YuboxWiFiClass::beginServerOnWiFiReady(AsyncWebServer * pSrv)
@@ -204,19 +308,54 @@ void YuboxWiFiClass::_bootstrapWebServer(void)
 
 void YuboxWiFiClass::_cbHandler_WiFiEvent_scandone(WiFiEvent_t event, WiFiEventInfo_t)
 {
-  if (_assumeControlOfWiFi) WiFi.setAutoReconnect(true);
-  _collectScannedNetworks();
+  // Un escaneo iniciado por otro dueño del WiFi abarca todos los canales
+  uint16_t channels = WIFI_SCAN_ALL_CHANNELS;
+  const char * ssid = NULL;
+  bool ownScan = _scanRunning;
+  if (ownScan) {
+    channels = _scanChannelMask;
+    if (_scanSSID[0] != '\0') ssid = _scanSSID;
+    _scanRunning = false;
+    _ts_scanEnd = millis();
+    _scanDuration += _ts_scanEnd - _ts_scanStart;
+  }
+
+  _collectScannedNetworks(channels, ssid);
+  _refreshScannedNetworksStatus();
 
-  // Reportar las redes a cualquier cliente SSE que esté escuchando
+  bool changed = false;
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    if (_scannedNetworks[i].change != YUBOX_WIFI_SCAN_UNCHANGED) changed = true;
+  }
+  if (changed) _scanSeq++;
+
+  // Reportar los cambios a cualquier cliente SSE que esté escuchando. Si el
+  // escaneo no cambió nada, no se envía evento alguno.
   if (_pEvents != NULL && _pEvents->count() > 0) {
-    log_v("hay %d clientes SSE conectados, se reporta resultado scan...", _pEvents->count());
-    String json_report = _buildAvailableNetworksJSONReport();
-    _pEvents->send(json_report.c_str(), "WiFiScanResult");
-    if (_assumeControlOfWiFi) _startCondRescanTimer(false);
+    if (changed) {
+      log_v("hay %d clientes SSE conectados, se reportan cambios de scan...", _pEvents->count());
+      _sendAvailableNetworksJSONReport(NULL, true);
+    }
   }
+  _commitScannedNetworks();
+
+  // En un escaneo restringido a ciertos canales, se escanea uno a la vez para
+  // que la radio vuelva al canal de trabajo entre uno y otro.
+  if (ownScan && _scanChannelsPending != 0 && _startNextScanChannel()) return;
+  if (ownScan) _scanSSID[0] = '\0';
+
+  if (_assumeControlOfWiFi) WiFi.setAutoReconnect(true);
+  if (ownScan && _roamScanPending) {
+    _roamScanPending = false;
+    _evaluateRoam();
+  }
+  if (_assumeControlOfWiFi && _pEvents != NULL && _pEvents->count() > 0) _startCondRescanTimer(false);
 
   if (_assumeControlOfWiFi) {
-    if (WiFi.status() != WL_CONNECTED) {
+    if (_fastConnectPending || _roamPending) {
+      // La conexión directa o el cambio de AP en curso deciden si hace falta
+      // elegir otra red
+    } else if (WiFi.status() != WL_CONNECTED) {
       log_d("SYSTEM_EVENT_SCAN_DONE y no conectado a red alguna, se verifica una red...");
       if (_useTrialNetworkFirst) {
         _activeNetwork = _trialNetwork;
@@ -231,16 +370,41 @@ void YuboxWiFiClass::_cbHandler_WiFiEvent_scandone(WiFiEvent_t event, WiFiEventI
   }
 }
 
-void YuboxWiFiClass::_cbHandler_WiFiEvent(WiFiEvent_t event, WiFiEventInfo_t)
+void YuboxWiFiClass::_cbHandler_WiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
 {
     log_v("[WiFi-event] event: %d", event);
     switch(event) {
     case SYSTEM_EVENT_STA_GOT_IP:
         log_d("Conectado al WiFi. Dirección IP: %s", WiFi.localIP().toString().c_str());
+        if (_ts_startWiFi != 0) {
+          _bootToIPMsec = millis() - _ts_startWiFi;
+          _bootToIPFast = _fastConnectPending;
+          log_i("IP obtenida %u ms luego de iniciar WiFi (%s)", _bootToIPMsec,
+            _fastConnectPending ? "conexión directa" : "escaneo");
+          _ts_startWiFi = 0;
+        }
+        _fastConnectPending = false;
+        _scanBackoff = _scanPolicy.minInterval;
         WiFi.setAutoReconnect(true);
         _updateActiveNetworkNVRAM();
+        _trackRoamBSSID();
+        _roamLowCount = 0;
+        if (_roamPolicy.enabled) xTimerStart(_timer_roamCheck, 0);
         break;
     case SYSTEM_EVENT_STA_DISCONNECTED:
+        if (_fastConnectPending) {
+          // El AP guardado no respondió en su canal. Se recurre al escaneo.
+          log_i("Falló conexión directa a red guardada, se escanean redes...");
+          _abortFastConnect();
+          if (!_startScan(WIFI_SCAN_ALL_CHANNELS, false, _scanPolicy.dwellTime)) _startCondRescanTimer(false);
+          break;
+        }
+        if (_roamPending && info.disconnected.reason != WIFI_REASON_ASSOC_LEAVE) {
+          // El AP elegido no aceptó la conexión. La desconexión del AP
+          // anterior al iniciar el cambio (ASSOC_LEAVE) no cuenta.
+          _abortRoam();
+          break;
+        }
         log_d("Se perdió conexión WiFi.");
         _startCondRescanTimer(false);
         break;
@@ -260,38 +424,253 @@ void YuboxWiFiClass::_startWiFi(void)
   WiFi.softAP(_apName.c_str());
   WiFi.setSleep(true);  // <--- NO PONER A FALSE, o de lo contrario BlueTooth se crashea si se inicia simultáneamente
 
+  _ts_startWiFi = millis();
+  WiFi.setAutoReconnect(false);
+  if (_startFastConnect()) return;
+
   log_d("Iniciando escaneo de redes WiFi (1)...");
+  _startScan(WIFI_SCAN_ALL_CHANNELS, false, _scanPolicy.dwellTime);
+}
+
+bool YuboxWiFiClass::_startScan(uint16_t channels, bool passive, uint16_t dwellTime, const char * ssid)
+{
+  if (_scanRunning) return (ssid == NULL);
+
+  _scanChannelsPending = (channels == WIFI_SCAN_ALL_CHANNELS) ? 0 : channels;
+  _scanChannelMask = WIFI_SCAN_ALL_CHANNELS;
+  _scanPassive = passive;
+  _scanDwellTime = dwellTime;
+  _scanDuration = 0;
+  _scanSSID[0] = '\0';
+  if (ssid != NULL) {
+    strncpy(_scanSSID, ssid, sizeof(_scanSSID) - 1);
+    _scanSSID[sizeof(_scanSSID) - 1] = '\0';
+  }
   WiFi.setAutoReconnect(false);
-  WiFi.scanNetworks(true);
+  return _startNextScanChannel();
 }
 
-void YuboxWiFiClass::_collectScannedNetworks(void)
+bool YuboxWiFiClass::_startNextScanChannel(void)
+{
+  wifi_scan_config_t config;
+  memset(&config, 0, sizeof(config));
+
+  // Canal 0 escanea todos los canales en una sola operación
+  _scanChannelMask = WIFI_SCAN_ALL_CHANNELS;
+  for (uint8_t i = 1; i < 16 && _scanChannelsPending != 0; i++) {
+    if (!(_scanChannelsPending & (1 << i))) continue;
+    _scanChannelsPending &= ~(1 << i);
+    _scanChannelMask = (1 << i);
+    config.channel = i;
+    break;
+  }
+  config.ssid = (_scanSSID[0] != '\0') ? (uint8_t *)_scanSSID : NULL;
+  config.show_hidden = false;
+  if (_scanPassive) {
+    config.scan_type = WIFI_SCAN_TYPE_PASSIVE;
+    config.scan_time.passive = _scanDwellTime;
+  } else {
+    config.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    config.scan_time.active.min = _scanDwellTime / 2;
+    config.scan_time.active.max = _scanDwellTime;
+  }
+
+  // Se invoca al driver directamente porque WiFi.scanNetworks() no permite
+  // elegir el canal. El resultado se sigue leyendo con WiFi.scanComplete().
+  WiFi.scanDelete();
+  _ts_scanStart = millis();
+  esp_err_t err = esp_wifi_scan_start(&config, false);
+  if (err != ESP_OK) {
+    log_w("no se puede iniciar escaneo WiFi (canal %u): %d", config.channel, err);
+    _scanChannelsPending = 0;
+    _scanRunning = false;
+    _scanSSID[0] = '\0';
+    return false;
+  }
+  _scanRunning = true;
+  return true;
+}
+
+uint16_t YuboxWiFiClass::_knownChannelMask(void)
+{
+  // Canales donde se vieron por última vez las redes guardadas
+  uint16_t channels = 0;
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    if (_scannedNetworks[i].status & YUBOX_WIFI_SCAN_SAVED) channels |= (1 << _scannedNetworks[i].channel);
+  }
+  for (auto i = 0; i < _savedNetworks.size(); i++) {
+    if (_savedNetworks[i].fast.channel != 0) channels |= (1 << _savedNetworks[i].fast.channel);
+  }
+  return channels & ~1;
+}
+
+bool YuboxWiFiClass::_startFastConnect(void)
+{
+  // La red fijada tiene prioridad. De otro modo se usa la última red a la
+  // que se conectó con éxito.
+  int netIdx = -1;
+  if (_selNetwork >= 0 && _selNetwork < _savedNetworks.size()) {
+    netIdx = _selNetwork;
+  } else for (auto i = 0; i < _savedNetworks.size(); i++) {
+    if (_savedNetworks[i].selectedNet) {
+      netIdx = i;
+      break;
+    }
+  }
+  if (netIdx == -1 || _savedNetworks[netIdx].fast.channel == 0) return false;
+
+  const YuboxWiFi_fastconn & fast = _savedNetworks[netIdx].fast;
+  log_d("Conexión directa a red guardada %s en canal %u...", _savedNetworks[netIdx].cred.ssid.c_str(), fast.channel);
+#if YUBOX_WIFI_FAST_STATIC_IP
+  if (fast.ip != 0) WiFi.config(IPAddress(fast.ip), IPAddress(fast.gateway), IPAddress(fast.netmask), IPAddress(fast.dns));
+#endif
+  _fastConnectPending = true;
+  _activeNetwork = _savedNetworks[netIdx].cred;
+  _connectToActiveNetwork(&fast);
+  return true;
+}
+
+void YuboxWiFiClass::_abortFastConnect(void)
+{
+  _fastConnectPending = false;
+#if YUBOX_WIFI_FAST_STATIC_IP
+  // Volver a DHCP para las conexiones luego de escanear
+  WiFi.config((uint32_t)0, (uint32_t)0, (uint32_t)0);
+#endif
+}
+
+static void _formatBSSID(char * s, const uint8_t * bssid)
+{
+  sprintf(s, "%02X:%02X:%02X:%02X:%02X:%02X",
+    bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+}
+
+YuboxWiFi_scanCache * YuboxWiFiClass::_findScannedNetwork(const uint8_t * bssid)
+{
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    if (memcmp(_scannedNetworks[i].bssid, bssid, 6) == 0) return &(_scannedNetworks[i]);
+  }
+  return NULL;
+}
+
+void YuboxWiFiClass::_collectScannedNetworks(uint16_t channels, const char * ssid)
 {
-  std::vector<YuboxWiFi_scanCache> t;
-  unsigned long ts = millis();
   int16_t n = WiFi.scanComplete();
 
-  if (n != WIFI_SCAN_FAILED) for (auto i = 0; i < n; i++) {
-    YuboxWiFi_scanCache e;
+  // Un escaneo fallido conserva la caché anterior
+  if (n < 0) return;
+
+  for (auto i = 0; i < _numScannedNetworks; i++) _scannedNetworks[i].seen = 0;
 
-    e.bssid = WiFi.BSSIDstr(i);
-    e.ssid = WiFi.SSID(i);
-    e.channel = WiFi.channel(i);
-    e.rssi = WiFi.RSSI(i);
-    e.authmode = (uint8_t)WiFi.encryptionType(i);
+  // Se leen los registros del escaneo directamente, sin construir un String
+  // por cada BSSID y SSID.
+  for (auto i = 0; i < n; i++) {
+    const wifi_ap_record_t * ap = (const wifi_ap_record_t *)WiFi.getScanInfoByIndex(i);
+    if (ap == NULL) continue;
 
-    t.push_back(e);
+    YuboxWiFi_scanCache * e = _findScannedNetwork(ap->bssid);
+    if (e == NULL) {
+      if (_numScannedNetworks >= YUBOX_WIFI_SCAN_MAX) {
+        log_w("caché de escaneo llena (%u redes), se descarta red", YUBOX_WIFI_SCAN_MAX);
+        continue;
+      }
+      e = &(_scannedNetworks[_numScannedNetworks++]);
+      memset(e, 0, sizeof(YuboxWiFi_scanCache));
+      memcpy(e->bssid, ap->bssid, 6);
+      e->change = YUBOX_WIFI_SCAN_ADDED;
+    } else if (e->seen) {
+      // BSSID repetido en el mismo escaneo
+      continue;
+    }
+    e->seen = 1;
+
+    if (e->change != YUBOX_WIFI_SCAN_ADDED) {
+      if (strncmp(e->ssid, (const char *)ap->ssid, sizeof(e->ssid) - 1) != 0
+        || e->channel != (ap->primary & 0x0F)
+        || e->authmode != ((uint8_t)ap->authmode & 0x0F)
+        || abs(e->rssi - ap->rssi) >= YUBOX_WIFI_SCAN_RSSI_DELTA) {
+        e->change = YUBOX_WIFI_SCAN_CHANGED;
+      } else {
+        // Variación menor de RSSI, no se reporta
+        continue;
+      }
+    }
+    strncpy(e->ssid, (const char *)ap->ssid, sizeof(e->ssid) - 1);
+    e->ssid[sizeof(e->ssid) - 1] = '\0';
+    e->channel = ap->primary;
+    e->authmode = (uint8_t)ap->authmode;
+    e->rssi = ap->rssi;
   }
   if (_assumeControlOfWiFi) WiFi.scanDelete();
 
+  // Sólo desaparecen las redes de los canales escaneados, y si el escaneo
+  // buscaba una red, sólo los APs de esa red
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    if (_scannedNetworks[i].seen) continue;
+    if (!(channels & (1 << _scannedNetworks[i].channel))
+      || (ssid != NULL && strcmp(ssid, _scannedNetworks[i].ssid) != 0)) {
+      _scannedNetworks[i].seen = 1;
+      continue;
+    }
+    _scannedNetworks[i].change = YUBOX_WIFI_SCAN_REMOVED;
+  }
+
   // TODO: candados en este acceso?
-  _scannedNetworks_timestamp = ts;
-  _scannedNetworks = t;
+  _scannedNetworks_timestamp = millis();
+}
+
+void YuboxWiFiClass::_refreshScannedNetworksStatus(void)
+{
+  String currNet = WiFi.SSID();
+  uint8_t * currBssid = WiFi.BSSID();
+  wl_status_t currNetStatus = WiFi.status();
+  if (currNet.isEmpty()) {
+    currNet = _activeNetwork.ssid;
+  }
+
+  bool redVista = false;
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    YuboxWiFi_scanCache & e = _scannedNetworks[i];
+    if (e.change == YUBOX_WIFI_SCAN_REMOVED) continue;
+
+    uint8_t status = 0;
+    if (currNet == e.ssid && ((currBssid == NULL && !redVista) || (currBssid != NULL && memcmp(currBssid, e.bssid, 6) == 0))) {
+      if (currNetStatus == WL_CONNECTED) status |= YUBOX_WIFI_SCAN_CONNECTED;
+      if (currNetStatus == WL_CONNECT_FAILED || currNetStatus == WL_DISCONNECTED) status |= YUBOX_WIFI_SCAN_CONNFAIL;
+      redVista = true;
+    }
+    for (auto j = 0; j < _savedNetworks.size(); j++) {
+      if (_savedNetworks[j].cred.ssid == e.ssid) {
+        status |= YUBOX_WIFI_SCAN_SAVED;
+        break;
+      }
+    }
+
+    if (e.status != status) {
+      e.status = status;
+      if (e.change == YUBOX_WIFI_SCAN_UNCHANGED) e.change = YUBOX_WIFI_SCAN_CHANGED;
+    }
+  }
+}
+
+void YuboxWiFiClass::_commitScannedNetworks(void)
+{
+  // Compactar la caché quitando las redes desaparecidas, y marcar las demás
+  // como ya reportadas.
+  uint8_t n = 0;
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    YuboxWiFi_scanCache & e = _scannedNetworks[i];
+    if (e.change == YUBOX_WIFI_SCAN_REMOVED) continue;
+    e.change = YUBOX_WIFI_SCAN_UNCHANGED;
+    if (n != i) _scannedNetworks[n] = e;
+    n++;
+  }
+  _numScannedNetworks = n;
 }
 
 void YuboxWiFiClass::_chooseKnownScannedNetwork(void)
 {
-  int16_t n = _scannedNetworks.size();
+  int16_t n = _numScannedNetworks;
 
   if (n >= 0) {
     int netIdx = -1;
@@ -301,7 +680,7 @@ void YuboxWiFiClass::_chooseKnownScannedNetwork(void)
       // Hay una red seleccionada. Buscar si está presente en el escaneo
       log_v("red fijada, verificando si existe en escaneo...");
       for (int i = 0; i < n; i++) {
-        if (_scannedNetworks[i].ssid == _savedNetworks[_selNetwork].cred.ssid) {
+        if (_savedNetworks[_selNetwork].cred.ssid == _scannedNetworks[i].ssid) {
           log_v("red seleccionada %u existe en escaneo (%s)", _selNetwork, _savedNetworks[_selNetwork].cred.ssid.c_str());
           netIdx = _selNetwork;
           break;
@@ -319,7 +698,7 @@ void YuboxWiFiClass::_chooseKnownScannedNetwork(void)
 
         // Primero la red debe ser conocida
         for (int j = 0; j < _savedNetworks.size(); j++) {
-          if (_scannedNetworks[i].ssid == _savedNetworks[j].cred.ssid) {
+          if (_savedNetworks[j].cred.ssid == _scannedNetworks[i].ssid) {
             netFound = j;
             netFound_rssi =_scannedNetworks[i].rssi;
             break;
@@ -384,8 +763,13 @@ void YuboxWiFiClass::_chooseKnownScannedNetwork(void)
   }
 }
 
-void YuboxWiFiClass::_connectToActiveNetwork(void)
+void YuboxWiFiClass::_connectToActiveNetwork(const YuboxWiFi_fastconn * fast)
 {
+  // Con datos de conexión directa, se fija el canal y el AP para omitir el
+  // escaneo que hace el driver antes de asociarse.
+  int32_t channel = (fast != NULL) ? fast->channel : 0;
+  const uint8_t * bssid = (fast != NULL) ? fast->bssid : NULL;
+
   // Iniciar conexión a red elegida según credenciales
   if (!_activeNetwork.identity.isEmpty()) {
     // Autenticación WPA-Enterprise
@@ -396,16 +780,34 @@ void YuboxWiFiClass::_connectToActiveNetwork(void)
     esp_wifi_sta_wpa2_ent_set_new_password((const unsigned char *)_activeNetwork.password.c_str(), _activeNetwork.password.length());
     esp_wpa2_config_t wpa2_config = WPA2_CONFIG_INIT_DEFAULT();
     esp_wifi_sta_wpa2_ent_enable(&wpa2_config);
-    WiFi.begin(_activeNetwork.ssid.c_str());
+    _beginSTA(NULL, channel, bssid);
   } else if (!_activeNetwork.psk.isEmpty()) {
     // Autenticación con clave
-    WiFi.begin(_activeNetwork.ssid.c_str(), _activeNetwork.psk.c_str());
+    _beginSTA(_activeNetwork.psk.c_str(), channel, bssid);
   } else {
     // Red abierta
-    WiFi.begin(_activeNetwork.ssid.c_str());
+    _beginSTA(NULL, channel, bssid);
   }
 }
 
+void YuboxWiFiClass::_beginSTA(const char * psk, int32_t channel, const uint8_t * bssid)
+{
+#if YUBOX_WIFI_HAS_11KV
+  // Anunciar soporte de 802.11k/v al asociarse, para que el AP pueda sugerir
+  // a qué otro AP cambiarse.
+  WiFi.begin(_activeNetwork.ssid.c_str(), psk, channel, bssid, false);
+  wifi_config_t conf;
+  if (esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK) {
+    conf.sta.rm_enabled = 1;
+    conf.sta.btm_enabled = 1;
+    esp_wifi_set_config(WIFI_IF_STA, &conf);
+  }
+  esp_wifi_connect();
+#else
+  WiFi.begin(_activeNetwork.ssid.c_str(), psk, channel, bssid);
+#endif
+}
+
 void YuboxWiFiClass::_loadSavedNetworksFromNVRAM(void)
 {
   if (!_savedNetworks.empty()) return;
@@ -439,6 +841,8 @@ void YuboxWiFiClass::_loadOneNetworkFromNVRAM(Preferences & nvram, uint32_t idx,
     sprintf(key, "net/%u/identity", idx); r.cred.identity = nvram.getString(key);
     sprintf(key, "net/%u/password", idx); r.cred.password = nvram.getString(key);
     sprintf(key, "net/%u/lastsel", idx); r.selectedNet = nvram.getBool(key, false);
+    sprintf(key, "net/%u/fast", idx);
+    if (nvram.getBytes(key, &(r.fast), sizeof(r.fast)) != sizeof(r.fast)) memset(&(r.fast), 0, sizeof(r.fast));
     r._dirty = false;
 }
 
@@ -466,6 +870,8 @@ void YuboxWiFiClass::_saveOneNetworkToNVRAM(Preferences & nvram, uint32_t idx, Y
     sprintf(key, "net/%u/identity", idx); NVRAM_PUTSTRING(nvram, key, r.cred.identity);
     sprintf(key, "net/%u/password", idx); NVRAM_PUTSTRING(nvram, key, r.cred.password);
     sprintf(key, "net/%u/lastsel", idx); nvram.putBool(key, r.selectedNet);
+    sprintf(key, "net/%u/fast", idx);
+    if (r.fast.channel != 0) nvram.putBytes(key, &(r.fast), sizeof(r.fast)); else nvram.remove(key);
     r._dirty = false;
 }
 
@@ -477,6 +883,18 @@ void YuboxWiFiClass::_updateActiveNetworkNVRAM(void)
   char key[64];
   nvram.begin(_ns_nvram_yuboxframework_wifi, false);
 
+  // Datos para conexión directa en el próximo arranque
+  YuboxWiFi_fastconn fast;
+  memset(&fast, 0, sizeof(fast));
+  uint8_t * bssid = WiFi.BSSID();
+  if (bssid != NULL) memcpy(fast.bssid, bssid, sizeof(fast.bssid));
+  fast.channel = WiFi.channel();
+  fast.ip = (uint32_t)WiFi.localIP();
+  fast.gateway = (uint32_t)WiFi.gatewayIP();
+  fast.netmask = (uint32_t)WiFi.subnetMask();
+  fast.dns = (uint32_t)WiFi.dnsIP();
+  if (bssid == NULL) fast.channel = 0;
+
   for (auto i = 0; i < _savedNetworks.size(); i++) {
     bool nv = (_savedNetworks[i].cred.ssid == currNet);
 
@@ -484,6 +902,12 @@ void YuboxWiFiClass::_updateActiveNetworkNVRAM(void)
       _savedNetworks[i].selectedNet = nv;
       sprintf(key, "net/%u/lastsel", i+1); nvram.putBool(key, _savedNetworks[i].selectedNet);
     }
+
+    // Se escribe sólo si cambió, para no desgastar la flash en cada reconexión
+    if (nv && memcmp(&fast, &(_savedNetworks[i].fast), sizeof(fast)) != 0) {
+      _savedNetworks[i].fast = fast;
+      sprintf(key, "net/%u/fast", i+1); nvram.putBytes(key, &fast, sizeof(fast));
+    }
   }
 }
 
@@ -508,121 +932,192 @@ YuboxWiFi_cred YuboxWiFiClass::getLastActiveNetwork(void)
 
 void YuboxWiFiClass::_setupHTTPRoutes(AsyncWebServer & srv)
 {
-  srv.on("/yubox-api/wificonfig/connection", HTTP_GET, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_connection_GET, this, std::placeholders::_1));
-  srv.on("/yubox-api/wificonfig/connection", HTTP_PUT, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_connection_PUT, this, std::placeholders::_1));
-  srv.on("/yubox-api/wificonfig/connection", HTTP_DELETE, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_connection_DELETE, this, std::placeholders::_1));
-  srv.on("/yubox-api/wificonfig/networks", HTTP_GET, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_GET, this, std::placeholders::_1));
-  srv.on("/yubox-api/wificonfig/networks", HTTP_POST, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_POST, this, std::placeholders::_1));
-  srv.on("/yubox-api/wificonfig/networks", HTTP_DELETE, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_DELETE, this, std::placeholders::_1));
+  YuboxRouter.begin(srv);
+  YuboxRouter.on("/yubox-api/wificonfig/connection", HTTP_GET, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_connection_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/wificonfig/connection", HTTP_PUT, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_connection_PUT, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/wificonfig/connection", HTTP_DELETE, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_connection_DELETE, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/wificonfig/roaming", HTTP_GET, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_roaming_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/wificonfig/scanpolicy", HTTP_GET, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_scanpolicy_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/wificonfig/scanpolicy", HTTP_PUT, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_scanpolicy_PUT, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/wificonfig/networks", HTTP_GET, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_GET, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/wificonfig/networks", HTTP_POST, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_POST, this, std::placeholders::_1));
+  YuboxRouter.on("/yubox-api/wificonfig/networks", HTTP_DELETE, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_DELETE, this, std::placeholders::_1));
   srv.on("/_spiffslist.html", HTTP_GET, std::bind(&YuboxWiFiClass::_routeHandler_spiffslist_GET, this, std::placeholders::_1));
-  srv.addRewrite(new Yubox_internal_LastParamRewrite(
-    "/yubox-api/wificonfig/networks/{SSID}",
-    "/yubox-api/wificonfig/networks?ssid={SSID}"
-  ));
-  _pEvents = new AsyncEventSource("/yubox-api/wificonfig/netscan");
+  YuboxRouter.onCaptures("/yubox-api/wificonfig/networks/{ssid}", HTTP_GET, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_ssid_GET, this, std::placeholders::_1, std::placeholders::_2));
+  YuboxRouter.onCaptures("/yubox-api/wificonfig/networks/{ssid}", HTTP_DELETE, std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_ssid_DELETE, this, std::placeholders::_1, std::placeholders::_2));
+  // Sólo interesa el reporte más reciente de cada tipo
+  _pEvents = new YuboxEventSource("/yubox-api/wificonfig/netscan", YUBOX_EVENTSOURCE_COALESCE);
   YuboxWebAuth.addManagedHandler(_pEvents);
-  srv.addHandler(_pEvents);
+  srv.addHandler(YuboxMetrics.wrap(_pEvents, _pEvents->url(), true));
   _pEvents->onConnect(std::bind(&YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_netscan_onConnect, this, std::placeholders::_1));
+  YuboxWebSocketMux.begin(srv);
+  YuboxWebSocketMux.bridge(*_pEvents, "wificonfig/netscan");
+
+  // En el reporte agregado, la conexión inactiva se reporta como null
+  YuboxStatus.begin(srv);
+  YuboxStatus.addProvider("wificonfig/connection", [this](YuboxJSONWriter & json) {
+    if (WiFi.status() == WL_CONNECTED) {
+      _writeConnectionJSON(json);
+    } else {
+      json.valueNull();
+    }
+  });
+  YuboxStatus.addProvider("wificonfig/networks", std::bind(&YuboxWiFiClass::_writeSavedNetworksJSONReport, this, std::placeholders::_1));
+  YuboxStatus.addProvider("wificonfig/roaming", std::bind(&YuboxWiFiClass::_writeRoamingJSON, this, std::placeholders::_1));
 }
 
-String YuboxWiFiClass::_buildAvailableNetworksJSONReport(void)
+void YuboxWiFiClass::_writeScannedNetworkJSON(YuboxJSONWriter & json, const YuboxWiFi_scanCache & e)
 {
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(11));
-  String json_output;
-
-  json_output = "[";
-
-  String currNet = WiFi.SSID();
-  String currBssid = WiFi.BSSIDstr();
-  wl_status_t currNetStatus = WiFi.status();
-  if (currNet.isEmpty()) {
-    currNet = _activeNetwork.ssid;
-  }
-
-  bool redVista = false;
-  for (int i = 0; i < _scannedNetworks.size(); i++) {
-    if (i > 0) json_output += ",";
-
-    String temp_bssid = _scannedNetworks[i].bssid;
-    String temp_ssid = _scannedNetworks[i].ssid;
-    String temp_psk;
-    String temp_identity;
-    String temp_password;
-
-    json_doc["bssid"] = temp_bssid.c_str();
-    json_doc["ssid"] = temp_ssid.c_str();
-    json_doc["channel"] = _scannedNetworks[i].channel;
-    json_doc["rssi"] = _scannedNetworks[i].rssi;
-    json_doc["authmode"] = _scannedNetworks[i].authmode;
-
-    // TODO: actualizar estado de bandera de conexión exitosa
-    json_doc["connected"] = false;
-    json_doc["connfail"] = false;
-    if (temp_ssid == currNet && ((currBssid.isEmpty() && !redVista) || temp_bssid == currBssid)) {
-      if (currNetStatus == WL_CONNECTED) json_doc["connected"] = true;
-      if (currNetStatus == WL_CONNECT_FAILED || currNetStatus == WL_DISCONNECTED) json_doc["connfail"] = true;
-      redVista = true;
-    }
-
-    // Asignar clave conocida desde NVRAM si está disponible
-    json_doc["saved"] = false;
-    json_doc["psk"] = (char *)NULL;
-    json_doc["identity"] = (char *)NULL;
-    json_doc["password"] = (char *)NULL;
-
-    unsigned int j;
+  char bssid[18];
+  _formatBSSID(bssid, e.bssid);
+
+  json.beginObject();
+  json.field("bssid", bssid);
+  json.field("ssid", e.ssid);
+  json.field("channel", (int)e.channel);
+  json.field("rssi", (int)e.rssi);
+  json.field("authmode", (int)e.authmode);
+  json.field("connected", (e.status & YUBOX_WIFI_SCAN_CONNECTED) != 0);
+  json.field("connfail", (e.status & YUBOX_WIFI_SCAN_CONNFAIL) != 0);
+
+  // Asignar clave conocida desde NVRAM si está disponible
+  unsigned int j = _savedNetworks.size();
+  if (e.status & YUBOX_WIFI_SCAN_SAVED) {
     for (j = 0; j < _savedNetworks.size(); j++) {
-      if (_savedNetworks[j].cred.ssid == temp_ssid) break;
+      if (_savedNetworks[j].cred.ssid == e.ssid) break;
     }
-    if (j < _savedNetworks.size()) {
-      json_doc["saved"] = true;       // Se tiene disponible información sobre la red
-
-      temp_psk = _savedNetworks[j].cred.psk;
-      if (!temp_psk.isEmpty()) json_doc["psk"] = temp_psk.c_str();
+  }
+  if (j < _savedNetworks.size()) {
+    // Se tiene disponible información sobre la red
+    const YuboxWiFi_cred & cred = _savedNetworks[j].cred;
+    json.field("saved", true);
+    json.field("psk", cred.psk.isEmpty() ? NULL : cred.psk.c_str());
+    json.field("identity", cred.identity.isEmpty() ? NULL : cred.identity.c_str());
+    json.field("password", cred.password.isEmpty() ? NULL : cred.password.c_str());
+  } else {
+    json.field("saved", false);
+    json.key("psk").valueNull();
+    json.key("identity").valueNull();
+    json.key("password").valueNull();
+  }
+  json.endObject();
+}
 
-      temp_identity = _savedNetworks[j].cred.identity;
-      if (!temp_identity.isEmpty()) json_doc["identity"] = temp_identity.c_str();
+void YuboxWiFiClass::_writeAvailableNetworksJSONReport(YuboxJSONWriter & json)
+{
+  // Lista completa de redes, con el número de secuencia sobre el cual se
+  // aplican los siguientes reportes de cambios.
+  json.beginObject();
+  json.field("seq", (unsigned long)_scanSeq);
+  json.key("networks").beginArray();
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    if (_scannedNetworks[i].change == YUBOX_WIFI_SCAN_REMOVED) continue;
+    _writeScannedNetworkJSON(json, _scannedNetworks[i]);
+  }
+  json.endArray();
+  json.endObject();
+}
 
-      temp_password = _savedNetworks[j].cred.password;
-      if (!temp_password.isEmpty()) json_doc["password"] = temp_password.c_str();
-    }
+void YuboxWiFiClass::_writeScanDiffJSONReport(YuboxJSONWriter & json)
+{
+  // Cambios respecto al reporte con secuencia base. Las redes agregadas y
+  // cambiadas se envían completas, y de las quitadas sólo el BSSID.
+  json.beginObject();
+  json.field("seq", (unsigned long)_scanSeq);
+  json.field("base", (unsigned long)(_scanSeq - 1));
+  json.key("added").beginArray();
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    if (_scannedNetworks[i].change != YUBOX_WIFI_SCAN_ADDED) continue;
+    _writeScannedNetworkJSON(json, _scannedNetworks[i]);
+  }
+  json.endArray();
+  json.key("changed").beginArray();
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    if (_scannedNetworks[i].change != YUBOX_WIFI_SCAN_CHANGED) continue;
+    _writeScannedNetworkJSON(json, _scannedNetworks[i]);
+  }
+  json.endArray();
+  json.key("removed").beginArray();
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    const YuboxWiFi_scanCache & e = _scannedNetworks[i];
+    if (e.change != YUBOX_WIFI_SCAN_REMOVED) continue;
+
+    char bssid[18];
+    _formatBSSID(bssid, e.bssid);
+    json.value(bssid);
+  }
+  json.endArray();
+  json.endObject();
+}
 
-    serializeJson(json_doc, json_output);
+void YuboxWiFiClass::_sendAvailableNetworksJSONReport(YuboxEventSourceClient * client, bool diff)
+{
+  // Se mide primero el reporte para pedir exactamente la memoria necesaria
+  // en una sola operación, en lugar de hacer crecer una cadena por cada red.
+  YuboxJSONWriter measure(NULL, 0);
+  if (diff) _writeScanDiffJSONReport(measure); else _writeAvailableNetworksJSONReport(measure);
+
+  size_t buflen = measure.length() + 1;
+  char * buf = (char *)malloc(buflen);
+  if (buf == NULL) {
+    log_e("no hay memoria para reporte de %u bytes de redes WiFi", buflen);
+    return;
   }
 
-  json_output += "]";
-  return json_output;
+  const char * event = diff ? "WiFiScanDiff" : "WiFiScanResult";
+  YuboxJSONWriter json(buf, buflen);
+  if (diff) _writeScanDiffJSONReport(json); else _writeAvailableNetworksJSONReport(json);
+  if (json.overflow()) {
+    // La lista de redes cambió entre la medición y la escritura
+    log_w("lista de redes cambió durante reporte, se descarta");
+  } else if (client != NULL) {
+    client->send(buf, event);
+  } else {
+    _pEvents->send(buf, event);
+  }
+  free(buf);
 }
 
-void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_netscan_onConnect(AsyncEventSourceClient *)
+void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_netscan_onConnect(YuboxEventSourceClient * client)
 {
-  // Emitir estado actual de control de WiFi
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(1));
-  json_doc["yubox_control_wifi"] = _assumeControlOfWiFi;
-  String json_str;
-  serializeJson(json_doc, json_str);
-  _pEvents->send(json_str.c_str(), "WiFiStatus");
+  // Emitir estado actual de control de WiFi, sólo al cliente recién conectado.
+  // Un suscriptor del canal WebSocket llega sin cliente, y se emite a todos.
+  char json_str[32];
+  YuboxJSONWriter json(json_str, sizeof(json_str));
+  json.beginObject().field("yubox_control_wifi", _assumeControlOfWiFi).endObject();
+  if (client != NULL) {
+    client->send(json_str, "WiFiStatus");
+  } else {
+    _pEvents->send(json_str, "WiFiStatus");
+  }
 
-  // Emitir cualquier lista disponible de inmediato, posiblemente poblada por otro dueño de WiFi
-  String json_report = _buildAvailableNetworksJSONReport();
-  _pEvents->send(json_report.c_str(), "WiFiScanResult");
+  // Emitir cualquier lista disponible de inmediato, posiblemente poblada por
+  // otro dueño de WiFi. Este es el único reporte completo; en adelante el
+  // cliente recibe sólo los cambios de cada escaneo. El estado de conexión
+  // puede haber cambiado desde el último escaneo, y los demás clientes lo
+  // reciben en el siguiente reporte de cambios.
+  _refreshScannedNetworksStatus();
+  _sendAvailableNetworksJSONReport(client);
 
   // No iniciar escaneo a menos que se tenga control del WiFi
   if (!_assumeControlOfWiFi) return;
 
+  // Si hay un escaneo en curso, su resultado programa el siguiente escaneo
+  if (_scanRunning) return;
+
   // Si el timer está activo, pero en escaneo lento, debe de desactivarse
   bool tmrActive = xTimerIsTimerActive(_timer_wifiRescan);
-  if (tmrActive && _interval_wifiRescan == WIFI_RESCAN_SLOW) {
+  if (tmrActive && !_rescanForUI) {
     log_v("se detiene timer rescan wifi LENTO porque se conectó cliente para configurar WiFi");
     xTimerStop(_timer_wifiRescan, 0);
-    log_d("Iniciando escaneo de redes WiFi (2b)...");
-    WiFi.setAutoReconnect(false);
-    WiFi.scanNetworks(true);
-  } else if (!tmrActive) {
-    // Por ahora no me interesa el cliente individual, sólo el hecho de que se debe iniciar escaneo
-    log_d("Iniciando escaneo de redes WiFi (2a)...");
-    WiFi.setAutoReconnect(false);
-    WiFi.scanNetworks(true);
+    tmrActive = false;
+  }
+  if (!tmrActive) {
+    // Por ahora no me interesa el cliente individual, sólo el hecho de que se
+    // debe iniciar escaneo. El primer escaneo es completo para mostrar la lista.
+    log_d("Iniciando escaneo de redes WiFi (2)...");
+    _scanCycle = 0;
+    if (!_startScan(WIFI_SCAN_ALL_CHANNELS, false, _scanPolicy.dwellTime)) _startCondRescanTimer(false);
   }
 }
 
@@ -676,33 +1171,39 @@ void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_connection_GET(AsyncWebSe
     return;
   }
 
-  AsyncResponseStream *response = request->beginResponseStream("application/json");
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(10) + JSON_ARRAY_SIZE(3));
-
-  String temp_ssid = WiFi.SSID();
-  String temp_bssid = WiFi.BSSIDstr();
-  String temp_mac = WiFi.macAddress();
-  String temp_ipv4 = WiFi.localIP().toString();
-  String temp_gw = WiFi.gatewayIP().toString();
-  String temp_netmask = WiFi.subnetMask().toString();
-  String temp_dns[3];
-
-  json_doc["connected"] = true;
-  json_doc["rssi"] = WiFi.RSSI();
-  json_doc["ssid"] = temp_ssid.c_str();
-  json_doc["bssid"] = temp_bssid.c_str();
-  json_doc["mac"] = temp_mac.c_str();
-  json_doc["ipv4"] = temp_ipv4.c_str();
-  json_doc["gateway"] = temp_gw.c_str();
-  json_doc["netmask"] = temp_netmask.c_str();
-  JsonArray json_dns = json_doc.createNestedArray("dns");
-  for (auto i = 0; i < 3; i++) {
-    temp_dns[i] = WiFi.dnsIP(i).toString();
-    if (temp_dns[i] != "0.0.0.0") json_dns.add(temp_dns[i].c_str());
+  char json_str[YUBOX_JSON_WRITER_RECORD_SIZE];
+  YuboxJSONWriter json(json_str, sizeof(json_str));
+
+  _writeConnectionJSON(json);
+  if (json.overflow()) {
+    request->send(500, "application/json", "{\"msg\":\"Estado de conexi\\u00f3n excede espacio de respuesta\"}");
+    return;
   }
+  request->send(200, "application/json", json_str);
+}
 
-  serializeJson(json_doc, *response);
-  request->send(response);
+void YuboxWiFiClass::_writeConnectionJSON(YuboxJSONWriter & json)
+{
+  json.beginObject();
+  json.field("connected", true);
+  json.field("rssi", (int)WiFi.RSSI());
+  json.field("ssid", WiFi.SSID());
+  json.field("bssid", WiFi.BSSIDstr());
+  json.field("mac", WiFi.macAddress());
+  json.field("ipv4", WiFi.localIP().toString());
+  json.field("gateway", WiFi.gatewayIP().toString());
+  json.field("netmask", WiFi.subnetMask().toString());
+  json.key("dns").beginArray();
+  for (auto i = 0; i < 3; i++) {
+    String temp_dns = WiFi.dnsIP(i).toString();
+    if (temp_dns != "0.0.0.0") json.value(temp_dns);
+  }
+  json.endArray();
+  if (_bootToIPMsec != 0) {
+    json.field("boot_to_ip_ms", (unsigned long)_bootToIPMsec);
+    json.field("fastconnect", _bootToIPFast);
+  }
+  json.endObject();
 }
 
 void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_connection_PUT(AsyncWebServerRequest *request)
@@ -720,6 +1221,10 @@ void YuboxWiFiClass::_addOneSavedNetwork(AsyncWebServerRequest *request, bool sw
   AsyncWebParameter * p;
   YuboxWiFi_nvramrec tempNetwork;
   bool pinNetwork = false;
+
+  memset(&(tempNetwork.fast), 0, sizeof(tempNetwork.fast));
+  tempNetwork.selectedNet = false;
+  tempNetwork.numFails = 0;
   uint8_t authmode;
 
   if (!clientError) {
@@ -809,6 +1314,10 @@ void YuboxWiFiClass::_addOneSavedNetwork(AsyncWebServerRequest *request, bool sw
 
       if (_savedNetworks[i].cred.ssid == tempNetwork.cred.ssid) {
         idx = i;
+        // El AP y canal siguen siendo válidos aunque cambien las credenciales,
+        // y la red sigue siendo la última usada para la conexión directa
+        tempNetwork.fast = _savedNetworks[idx].fast;
+        tempNetwork.selectedNet = _savedNetworks[idx].selectedNet;
         _savedNetworks[idx] = tempNetwork;
         break;
       }
@@ -821,6 +1330,7 @@ void YuboxWiFiClass::_addOneSavedNetwork(AsyncWebServerRequest *request, bool sw
 
     // Mandar a guardar el vector modificado
     _saveNetworksToNVRAM();
+    YuboxResponseCache.invalidate(_cachekey_wificonfig_networks);
     if (switch2net && _assumeControlOfWiFi) {
       _useTrialNetworkFirst = true;
       _trialNetwork = tempNetwork.cred;
@@ -836,7 +1346,7 @@ void YuboxWiFiClass::_addOneSavedNetwork(AsyncWebServerRequest *request, bool sw
 
   AsyncResponseStream *response = request->beginResponseStream("application/json");
   response->setCode(httpCode);
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(2));
+  YuboxJsonDocument<YuboxJSONSchema_StatusMsg> json_doc;
   json_doc["success"] = !(clientError || serverError);
   json_doc["msg"] = responseMsg.c_str();
 
@@ -883,6 +1393,7 @@ void YuboxWiFiClass::_delOneSavedNetwork(AsyncWebServerRequest *request, String
 
     // Mandar a guardar el vector modificado
     _saveNetworksToNVRAM();
+    YuboxResponseCache.invalidate(_cachekey_wificonfig_networks);
   } else if (!deleteconnected) {
     request->send(404, "application/json", "{\"msg\":\"No existe la red indicada\"}");
     return;
@@ -895,58 +1406,92 @@ void YuboxWiFiClass::_delOneSavedNetwork(AsyncWebServerRequest *request, String
   }
 }
 
-void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_GET(AsyncWebServerRequest *request)
+void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_ssid_GET(AsyncWebServerRequest *request, const YuboxURLCaptures & captures)
 {
   YUBOX_RUN_AUTH(request);
 
-  if (request->hasParam("ssid")) {
-    AsyncWebParameter* p = request->getParam("ssid");
-
-    // Buscar cuál índice de red guardada corresponde a este SSID
-    auto idx = -1;
-    for (auto i = 0; i < _savedNetworks.size(); i++) {
-      if (_savedNetworks[i].cred.ssid == p->value()) {
-        idx = i;
-        break;
-      }
-    }
-    if (idx == -1) {
-      // Red indicada no se encuentra
-      request->send(404, "application/json", "{\"msg\":\"No existe la red indicada\"}");
-    } else {
-      AsyncResponseStream *response = request->beginResponseStream("application/json");
-
-      _serializeOneSavedNetwork(response, idx);
+  _sendOneSavedNetwork(request, captures.get("ssid"));
+}
 
-      request->send(response);
+void YuboxWiFiClass::_sendOneSavedNetwork(AsyncWebServerRequest *request, const String & ssid)
+{
+  // Buscar cuál índice de red guardada corresponde a este SSID
+  auto idx = -1;
+  for (auto i = 0; i < _savedNetworks.size(); i++) {
+    if (_savedNetworks[i].cred.ssid == ssid) {
+      idx = i;
+      break;
     }
+  }
+  if (idx == -1) {
+    // Red indicada no se encuentra
+    request->send(404, "application/json", "{\"msg\":\"No existe la red indicada\"}");
   } else {
-    // Volcar todas las redes guardadas en NVRAM
-    AsyncResponseStream *response = request->beginResponseStream("application/json");
-    response->print("[");
-    for (auto i = 0; i < _savedNetworks.size(); i++) {
-      if (i > 0) response->print(",");
+    char json_str[YUBOX_JSON_WRITER_RECORD_SIZE];
+    YuboxJSONWriter json(json_str, sizeof(json_str));
 
-      _serializeOneSavedNetwork(response, i);
+    _serializeOneSavedNetwork(json, idx);
+    if (json.overflow()) {
+      request->send(500, "application/json", "{\"msg\":\"Credenciales de red exceden espacio de respuesta\"}");
+      return;
     }
-    response->print("]");
-    request->send(response);
+    request->send(200, "application/json", json_str);
   }
 }
 
-void YuboxWiFiClass::_serializeOneSavedNetwork(AsyncResponseStream *response, uint32_t i)
+void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_GET(AsyncWebServerRequest *request)
 {
-  DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(4));
+  YUBOX_RUN_AUTH(request);
+
+  if (request->hasParam("ssid")) {
+    _sendOneSavedNetwork(request, request->getParam("ssid")->value());
+    return;
+  }
 
-  json_doc["ssid"] = _savedNetworks[i].cred.ssid.c_str();
-  json_doc["psk"] = (const char *)NULL;
-  json_doc["identity"] = (const char *)NULL;
-  json_doc["password"] = (const char *)NULL;
-  if (_savedNetworks[i].cred.psk.length() > 0) json_doc["psk"] = _savedNetworks[i].cred.psk.c_str();
-  if (_savedNetworks[i].cred.identity.length() > 0) json_doc["identity"] = _savedNetworks[i].cred.identity.c_str();
-  if (_savedNetworks[i].cred.password.length() > 0) json_doc["password"] = _savedNetworks[i].cred.password.c_str();
+  uint32_t cachegen;
+  if (YuboxResponseCache.send(request, _cachekey_wificonfig_networks, cachegen)) return;
+
+  // Se mide el reporte completo para guardarlo en caché si cabe
+  YuboxJSONWriter measure(NULL, 0);
+  _writeSavedNetworksJSONReport(measure);
+  size_t len = measure.length();
+  char * json_str = (len <= YUBOX_RESPONSE_CACHE_MAXBYTES) ? (char *)malloc(len + 1) : NULL;
+  if (json_str != NULL) {
+    YuboxJSONWriter json(json_str, len + 1);
+    _writeSavedNetworksJSONReport(json);
+    YuboxResponseCache.storeAndSend(request, _cachekey_wificonfig_networks, cachegen, "application/json", json_str, len);
+    free(json_str);
+    return;
+  }
 
-  serializeJson(json_doc, *response);
+  // Volcar todas las redes guardadas en NVRAM, una a la vez según haya
+  // espacio en la conexión.
+  request->send(YuboxJSONWriter::beginArrayResponse(request, [this](YuboxJSONWriter & json, size_t i) {
+    if (i >= _savedNetworks.size()) return false;
+    _serializeOneSavedNetwork(json, i);
+    return true;
+  }));
+}
+
+void YuboxWiFiClass::_writeSavedNetworksJSONReport(YuboxJSONWriter & json)
+{
+  json.beginArray();
+  for (auto i = 0; i < _savedNetworks.size(); i++) {
+    _serializeOneSavedNetwork(json, i);
+  }
+  json.endArray();
+}
+
+void YuboxWiFiClass::_serializeOneSavedNetwork(YuboxJSONWriter & json, uint32_t i)
+{
+  const YuboxWiFi_cred & cred = _savedNetworks[i].cred;
+
+  json.beginObject();
+  json.field("ssid", cred.ssid);
+  json.field("psk", cred.psk.isEmpty() ? NULL : cred.psk.c_str());
+  json.field("identity", cred.identity.isEmpty() ? NULL : cred.identity.c_str());
+  json.field("password", cred.password.isEmpty() ? NULL : cred.password.c_str());
+  json.endObject();
 }
 
 void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_POST(AsyncWebServerRequest *request)
@@ -971,6 +1516,16 @@ void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_DELETE(AsyncWebS
   _delOneSavedNetwork(request, ssid, deleteconnected);
 }
 
+void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_networks_ssid_DELETE(AsyncWebServerRequest *request, const YuboxURLCaptures & captures)
+{
+  YUBOX_RUN_AUTH(request);
+
+  String ssid = captures.get("ssid");
+  bool deleteconnected = (WiFi.status() == WL_CONNECTED && ssid == WiFi.SSID());
+
+  _delOneSavedNetwork(request, ssid, deleteconnected);
+}
+
 void _cb_YuboxWiFiClass_wifiRescan(TimerHandle_t timer)
 {
   YuboxWiFiClass *self = (YuboxWiFiClass *)pvTimerGetTimerID(timer);
@@ -985,12 +1540,410 @@ void YuboxWiFiClass::_cbHandler_WiFiRescan(TimerHandle_t timer)
     log_v("Desconectando antes de escaneo...");
     WiFi.disconnect(true);
   }
-  WiFi.mode(WIFI_AP_STA);
-  if (WiFi.scanComplete() != WIFI_SCAN_RUNNING && (WiFi.status() != WL_CONNECTED || (_pEvents != NULL && _pEvents->count() > 0))) {
-    log_d("DEBUG: Iniciando escaneo de redes WiFi (3)...");
-    WiFi.setAutoReconnect(false);
-    WiFi.scanNetworks(true);
+  if (WiFi.getMode() != WIFI_AP_STA) WiFi.mode(WIFI_AP_STA);
+  if (_scanRunning) return;
+
+  bool uiListening = (_pEvents != NULL && _pEvents->count() > 0);
+  bool full = ((++_scanCycle % _scanPolicy.fullScanEvery) == 0);
+  bool started = true;
+  if (uiListening) {
+    // La lista mostrada requiere todos los canales, pero entre escaneos
+    // completos basta con refrescar RSSI con un escaneo más corto.
+    log_d("DEBUG: Iniciando escaneo de redes WiFi (3) %s...", full ? "completo" : "de refresco");
+    if (full) {
+      started = _startScan(WIFI_SCAN_ALL_CHANNELS, false, _scanPolicy.dwellTime);
+    } else {
+      started = _startScan(WIFI_SCAN_ALL_CHANNELS, _scanPolicy.refreshPassive, _scanPolicy.refreshDwellTime);
+    }
+  } else if (WiFi.status() != WL_CONNECTED) {
+    // Sin red conectada, se buscan las redes guardadas en sus canales conocidos
+    uint16_t channels = full ? 0 : _knownChannelMask();
+    if (channels == 0) channels = WIFI_SCAN_ALL_CHANNELS;
+    log_d("DEBUG: Iniciando escaneo de redes WiFi (3) canales 0x%04x...", channels);
+    started = _startScan(channels, false, _scanPolicy.dwellTime);
   }
+
+  // Reintentar más tarde si el driver rechazó el escaneo
+  if (!started) xTimerStart(_timer_wifiRescan, 0);
+}
+
+void YuboxWiFiClass::setRoamPolicy(const YuboxWiFi_roamPolicy & policy)
+{
+  _roamPolicy = policy;
+  if (_roamPolicy.checkInterval < 1000) _roamPolicy.checkInterval = 1000;
+  if (_roamPolicy.lowSamples == 0) _roamPolicy.lowSamples = 1;
+  _roamLowCount = 0;
+
+  if (!_roamPolicy.enabled) {
+    if (xTimerIsTimerActive(_timer_roamCheck)) xTimerStop(_timer_roamCheck, 0);
+  } else {
+    // Cambiar el periodo también inicia el timer
+    xTimerChangePeriod(_timer_roamCheck, pdMS_TO_TICKS(_roamPolicy.checkInterval), portMAX_DELAY);
+  }
+}
+
+void YuboxWiFiClass::inhibitRoaming(bool inhibit)
+{
+  if (inhibit) {
+    if (_roamInhibit < 255) _roamInhibit++;
+  } else {
+    if (_roamInhibit > 0) _roamInhibit--;
+  }
+  log_v("roaming %s (%u)", (_roamInhibit > 0) ? "inhibido" : "permitido", _roamInhibit);
+}
+
+void _cb_YuboxWiFiClass_roamCheck(TimerHandle_t timer)
+{
+  YuboxWiFiClass *self = (YuboxWiFiClass *)pvTimerGetTimerID(timer);
+  return self->_cbHandler_WiFiRoamCheck(timer);
+}
+
+void YuboxWiFiClass::_cbHandler_WiFiRoamCheck(TimerHandle_t timer)
+{
+  if (!_roamPolicy.enabled || !_assumeControlOfWiFi) return;
+
+  // El plazo del cambio de AP se verifica también sin conexión, porque un AP
+  // elegido que no responde deja al equipo desconectado.
+  bool connected = (WiFi.status() == WL_CONNECTED);
+  if (connected) _trackRoamBSSID();
+  if (_roamPending) {
+    if (millis() - _ts_roamStart > 20000) {
+      log_w("reconexión a otro AP no concluyó a tiempo");
+      _abortRoam();
+    }
+    return;
+  }
+  if (!connected || _roamScanPending || _scanRunning) return;
+
+  // Histéresis sobre el umbral: la señal entre el umbral y el umbral más la
+  // histéresis no cuenta como degradada ni como recuperada.
+  int8_t rssi = WiFi.RSSI();
+  if (rssi == 0) return;
+  if (rssi < _roamPolicy.rssiThreshold) {
+    if (_roamLowCount < 255) _roamLowCount++;
+  } else if (rssi >= _roamPolicy.rssiThreshold + _roamPolicy.rssiHysteresis) {
+    _roamLowCount = 0;
+  }
+  if (_roamLowCount < _roamPolicy.lowSamples) return;
+
+  if (_roamInhibit > 0) {
+    log_v("señal degradada (%d dBm) pero roaming inhibido", rssi);
+    return;
+  }
+  if (_ts_roamScan != 0 && millis() - _ts_roamScan < _roamPolicy.minRoamInterval) return;
+
+  // La búsqueda de AP también cuenta dentro del presupuesto de tiempo de radio
+  if (_ts_scanEnd != 0 && millis() - _ts_scanEnd < _scanBudgetGap()) return;
+
+  _startRoamScan(rssi);
+}
+
+void YuboxWiFiClass::_startRoamScan(int8_t rssi)
+{
+  uint8_t * bssid = WiFi.BSSID();
+  if (bssid == NULL) return;
+
+  String currNet = WiFi.SSID();
+  if (currNet != _activeNetwork.ssid) return;
+
+  log_d("señal degradada (%d dBm), se busca otro AP de %s...", rssi, currNet.c_str());
+  _ts_roamScan = millis();
+  memcpy(_roamFrom, bssid, sizeof(_roamFrom));
+  _roamFromRssi = rssi;
+  _roamScans++;
+
+#if YUBOX_WIFI_HAS_11KV
+  // Pedir al AP una sugerencia de transición por RSSI bajo (razón 16). Si el
+  // AP la envía, el driver cambia de AP por sí mismo.
+  _roamBTMQueried = (esp_wnm_send_bss_transition_mgmt_query(16, NULL, 0) == 0);
+#endif
+
+  // Buscar la red actual en los canales donde se han visto sus APs. Si no se
+  // conoce otro canal aparte del actual, se escanean todos.
+  uint16_t channels = (1 << WiFi.channel());
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    if (currNet == _scannedNetworks[i].ssid) channels |= (1 << _scannedNetworks[i].channel);
+  }
+  channels &= ~1;
+  if ((channels & (channels - 1)) == 0) channels = WIFI_SCAN_ALL_CHANNELS;
+
+  _roamScanPending = _startScan(channels, false, _scanPolicy.dwellTime, currNet.c_str());
+}
+
+void YuboxWiFiClass::_evaluateRoam(void)
+{
+  if (WiFi.status() != WL_CONNECTED || _roamInhibit > 0) return;
+
+  // Si el AP sugirió otro durante la búsqueda, el cambio ya ocurrió
+  uint8_t * bssid = WiFi.BSSID();
+  if (bssid == NULL || memcmp(bssid, _roamFrom, sizeof(_roamFrom)) != 0) return;
+
+  int8_t rssi = WiFi.RSSI();
+  const YuboxWiFi_scanCache * best = NULL;
+  for (auto i = 0; i < _numScannedNetworks; i++) {
+    const YuboxWiFi_scanCache & e = _scannedNetworks[i];
+    if (_activeNetwork.ssid != e.ssid) continue;
+    if (memcmp(e.bssid, bssid, sizeof(e.bssid)) == 0) continue;
+    if (e.rssi < rssi + _roamPolicy.rssiHysteresis) continue;
+    if (best == NULL || e.rssi > best->rssi) best = &e;
+  }
+  if (best == NULL) {
+    log_d("no hay AP de %s mejor que el actual (%d dBm)", _activeNetwork.ssid.c_str(), rssi);
+    return;
+  }
+
+  // Reconectar fijando el BSSID y canal del AP elegido
+  YuboxWiFi_fastconn target;
+  memset(&target, 0, sizeof(target));
+  memcpy(target.bssid, best->bssid, sizeof(target.bssid));
+  target.channel = best->channel;
+
+  char bssidstr[18];
+  _formatBSSID(bssidstr, best->bssid);
+  log_i("cambiando a AP %s en canal %u (%d dBm, actual %d dBm)...", bssidstr, best->channel, best->rssi, rssi);
+
+  _roamFromRssi = rssi;
+  _roamToRssi = best->rssi;
+  _roamPending = true;
+  _roamAttempts++;
+  _ts_roamStart = millis();
+  _connectToActiveNetwork(&target);
+}
+
+void YuboxWiFiClass::_abortRoam(void)
+{
+  // Se abandona el AP fijado y se vuelve a elegir red a partir de un escaneo
+  // completo, igual que al fallar la conexión directa.
+  _roamPending = false;
+  _roamFailures++;
+  if (WiFi.status() == WL_CONNECTED) return;
+  log_i("Falló cambio a otro AP, se escanean redes...");
+  if (!_startScan(WIFI_SCAN_ALL_CHANNELS, false, _scanPolicy.dwellTime)) _startCondRescanTimer(false);
+}
+
+void YuboxWiFiClass::_trackRoamBSSID(void)
+{
+  uint8_t * bssid = WiFi.BSSID();
+  if (bssid == NULL) return;
+
+  bool moved = (memcmp(bssid, _roamCurrBssid, sizeof(_roamCurrBssid)) != 0);
+  if (_roamPending) {
+    // Reconexión pedida por el roaming. Si se volvió al mismo AP, falló.
+    _roamPending = false;
+    if (moved) _finishRoam(false); else _roamFailures++;
+  } else if (moved && _roamBTMQueried && millis() - _ts_roamScan < _roamPolicy.minRoamInterval) {
+    _finishRoam(true);
+  }
+  memcpy(_roamCurrBssid, bssid, sizeof(_roamCurrBssid));
+}
+
+void YuboxWiFiClass::_finishRoam(bool btm)
+{
+  uint8_t * bssid = WiFi.BSSID();
+  if (bssid != NULL) memcpy(_roamTo, bssid, sizeof(_roamTo));
+  if (btm) _roamToRssi = WiFi.RSSI();
+  _roamLastBTM = btm;
+  _roamBTMQueried = false;
+  _roamLowCount = 0;
+  _ts_lastRoam = millis();
+  _roamCount++;
+  if (btm) _roamCountBTM++;
+
+  char from[18], to[18];
+  _formatBSSID(from, _roamFrom);
+  _formatBSSID(to, _roamTo);
+  log_i("roaming de AP %s a %s%s", from, to, btm ? " sugerido por AP" : "");
+
+  if (_pEvents != NULL && _pEvents->count() > 0) {
+    char json_str[128];
+    YuboxJSONWriter json(json_str, sizeof(json_str));
+    json.beginObject()
+      .field("from", from)
+      .field("to", to)
+      .field("rssi_from", (int)_roamFromRssi)
+      .field("rssi_to", (int)_roamToRssi)
+      .field("btm", btm)
+      .endObject();
+    if (!json.overflow()) _pEvents->send(json_str, "WiFiRoam");
+  }
+}
+
+void YuboxWiFiClass::_writeRoamingJSON(YuboxJSONWriter & json)
+{
+  json.beginObject();
+  json.field("enabled", _roamPolicy.enabled);
+  json.field("inhibited", _roamInhibit > 0);
+  json.field("scans", (unsigned long)_roamScans);
+  json.field("attempts", (unsigned long)_roamAttempts);
+  json.field("roams", (unsigned long)_roamCount);
+  json.field("btm", (unsigned long)_roamCountBTM);
+  json.field("failures", (unsigned long)_roamFailures);
+  json.key("last");
+  if (_roamCount == 0) {
+    json.valueNull();
+  } else {
+    char from[18], to[18];
+    _formatBSSID(from, _roamFrom);
+    _formatBSSID(to, _roamTo);
+    json.beginObject();
+    json.field("from", from);
+    json.field("to", to);
+    json.field("rssi_from", (int)_roamFromRssi);
+    json.field("rssi_to", (int)_roamToRssi);
+    json.field("btm", _roamLastBTM);
+    json.field("age", (unsigned long)((millis() - _ts_lastRoam) / 1000));
+    json.endObject();
+  }
+  json.endObject();
+}
+
+void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_roaming_GET(AsyncWebServerRequest *request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  char json_str[YUBOX_JSON_WRITER_RECORD_SIZE];
+  YuboxJSONWriter json(json_str, sizeof(json_str));
+
+  _writeRoamingJSON(json);
+  if (json.overflow()) {
+    request->send(500, "application/json", "{\"msg\":\"Estado de roaming excede espacio de respuesta\"}");
+    return;
+  }
+  request->send(200, "application/json", json_str);
+}
+
+void YuboxWiFiClass::_writeScanPolicyJSON(YuboxJSONWriter & json)
+{
+  json.beginObject();
+  json.field("ui_interval", (unsigned long)_scanPolicy.uiInterval);
+  json.field("min_interval", (unsigned long)_scanPolicy.minInterval);
+  json.field("max_interval", (unsigned long)_scanPolicy.maxInterval);
+  json.field("dwell_time", (unsigned int)_scanPolicy.dwellTime);
+  json.field("refresh_dwell_time", (unsigned int)_scanPolicy.refreshDwellTime);
+  json.field("refresh_passive", _scanPolicy.refreshPassive);
+  json.field("full_scan_every", (unsigned int)_scanPolicy.fullScanEvery);
+  json.field("budget_percent", (unsigned int)_scanPolicy.budgetPercent);
+  json.endObject();
+}
+
+void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_scanpolicy_GET(AsyncWebServerRequest *request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  char json_str[YUBOX_JSON_WRITER_RECORD_SIZE];
+  YuboxJSONWriter json(json_str, sizeof(json_str));
+
+  _writeScanPolicyJSON(json);
+  if (json.overflow()) {
+    request->send(500, "application/json", "{\"msg\":\"Pol\\u00edtica de escaneo excede espacio de respuesta\"}");
+    return;
+  }
+  request->send(200, "application/json", json_str);
+}
+
+// Leer un parámetro numérico opcional de la política de escaneo. Devuelve
+// falso si el parámetro está presente pero no es un entero en [vmin, vmax].
+static bool _getScanPolicyParam(AsyncWebServerRequest *request, const char * name,
+  uint32_t vmin, uint32_t vmax, uint32_t & v)
+{
+  if (!request->hasParam(name, true)) return true;
+
+  const String & s = request->getParam(name, true)->value();
+  if (s.length() == 0 || s.length() > 10 || !(s[0] >= '0' && s[0] <= '9')) return false;
+
+  char * q;
+  unsigned long long n = strtoull(s.c_str(), &q, 10);
+  if (*q != '\0' || n < vmin || n > vmax) return false;
+  v = n;
+  return true;
+}
+
+void YuboxWiFiClass::_routeHandler_yuboxAPI_wificonfig_scanpolicy_PUT(AsyncWebServerRequest *request)
+{
+  YUBOX_RUN_AUTH(request);
+
+  bool clientError = false;
+  String responseMsg = "";
+  uint32_t n;
+
+  // Los parámetros no indicados conservan su valor actual. Se rechazan los
+  // valores que setScanPolicy() tendría que corregir.
+  YuboxWiFi_scanPolicy policy = _scanPolicy;
+
+  n = policy.uiInterval;
+  if (!clientError && !_getScanPolicyParam(request, "ui_interval", 1, UINT32_MAX, n)) {
+    clientError = true;
+    responseMsg = "Intervalo de escaneo con interfaz abierta inválido";
+  }
+  policy.uiInterval = n;
+
+  n = policy.minInterval;
+  if (!clientError && !_getScanPolicyParam(request, "min_interval", 1, UINT32_MAX, n)) {
+    clientError = true;
+    responseMsg = "Intervalo mínimo de escaneo inválido";
+  }
+  policy.minInterval = n;
+
+  n = policy.maxInterval;
+  if (!clientError && !_getScanPolicyParam(request, "max_interval", 1, UINT32_MAX, n)) {
+    clientError = true;
+    responseMsg = "Intervalo máximo de escaneo inválido";
+  }
+  policy.maxInterval = n;
+
+  if (!clientError && policy.maxInterval < policy.minInterval) {
+    clientError = true;
+    responseMsg = "Intervalo máximo de escaneo debe ser mayor o igual al mínimo";
+  }
+
+  n = policy.dwellTime;
+  if (!clientError && !_getScanPolicyParam(request, "dwell_time", 0, UINT16_MAX, n)) {
+    clientError = true;
+    responseMsg = "Tiempo por canal de escaneo inválido";
+  }
+  policy.dwellTime = n;
+
+  n = policy.refreshDwellTime;
+  if (!clientError && !_getScanPolicyParam(request, "refresh_dwell_time", 0, UINT16_MAX, n)) {
+    clientError = true;
+    responseMsg = "Tiempo por canal de refresco inválido";
+  }
+  policy.refreshDwellTime = n;
+
+  n = policy.refreshPassive ? 1 : 0;
+  if (!clientError && !_getScanPolicyParam(request, "refresh_passive", 0, 1, n)) {
+    clientError = true;
+    responseMsg = "Indicador de refresco pasivo debe ser 0 o 1";
+  }
+  policy.refreshPassive = (n != 0);
+
+  n = policy.fullScanEvery;
+  if (!clientError && !_getScanPolicyParam(request, "full_scan_every", 1, UINT8_MAX, n)) {
+    clientError = true;
+    responseMsg = "Frecuencia de escaneo completo debe estar entre 1 y 255";
+  }
+  policy.fullScanEvery = n;
+
+  n = policy.budgetPercent;
+  if (!clientError && !_getScanPolicyParam(request, "budget_percent", 0, 100, n)) {
+    clientError = true;
+    responseMsg = "Porcentaje de tiempo de radio debe estar entre 0 y 100";
+  }
+  policy.budgetPercent = n;
+
+  if (!clientError) {
+    setScanPolicy(policy);
+    responseMsg = "Parámetros actualizados correctamente";
+  }
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->setCode(clientError ? 400 : 202);
+  YuboxJsonDocument<YuboxJSONSchema_StatusMsg> json_doc;
+  json_doc["success"] = !clientError;
+  json_doc["msg"] = responseMsg.c_str();
+
+  serializeJson(json_doc, *response);
+  request->send(response);
 }
 
 YuboxWiFiClass YuboxWiFi;
@@ -10,6 +10,10 @@
 #include <vector>
 
 #include "YuboxWebAuthClass.h"
+#include "YuboxRouterClass.h"
+#include "YuboxJSONWriter.h"
+#include "YuboxEventSource.h"
+#include "YuboxWebSocketMuxClass.h"
 
 // Estructura para representar credenciales de una red WiFi
 typedef struct {
@@ -19,10 +23,33 @@ typedef struct {
   String password;
 } YuboxWiFi_cred;
 
+// Si es 1, la conexión directa al arranque reutiliza como IP estática la
+// última concesión DHCP, ahorrando la negociación DHCP. Sólo es seguro si el
+// servidor DHCP reserva la IP para el dispositivo.
+#ifndef YUBOX_WIFI_FAST_STATIC_IP
+#define YUBOX_WIFI_FAST_STATIC_IP     0
+#endif
+
+// Datos de la última conexión exitosa a una red, para conectarse al arranque
+// directamente al mismo AP y canal, sin escaneo previo. Se guarda en NVRAM
+// como un solo bloque en net/N/fast. Un canal 0 indica que no hay datos.
+typedef struct {
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t netmask;
+  uint32_t dns;
+} YuboxWiFi_fastconn;
+
 typedef struct {
   // Los siguientes 4 parámetros se leen de la NVRAM al arranque
   YuboxWiFi_cred cred;
 
+  // AP, canal y concesión IP de la última conexión exitosa
+  YuboxWiFi_fastconn fast;
+
   // Bandera de red usada por última vez. Esta bandera no debe confundirse con
   // la bandera de pin de red (net/sel). La bandera de pin de red indica la
   // red que TIENE que usarse como activa. La bandera de aquí es la red que
@@ -37,14 +64,93 @@ typedef struct {
   bool _dirty;
 } YuboxWiFi_nvramrec;
 
+// Capacidad de la caché de escaneo. Las redes adicionales de un escaneo se
+// descartan hasta que se libere espacio.
+#ifndef YUBOX_WIFI_SCAN_MAX
+#define YUBOX_WIFI_SCAN_MAX           64
+#endif
+
+// Variación mínima de RSSI, en dBm, para reportar una red como cambiada
+#ifndef YUBOX_WIFI_SCAN_RSSI_DELTA
+#define YUBOX_WIFI_SCAN_RSSI_DELTA    4
+#endif
+
+// Cambio de una red de la caché, pendiente de reportar a los clientes
+#define YUBOX_WIFI_SCAN_UNCHANGED     0
+#define YUBOX_WIFI_SCAN_ADDED         1
+#define YUBOX_WIFI_SCAN_CHANGED       2
+#define YUBOX_WIFI_SCAN_REMOVED       3
+
+// Estado de la red respecto a la conexión y las redes guardadas
+#define YUBOX_WIFI_SCAN_CONNECTED     0x01
+#define YUBOX_WIFI_SCAN_CONNFAIL      0x02
+#define YUBOX_WIFI_SCAN_SAVED         0x04
+
+// Red encontrada en el escaneo. El registro es de tamaño fijo y la caché se
+// reutiliza de un escaneo al siguiente, sin pedir memoria dinámica.
 typedef struct {
-  String bssid;
-  String ssid;
-  int32_t channel;
-  int32_t rssi;
-  uint8_t authmode;
+  uint8_t bssid[6];
+  char ssid[33];
+  int8_t rssi;            // Último RSSI reportado a los clientes
+  uint8_t channel : 4;
+  uint8_t authmode : 4;
+  uint8_t change : 2;     // YUBOX_WIFI_SCAN_UNCHANGED...REMOVED
+  uint8_t seen : 1;       // Presente en el escaneo en curso
+  uint8_t status : 3;     // Banderas YUBOX_WIFI_SCAN_CONNECTED...SAVED
 } YuboxWiFi_scanCache;
 
+// Política de escaneo de redes WiFi. Cada escaneo saca la radio del canal de
+// trabajo, lo cual afecta a los clientes del AP y al tráfico de la aplicación,
+// por lo que se escanea sólo lo necesario.
+typedef struct {
+  // Intervalo, en ms, entre escaneos mientras hay clientes configurando WiFi.
+  // Un valor de 0 se reemplaza por minInterval.
+  uint32_t uiInterval;
+
+  // Mientras no hay red conectada, el intervalo entre escaneos empieza en
+  // minInterval y se duplica en cada intento fallido hasta maxInterval.
+  uint32_t minInterval;
+  uint32_t maxInterval;
+
+  // Tiempo por canal, en ms, de un escaneo completo
+  uint16_t dwellTime;
+
+  // Tiempo por canal, en ms, cuando sólo se requiere refrescar RSSI de la
+  // lista mostrada, y si este escaneo es pasivo en lugar de activo.
+  uint16_t refreshDwellTime;
+  bool refreshPassive;
+
+  // Cada cuántos escaneos se hace uno completo. Los demás se restringen a los
+  // canales donde se vieron las redes guardadas, o sólo refrescan RSSI.
+  uint8_t fullScanEvery;
+
+  // Porcentaje máximo del tiempo de radio dedicado a escanear. El siguiente
+  // escaneo se retrasa según la duración del anterior. 0 desactiva el límite.
+  uint8_t budgetPercent;
+} YuboxWiFi_scanPolicy;
+
+// Política de roaming entre APs (BSSID) de una misma red. Con la señal del AP
+// actual degradada, se busca la misma red en los demás APs, y se cambia a uno
+// que supere al actual por al menos rssiHysteresis.
+typedef struct {
+  // Desactivado por omisión
+  bool enabled;
+
+  // Intervalo, en ms, entre muestras de RSSI del AP actual
+  uint32_t checkInterval;
+
+  // La señal se considera degradada luego de lowSamples muestras consecutivas
+  // bajo rssiThreshold, y recuperada al subir hasta rssiThreshold + rssiHysteresis.
+  int8_t rssiThreshold;
+  uint8_t lowSamples;
+
+  // Ventaja mínima, en dB, de un AP candidato sobre el AP actual
+  uint8_t rssiHysteresis;
+
+  // Tiempo mínimo, en ms, entre dos búsquedas de AP
+  uint32_t minRoamInterval;
+} YuboxWiFi_roamPolicy;
+
 class YuboxWiFiClass
 {
 private:
@@ -74,8 +180,11 @@ private:
   int32_t _selNetwork;
   std::vector<YuboxWiFi_nvramrec> _savedNetworks;
 
-  // Caché de el último escaneo de redes efectuado
-  std::vector<YuboxWiFi_scanCache> _scannedNetworks;
+  // Caché de el último escaneo de redes efectuado. Cada escaneo que cambia la
+  // caché incrementa _scanSeq, y los clientes reciben sólo las diferencias.
+  YuboxWiFi_scanCache _scannedNetworks[YUBOX_WIFI_SCAN_MAX];
+  uint8_t _numScannedNetworks;
+  uint32_t _scanSeq;
   unsigned long _scannedNetworks_timestamp;
 
   // Copia de las credenciales elegidas, para asegurar vida de cadenas
@@ -83,12 +192,60 @@ private:
   YuboxWiFi_cred _trialNetwork;
   bool _useTrialNetworkFirst;
 
-  AsyncEventSource * _pEvents;
+  // Conexión directa al arranque en curso, y momento de inicio del WiFi
+  // para medir el tiempo hasta obtener IP.
+  bool _fastConnectPending;
+  unsigned long _ts_startWiFi;
+
+  // Tiempo desde el inicio del WiFi hasta la primera IP, y si se obtuvo por
+  // conexión directa. Se reporta en el estado de la conexión.
+  uint32_t _bootToIPMsec;
+  bool _bootToIPFast;
+
+  YuboxEventSource * _pEvents;
 
   // Timers asociados a llamadas de métodos
   TimerHandle_t _timer_wifiRescan;
   bool _disconnectBeforeRescan;
   uint32_t _interval_wifiRescan;
+  bool _rescanForUI;
+
+  // Estado del planificador de escaneo
+  YuboxWiFi_scanPolicy _scanPolicy;
+  uint32_t _scanBackoff;          // Siguiente intervalo mientras no hay red
+  uint32_t _scanCycle;            // Escaneos programados desde el último completo
+  bool _scanRunning;              // Escaneo propio en curso
+  uint16_t _scanChannelsPending;  // Canales por escanear, un bit por canal
+  uint16_t _scanChannelMask;      // Canales del escaneo en curso
+  bool _scanPassive;
+  uint16_t _scanDwellTime;
+  unsigned long _ts_scanStart;
+  unsigned long _ts_scanEnd;
+  uint32_t _scanDuration;         // Tiempo de radio del último escaneo, en ms
+  char _scanSSID[33];             // Red buscada por el escaneo en curso, o vacío
+
+  // Estado del roaming
+  YuboxWiFi_roamPolicy _roamPolicy;
+  TimerHandle_t _timer_roamCheck;
+  uint8_t _roamInhibit;           // Cuenta de inhibiciones activas, como OTA
+  uint8_t _roamLowCount;          // Muestras consecutivas de señal degradada
+  bool _roamScanPending;          // Búsqueda de AP en curso
+  bool _roamPending;              // Reconexión a otro AP en curso
+  bool _roamBTMQueried;           // Se pidió sugerencia de AP (802.11v)
+  uint8_t _roamCurrBssid[6];
+  uint8_t _roamFrom[6];
+  uint8_t _roamTo[6];
+  int8_t _roamFromRssi;
+  int8_t _roamToRssi;
+  bool _roamLastBTM;
+  unsigned long _ts_roamScan;
+  unsigned long _ts_roamStart;
+  unsigned long _ts_lastRoam;
+  uint32_t _roamScans;
+  uint32_t _roamAttempts;
+  uint32_t _roamCount;
+  uint32_t _roamCountBTM;
+  uint32_t _roamFailures;
 
   String _getWiFiMAC(void);
   void _loadOneNetworkFromNVRAM(Preferences &, uint32_t, YuboxWiFi_nvramrec &);
@@ -97,34 +254,64 @@ private:
   void _saveNetworksToNVRAM(void);
   void _updateActiveNetworkNVRAM(void);
   void _startWiFi(void);
-  void _collectScannedNetworks(void);
+  bool _startFastConnect(void);
+  void _abortFastConnect(void);
+  bool _startScan(uint16_t channels, bool passive, uint16_t dwellTime, const char * ssid = NULL);
+  bool _startNextScanChannel(void);
+  uint16_t _knownChannelMask(void);
+  void _collectScannedNetworks(uint16_t channels, const char * ssid);
+  YuboxWiFi_scanCache * _findScannedNetwork(const uint8_t * bssid);
+  void _refreshScannedNetworksStatus(void);
+  void _commitScannedNetworks(void);
   void _chooseKnownScannedNetwork(void);
-  void _connectToActiveNetwork(void);
+  void _connectToActiveNetwork(const YuboxWiFi_fastconn * fast = NULL);
+  void _beginSTA(const char * psk, int32_t channel, const uint8_t * bssid);
   void _startCondRescanTimer(bool);
+  uint32_t _scanBudgetGap(void);
+
+  void _startRoamScan(int8_t rssi);
+  void _evaluateRoam(void);
+  void _abortRoam(void);
+  void _trackRoamBSSID(void);
+  void _finishRoam(bool btm);
+  void _writeRoamingJSON(YuboxJSONWriter &);
+  void _writeScanPolicyJSON(YuboxJSONWriter &);
 
-  String _buildAvailableNetworksJSONReport(void);
+  void _writeScannedNetworkJSON(YuboxJSONWriter &, const YuboxWiFi_scanCache &);
+  void _writeAvailableNetworksJSONReport(YuboxJSONWriter &);
+  void _writeScanDiffJSONReport(YuboxJSONWriter &);
+  void _sendAvailableNetworksJSONReport(YuboxEventSourceClient * client = NULL, bool diff = false);
 
   void _bootstrapWebServer(void);
 
   // Callbacks y timers
-  void _cbHandler_WiFiEvent(WiFiEvent_t event, WiFiEventInfo_t);
+  void _cbHandler_WiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
   void _cbHandler_WiFiEvent_ready(WiFiEvent_t event, WiFiEventInfo_t);
   void _cbHandler_WiFiEvent_scandone(WiFiEvent_t event, WiFiEventInfo_t);
   void _cbHandler_WiFiRescan(TimerHandle_t);
+  void _cbHandler_WiFiRoamCheck(TimerHandle_t);
 
   void _setupHTTPRoutes(AsyncWebServer &);
 
-  void _routeHandler_yuboxAPI_wificonfig_netscan_onConnect(AsyncEventSourceClient *);
+  void _routeHandler_yuboxAPI_wificonfig_netscan_onConnect(YuboxEventSourceClient *);
   void _routeHandler_yuboxAPI_wificonfig_connection_GET(AsyncWebServerRequest *request);
   void _routeHandler_yuboxAPI_wificonfig_connection_PUT(AsyncWebServerRequest *request);
   void _routeHandler_yuboxAPI_wificonfig_connection_DELETE(AsyncWebServerRequest *request);
+  void _routeHandler_yuboxAPI_wificonfig_roaming_GET(AsyncWebServerRequest *request);
+  void _routeHandler_yuboxAPI_wificonfig_scanpolicy_GET(AsyncWebServerRequest *request);
+  void _routeHandler_yuboxAPI_wificonfig_scanpolicy_PUT(AsyncWebServerRequest *request);
   void _routeHandler_yuboxAPI_wificonfig_networks_GET(AsyncWebServerRequest *request);
   void _routeHandler_yuboxAPI_wificonfig_networks_POST(AsyncWebServerRequest *request);
   void _routeHandler_yuboxAPI_wificonfig_networks_DELETE(AsyncWebServerRequest *request);
+  void _routeHandler_yuboxAPI_wificonfig_networks_ssid_GET(AsyncWebServerRequest *request, const YuboxURLCaptures &);
+  void _routeHandler_yuboxAPI_wificonfig_networks_ssid_DELETE(AsyncWebServerRequest *request, const YuboxURLCaptures &);
   void _routeHandler_spiffslist_GET(AsyncWebServerRequest *request);
 
   // Funciones de ayuda para responder a peticiones web
-  void _serializeOneSavedNetwork(AsyncResponseStream *response, uint32_t i);
+  void _serializeOneSavedNetwork(YuboxJSONWriter &, uint32_t i);
+  void _writeSavedNetworksJSONReport(YuboxJSONWriter &);
+  void _writeConnectionJSON(YuboxJSONWriter &);
+  void _sendOneSavedNetwork(AsyncWebServerRequest *request, const String & ssid);
   void _addOneSavedNetwork(AsyncWebServerRequest *request, bool switch2net);
   void _delOneSavedNetwork(AsyncWebServerRequest *request, String ssid, bool deleteconnected);
 
@@ -147,7 +334,22 @@ public:
   void saveControlOfWiFi(void);
   YuboxWiFi_cred getLastActiveNetwork(void);
 
+  // Política de escaneo de redes. Los cambios se aplican al programar el
+  // siguiente escaneo.
+  YuboxWiFi_scanPolicy getScanPolicy(void) { return _scanPolicy; }
+  void setScanPolicy(const YuboxWiFi_scanPolicy &);
+
+  // Política de roaming entre APs de la misma red
+  YuboxWiFi_roamPolicy getRoamPolicy(void) { return _roamPolicy; }
+  void setRoamPolicy(const YuboxWiFi_roamPolicy &);
+
+  // Impedir el roaming mientras dure una operación que no debe interrumpirse,
+  // como una carga OTA. Cada llamada con true debe tener su llamada con false.
+  void inhibitRoaming(bool inhibit);
+  bool isRoamingInhibited(void) { return _roamInhibit > 0; }
+
   friend void _cb_YuboxWiFiClass_wifiRescan(TimerHandle_t);
+  friend void _cb_YuboxWiFiClass_roamCheck(TimerHandle_t);
 };
 
 extern YuboxWiFiClass YuboxWiFi;
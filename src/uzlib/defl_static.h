@@ -1,3 +1,7 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct Outbuf {
     unsigned char *outbuf;
     int outlen, outsize;
@@ -11,3 +15,7 @@ void zlib_start_block(struct Outbuf *ctx);
 void zlib_finish_block(struct Outbuf *ctx);
 void zlib_literal(struct Outbuf *ectx, unsigned char c);
 void zlib_match(struct Outbuf *ectx, int distance, int len);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -26,6 +26,9 @@
  *
  * 3. This notice may not be removed or altered from
  *    any source distribution.
+ *
+ * Modified for YUBOX Framework: optional hash chains, so that several
+ * candidates are probed for each position and the longest match is used.
  */
 #include <stdint.h>
 #include <string.h>
@@ -95,30 +98,73 @@ static inline void copy(void *data, unsigned offset, unsigned len)
 #endif
 
 
+#define CHAIN_MASK (data->dict_size - 1)
+
+/* Insert position p in the hash table, and in its chain if enabled */
+static inline const uint8_t *insert(struct uzlib_comp *data, const uint8_t *p)
+{
+    const uint8_t **bucket = &data->hash_table[HASH(data, p)];
+    const uint8_t *prev = *bucket;
+    *bucket = p;
+    if (data->hash_chain) {
+        data->hash_chain[(uintptr_t)p & CHAIN_MASK] = prev;
+    }
+    return prev;
+}
+
 void uzlib_compress(struct uzlib_comp *data, const uint8_t *src, unsigned slen)
 {
-    const uint8_t *top = src + slen - MIN_MATCH;
+    const uint8_t *end = src + slen;
+    const uint8_t *top = end - MIN_MATCH;
+    unsigned max_chain = (data->hash_chain && data->max_chain > 0) ? data->max_chain : 1;
+
     while (src < top) {
-        int h = HASH(data, src);
-        const uint8_t **bucket = &data->hash_table[h & (HASH_SIZE - 1)];
-        const uint8_t *subs = *bucket;
-        *bucket = src;
-        if (subs && src > subs && (src - subs) <= MAX_OFFSET && !memcmp(src, subs, MIN_MATCH)) {
-            src += MIN_MATCH;
-            const uint8_t *m = subs + MIN_MATCH;
-            int len = MIN_MATCH;
-            while (*src == *m && len < MAX_MATCH && src < top) {
-                src++; m++; len++;
+        const uint8_t *subs = insert(data, src);
+        const uint8_t *best = NULL;
+        unsigned best_len = 0;
+        unsigned max_len = end - src;
+        unsigned probes = max_chain;
+
+        if (max_len > MAX_MATCH) max_len = MAX_MATCH;
+        while (subs && src > subs && (unsigned)(src - subs) <= MAX_OFFSET && probes-- > 0) {
+            /* A candidate can only win if it matches one byte past the best
+               match so far, which is checked first since it usually fails */
+            if (subs[best_len] == src[best_len] && !memcmp(src, subs, MIN_MATCH)) {
+                unsigned len = MIN_MATCH;
+                while (len < max_len && src[len] == subs[len]) len++;
+                if (len > best_len) {
+                    best = subs;
+                    best_len = len;
+                    if (len == max_len) break;
+                }
             }
-            copy(data, src - len - subs, len);
+            if (!data->hash_chain) break;
+
+            /* Chain slots are reused every dict_size bytes, so a link that
+               does not point further back belongs to a newer position */
+            const uint8_t *next = data->hash_chain[(uintptr_t)subs & CHAIN_MASK];
+            if (next >= subs) break;
+            subs = next;
+        }
+
+        if (best_len >= MIN_MATCH) {
+            copy(data, src - best, best_len);
+
+            /* Positions covered by the match are also hashed when chains
+               are enabled, so later data can refer to them */
+            const uint8_t *next = src + best_len;
+            src++;
+            if (data->hash_chain) {
+                while (src < next && src < top) insert(data, src++);
+            }
+            src = next;
         } else {
             literal(data, *src++);
         }
     }
     // Process buffer tail, which is less than MIN_MATCH
     // (and so it doesn't make sense to look for matches there)
-    top += MIN_MATCH;
-    while (src < top) {
+    while (src < end) {
         literal(data, *src++);
     }
 }
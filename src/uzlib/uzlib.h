@@ -127,6 +127,14 @@ struct uzlib_comp {
     uzlib_hash_entry_t *hash_table;
     unsigned int hash_bits;
     unsigned int dict_size;
+
+    /* Optional hash chains (added for YUBOX Framework): for each position,
+       the previous position with the same hash, indexed by the address of
+       the position modulo dict_size, which must then be a power of 2. At
+       most max_chain candidates are probed per position. If hash_chain is
+       NULL, only the latest position of each hash is probed, as before. */
+    uzlib_hash_entry_t *hash_chain;
+    unsigned int max_chain;
 };
 
 void TINFCC uzlib_compress(struct uzlib_comp *c, const uint8_t *src, unsigned slen);